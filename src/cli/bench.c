@@ -0,0 +1,488 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "bench.h"
+
+#ifdef _WIN32
+int runBenchmarks(int argc, char *argv[]) {
+    (void) argc; (void) argv;
+
+    fprintf(stderr, "--bench is not supported on Windows.\n");
+    return 64;
+}
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include "../include/dictu_include.h"
+
+#define USAGE "Usage: dictu --bench <dir> [--runs n] [--output file] [--baseline file] [--threshold percent] [--cpu n]\n"
+
+typedef struct {
+    char *path;
+    const char *name;
+    double *times;
+    int completed;
+    double median;
+    double min;
+    double mean;
+    double stddev;
+    long maxRSS; // Kilobytes
+    size_t gcCount;
+    bool failed;
+} Benchmark;
+
+typedef struct {
+    Benchmark *benchmarks;
+    int count;
+    int capacity;
+} BenchmarkList;
+
+// What a child process reports back to the runner
+typedef struct {
+    double seconds;
+    size_t gcCount;
+} RunResult;
+
+typedef struct {
+    const char *directory;
+    const char *output;
+    const char *baseline;
+    int runs;
+    double threshold;
+    int cpu;
+} BenchOptions;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char *loadSource(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+
+    fseek(file, 0L, SEEK_END);
+    size_t fileSize = ftell(file);
+    rewind(file);
+
+    char *buffer = malloc(fileSize + 1);
+    if (buffer == NULL) {
+        fclose(file);
+        return NULL;
+    }
+
+    size_t bytesRead = fread(buffer, sizeof(char), fileSize, file);
+    buffer[bytesRead] = '\0';
+
+    fclose(file);
+    return buffer;
+}
+
+static bool hasExtension(const char *name, const char *extension) {
+    size_t length = strlen(name);
+    size_t extensionLength = strlen(extension);
+
+    return length > extensionLength && strcmp(name + length - extensionLength, extension) == 0;
+}
+
+static void addBenchmark(BenchmarkList *list, char *path) {
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity < 8 ? 8 : list->capacity * 2;
+        list->benchmarks = realloc(list->benchmarks, sizeof(Benchmark) * list->capacity);
+
+        if (list->benchmarks == NULL) {
+            fprintf(stderr, "Unable to allocate memory\n");
+            exit(71);
+        }
+    }
+
+    Benchmark *benchmark = &list->benchmarks[list->count++];
+    memset(benchmark, 0, sizeof(Benchmark));
+    benchmark->path = path;
+}
+
+static void findBenchmarks(BenchmarkList *list, const char *directory) {
+    DIR *dir = opendir(directory);
+    if (dir == NULL) {
+        return;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+
+        size_t length = strlen(directory) + strlen(entry->d_name) + 2;
+        char *path = malloc(length);
+        snprintf(path, length, "%s/%s", directory, entry->d_name);
+
+        struct stat info;
+        if (stat(path, &info) != 0) {
+            free(path);
+            continue;
+        }
+
+        if (S_ISDIR(info.st_mode)) {
+            findBenchmarks(list, path);
+            free(path);
+        } else if (hasExtension(entry->d_name, ".du")) {
+            addBenchmark(list, path);
+        } else {
+            free(path);
+        }
+    }
+
+    closedir(dir);
+}
+
+static int compareBenchmarks(const void *a, const void *b) {
+    return strcmp(((const Benchmark *) a)->path, ((const Benchmark *) b)->path);
+}
+
+static int compareDoubles(const void *a, const void *b) {
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * Pin the runner, and so every child it forks, to one CPU so runs are not
+ * migrated between cores mid-measurement.
+ */
+static void pinCPU(int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+
+    if (cpu < 0) {
+        if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+            return;
+        }
+
+        for (cpu = 0; cpu < CPU_SETSIZE && !CPU_ISSET(cpu, &set); ++cpu);
+    }
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        fprintf(stderr, "Warning: unable to pin to CPU %d, timings may be noisier.\n", cpu);
+    }
+#else
+    (void) cpu;
+#endif
+}
+
+/**
+ * Runs a benchmark once in a forked child with its own VM. The script's
+ * output is discarded, errors still go to stderr.
+ */
+static bool runOnce(Benchmark *benchmark, RunResult *result, long *maxRSS) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return false;
+    }
+
+    pid_t pid = fork();
+
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+
+    if (pid == 0) {
+        close(fds[0]);
+
+        int devNull = open("/dev/null", O_WRONLY);
+        if (devNull >= 0) {
+            dup2(devNull, STDOUT_FILENO);
+            close(devNull);
+        }
+
+        char *source = loadSource(benchmark->path);
+        if (source == NULL) {
+            fprintf(stderr, "Could not open file \"%s\".\n", benchmark->path);
+            _exit(74);
+        }
+
+        char *args[] = {"dictu", benchmark->path, NULL};
+        DictuVM *vm = dictuInitVM(false, 2, args);
+
+        double start = now();
+        DictuInterpretResult interpretResult = dictuInterpret(vm, benchmark->path, source);
+        RunResult childResult = {now() - start, dictuGCCount(vm)};
+
+        dictuFreeVM(vm);
+        free(source);
+
+        if (write(fds[1], &childResult, sizeof(childResult)) != sizeof(childResult)) {
+            _exit(74);
+        }
+
+        _exit(interpretResult == INTERPRET_OK ? 0 : 70);
+    }
+
+    close(fds[1]);
+
+    ssize_t bytesRead = read(fds[0], result, sizeof(RunResult));
+    close(fds[0]);
+
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) < 0) {
+        return false;
+    }
+
+#ifdef __APPLE__
+    // macOS reports bytes rather than kilobytes
+    *maxRSS = usage.ru_maxrss / 1024;
+#else
+    *maxRSS = usage.ru_maxrss;
+#endif
+
+    return bytesRead == sizeof(RunResult) && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static void runBenchmark(Benchmark *benchmark, int runs) {
+    benchmark->times = malloc(sizeof(double) * runs);
+
+    for (int i = 0; i < runs; ++i) {
+        RunResult result;
+        long maxRSS = 0;
+
+        if (!runOnce(benchmark, &result, &maxRSS)) {
+            benchmark->failed = true;
+            return;
+        }
+
+        benchmark->times[benchmark->completed++] = result.seconds;
+
+        if (maxRSS > benchmark->maxRSS) {
+            benchmark->maxRSS = maxRSS;
+        }
+
+        if (result.gcCount > benchmark->gcCount) {
+            benchmark->gcCount = result.gcCount;
+        }
+    }
+
+    int count = benchmark->completed;
+    qsort(benchmark->times, count, sizeof(double), compareDoubles);
+
+    double sum = 0;
+    for (int i = 0; i < count; ++i) {
+        sum += benchmark->times[i];
+    }
+
+    double squares = 0;
+    benchmark->mean = sum / count;
+    for (int i = 0; i < count; ++i) {
+        squares += (benchmark->times[i] - benchmark->mean) * (benchmark->times[i] - benchmark->mean);
+    }
+
+    benchmark->min = benchmark->times[0];
+    benchmark->median = count % 2 ? benchmark->times[count / 2]
+                                  : (benchmark->times[count / 2 - 1] + benchmark->times[count / 2]) / 2;
+    benchmark->stddev = count > 1 ? sqrt(squares / (count - 1)) : 0;
+}
+
+static bool writeResults(const char *path, BenchmarkList *list, int runs) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        return false;
+    }
+
+    // One benchmark per line, which is also what readBaseline() expects
+    fprintf(file, "{\n    \"runs\": %d,\n    \"benchmarks\": [\n", runs);
+
+    for (int i = 0; i < list->count; ++i) {
+        Benchmark *benchmark = &list->benchmarks[i];
+
+        fprintf(file, "        {\"name\": \"%s\", \"failed\": %s, \"median\": %.9g, \"min\": %.9g, \"mean\": %.9g, "
+                      "\"stddev\": %.9g, \"maxRSS\": %ld, \"gcCount\": %zu}%s\n",
+                benchmark->name, benchmark->failed ? "true" : "false", benchmark->median, benchmark->min,
+                benchmark->mean, benchmark->stddev, benchmark->maxRSS, benchmark->gcCount,
+                i + 1 < list->count ? "," : "");
+    }
+
+    fprintf(file, "    ]\n}\n");
+    fclose(file);
+
+    return true;
+}
+
+static double readField(const char *line, const char *key) {
+    char pattern[32];
+    snprintf(pattern, sizeof(pattern), "\"%s\": ", key);
+
+    const char *field = strstr(line, pattern);
+    return field == NULL ? NAN : strtod(field + strlen(pattern), NULL);
+}
+
+/**
+ * Finds a benchmark in a results file written by writeResults(), filling in
+ * its median and standard deviation.
+ */
+static bool readBaseline(const char *contents, const char *name, double *median, double *stddev) {
+    char pattern[512];
+    snprintf(pattern, sizeof(pattern), "{\"name\": \"%s\", \"failed\": false,", name);
+
+    const char *line = strstr(contents, pattern);
+    if (line == NULL) {
+        return false;
+    }
+
+    *median = readField(line, "median");
+    *stddev = readField(line, "stddev");
+
+    return !isnan(*median) && !isnan(*stddev);
+}
+
+static bool parseOptions(int argc, char *argv[], BenchOptions *options) {
+    options->directory = NULL;
+    options->output = NULL;
+    options->baseline = NULL;
+    options->runs = 5;
+    options->threshold = 5;
+    options->cpu = -1;
+
+    for (int i = 2; i < argc; ++i) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (arg[0] != '-' && options->directory == NULL) {
+            options->directory = arg;
+            continue;
+        }
+
+        if (value == NULL) {
+            return false;
+        }
+
+        if (strcmp(arg, "--runs") == 0) {
+            options->runs = atoi(value);
+        } else if (strcmp(arg, "--output") == 0) {
+            options->output = value;
+        } else if (strcmp(arg, "--baseline") == 0) {
+            options->baseline = value;
+        } else if (strcmp(arg, "--threshold") == 0) {
+            options->threshold = atof(value);
+        } else if (strcmp(arg, "--cpu") == 0) {
+            options->cpu = atoi(value);
+        } else {
+            return false;
+        }
+
+        i++;
+    }
+
+    return options->directory != NULL && options->runs > 0 && options->threshold >= 0;
+}
+
+int runBenchmarks(int argc, char *argv[]) {
+    BenchOptions options;
+
+    if (!parseOptions(argc, argv, &options)) {
+        fprintf(stderr, USAGE);
+        return 64;
+    }
+
+    char *baseline = NULL;
+    if (options.baseline != NULL && (baseline = loadSource(options.baseline)) == NULL) {
+        fprintf(stderr, "Could not open baseline \"%s\".\n", options.baseline);
+        return 74;
+    }
+
+    BenchmarkList list = {NULL, 0, 0};
+    findBenchmarks(&list, options.directory);
+
+    if (list.count == 0) {
+        fprintf(stderr, "No benchmarks found in \"%s\".\n", options.directory);
+        free(baseline);
+        return 66;
+    }
+
+    qsort(list.benchmarks, list.count, sizeof(Benchmark), compareBenchmarks);
+    pinCPU(options.cpu);
+
+    printf("%-40s %12s %12s %12s %12s %8s %10s\n", "Benchmark", "Median", "Min", "Stddev", "Max RSS", "GCs", "Change");
+
+    int failures = 0;
+    int regressions = 0;
+
+    for (int i = 0; i < list.count; ++i) {
+        Benchmark *benchmark = &list.benchmarks[i];
+        benchmark->name = benchmark->path + strlen(options.directory) + 1;
+
+        runBenchmark(benchmark, options.runs);
+
+        if (benchmark->failed) {
+            printf("%-40s %12s\n", benchmark->name, "FAILED");
+            failures++;
+            continue;
+        }
+
+        printf("%-40s %11.6fs %11.6fs %11.6fs %10ldKB %8zu", benchmark->name, benchmark->median,
+               benchmark->min, benchmark->stddev, benchmark->maxRSS, benchmark->gcCount);
+
+        double baselineMedian, baselineStddev;
+        if (baseline != NULL && readBaseline(baseline, benchmark->name, &baselineMedian, &baselineStddev)) {
+            double change = (benchmark->median - baselineMedian) / baselineMedian * 100;
+
+            /**
+             * Only a slowdown beyond the threshold that is also larger than
+             * twice the combined noise of both runs counts as a regression.
+             */
+            double noise = 2 * sqrt(benchmark->stddev * benchmark->stddev + baselineStddev * baselineStddev);
+            bool regressed = change > options.threshold && benchmark->median - baselineMedian > noise;
+
+            printf(" %+9.1f%%%s", change, regressed ? " REGRESSION" : "");
+            regressions += regressed;
+        }
+
+        printf("\n");
+        fflush(stdout);
+    }
+
+    if (options.output != NULL && !writeResults(options.output, &list, options.runs)) {
+        fprintf(stderr, "Could not write results to \"%s\".\n", options.output);
+        failures++;
+    }
+
+    if (baseline != NULL) {
+        printf("\n%d regression%s beyond %.1f%%\n", regressions, regressions == 1 ? "" : "s", options.threshold);
+    }
+
+    for (int i = 0; i < list.count; ++i) {
+        free(list.benchmarks[i].path);
+        free(list.benchmarks[i].times);
+    }
+
+    free(list.benchmarks);
+    free(baseline);
+
+    return failures > 0 || regressions > 0 ? 1 : 0;
+}
+#endif
@@ -0,0 +1,11 @@
+#ifndef dictu_bench_h
+#define dictu_bench_h
+
+/**
+ * dictu --bench <dir> runs every .du file under dir in a fresh process and
+ * reports wall time, peak RSS and garbage collections, optionally comparing
+ * against a baseline written by an earlier run. Returns the exit code.
+ */
+int runBenchmarks(int argc, char *argv[]);
+
+#endif //dictu_bench_h
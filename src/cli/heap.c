@@ -0,0 +1,408 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "heap.h"
+
+#define USAGE "Usage: dictu --heap <snapshot> [--top n]\n"
+
+#define SNAPSHOT_HEADER "dictu-heap-snapshot 1"
+
+#define UNDEFINED ((size_t) -1)
+
+typedef struct {
+    // Every node's type, as an index into types
+    int *type;
+    size_t *size;
+    char **name;
+    // Node n's edges are edges[edgeStart[n]] up to edges[edgeStart[n + 1]]
+    size_t *edgeStart;
+    size_t *edges;
+    size_t nodeCount;
+    size_t edgeCount;
+    char **types;
+    int typeCount;
+} Graph;
+
+static char *readSnapshot(const char *path) {
+    FILE *file = fopen(path, "rb");
+
+    if (file == NULL) {
+        return NULL;
+    }
+
+    fseek(file, 0L, SEEK_END);
+    long length = ftell(file);
+    rewind(file);
+
+    char *buffer = length < 0 ? NULL : malloc(length + 1);
+    if (buffer == NULL) {
+        fclose(file);
+        return NULL;
+    }
+
+    size_t bytesRead = fread(buffer, sizeof(char), length, file);
+    buffer[bytesRead] = '\0';
+    fclose(file);
+
+    return buffer;
+}
+
+static int internType(Graph *graph, char *type) {
+    for (int i = 0; i < graph->typeCount; ++i) {
+        if (strcmp(graph->types[i], type) == 0) {
+            return i;
+        }
+    }
+
+    graph->types = realloc(graph->types, sizeof(char *) * (graph->typeCount + 1));
+    graph->types[graph->typeCount] = type;
+
+    return graph->typeCount++;
+}
+
+// Undoes the escaping of names in place
+static void unescape(char *name) {
+    char *out = name;
+
+    for (char *in = name; *in != '\0'; ++in) {
+        if (*in == '\\' && in[1] != '\0') {
+            ++in;
+            *out++ = *in == 't' ? '\t' : *in == 'n' ? '\n' : *in == 'r' ? '\r' : *in;
+        } else {
+            *out++ = *in;
+        }
+    }
+
+    *out = '\0';
+}
+
+/**
+ * Parses the snapshot in place, the graph's names point into source.
+ * Returns false if it is not a snapshot or an edge leads nowhere.
+ */
+static bool parseSnapshot(char *source, Graph *graph) {
+    memset(graph, 0, sizeof(Graph));
+
+    size_t headerLength = strlen(SNAPSHOT_HEADER);
+    if (strncmp(source, SNAPSHOT_HEADER, headerLength) != 0 || source[headerLength] != '\n') {
+        return false;
+    }
+
+    size_t nodeCapacity = 0;
+    size_t edgeCapacity = 0;
+    char *line = source + headerLength + 1;
+
+    while (*line != '\0') {
+        char *end = strchr(line, '\n');
+        if (end != NULL) {
+            *end = '\0';
+        }
+
+        char *type = line;
+        char *size = strchr(type, '\t');
+        char *name = size == NULL ? NULL : strchr(size + 1, '\t');
+        char *edges = name == NULL ? NULL : strchr(name + 1, '\t');
+
+        if (edges == NULL) {
+            return false;
+        }
+
+        *size++ = '\0';
+        *name++ = '\0';
+        *edges++ = '\0';
+
+        if (graph->nodeCount == nodeCapacity) {
+            nodeCapacity = nodeCapacity < 1024 ? 1024 : nodeCapacity * 2;
+            graph->type = realloc(graph->type, sizeof(int) * nodeCapacity);
+            graph->size = realloc(graph->size, sizeof(size_t) * nodeCapacity);
+            graph->name = realloc(graph->name, sizeof(char *) * nodeCapacity);
+            graph->edgeStart = realloc(graph->edgeStart, sizeof(size_t) * (nodeCapacity + 1));
+        }
+
+        unescape(name);
+        graph->type[graph->nodeCount] = internType(graph, type);
+        graph->size[graph->nodeCount] = strtoull(size, NULL, 10);
+        graph->name[graph->nodeCount] = name;
+        graph->edgeStart[graph->nodeCount] = graph->edgeCount;
+
+        while (*edges != '\0') {
+            char *next;
+            size_t target = strtoull(edges, &next, 10);
+
+            if (next == edges) {
+                return false;
+            }
+
+            if (graph->edgeCount == edgeCapacity) {
+                edgeCapacity = edgeCapacity < 4096 ? 4096 : edgeCapacity * 2;
+                graph->edges = realloc(graph->edges, sizeof(size_t) * edgeCapacity);
+            }
+
+            graph->edges[graph->edgeCount++] = target;
+            edges = next;
+        }
+
+        graph->nodeCount++;
+        graph->edgeStart[graph->nodeCount] = graph->edgeCount;
+
+        if (end == NULL) {
+            break;
+        }
+
+        line = end + 1;
+    }
+
+    for (size_t i = 0; i < graph->edgeCount; ++i) {
+        if (graph->edges[i] >= graph->nodeCount) {
+            return false;
+        }
+    }
+
+    return graph->nodeCount > 0;
+}
+
+static void freeGraph(Graph *graph) {
+    free(graph->type);
+    free(graph->size);
+    free(graph->name);
+    free(graph->edgeStart);
+    free(graph->edges);
+    free(graph->types);
+}
+
+/**
+ * Numbers the nodes reachable from the roots in depth first postorder. Returns
+ * how many were reached, order holds them by number and post the number of each,
+ * or UNDEFINED for nodes that weren't reached.
+ */
+static size_t postorder(Graph *graph, size_t *order, size_t *post) {
+    size_t *stack = malloc(sizeof(size_t) * graph->nodeCount);
+    size_t *nextEdge = malloc(sizeof(size_t) * graph->nodeCount);
+    size_t depth = 0;
+    size_t count = 0;
+
+    for (size_t i = 0; i < graph->nodeCount; ++i) {
+        post[i] = UNDEFINED;
+        nextEdge[i] = graph->edgeStart[i];
+    }
+
+    // Reached but not yet numbered
+    post[0] = UNDEFINED - 1;
+    stack[depth++] = 0;
+
+    while (depth > 0) {
+        size_t node = stack[depth - 1];
+
+        if (nextEdge[node] < graph->edgeStart[node + 1]) {
+            size_t target = graph->edges[nextEdge[node]++];
+
+            if (post[target] == UNDEFINED) {
+                post[target] = UNDEFINED - 1;
+                stack[depth++] = target;
+            }
+
+            continue;
+        }
+
+        depth--;
+        post[node] = count;
+        order[count++] = node;
+    }
+
+    free(stack);
+    free(nextEdge);
+
+    return count;
+}
+
+/**
+ * Cooper, Harvey and Kennedy's iterative dominator algorithm, sweeping nodes in
+ * reverse postorder until the immediate dominators stop changing.
+ */
+static void dominators(Graph *graph, size_t *order, size_t *post, size_t reached, size_t *idom) {
+    size_t *predecessorStart = calloc(graph->nodeCount + 1, sizeof(size_t));
+    size_t *predecessors = malloc(sizeof(size_t) * (graph->edgeCount + 1));
+
+    for (size_t i = 0; i < graph->edgeCount; ++i) {
+        predecessorStart[graph->edges[i] + 1]++;
+    }
+
+    for (size_t i = 0; i < graph->nodeCount; ++i) {
+        predecessorStart[i + 1] += predecessorStart[i];
+    }
+
+    size_t *fill = malloc(sizeof(size_t) * graph->nodeCount);
+    memcpy(fill, predecessorStart, sizeof(size_t) * graph->nodeCount);
+
+    for (size_t node = 0; node < graph->nodeCount; ++node) {
+        for (size_t i = graph->edgeStart[node]; i < graph->edgeStart[node + 1]; ++i) {
+            predecessors[fill[graph->edges[i]]++] = node;
+        }
+    }
+
+    free(fill);
+
+    for (size_t i = 0; i < graph->nodeCount; ++i) {
+        idom[i] = UNDEFINED;
+    }
+
+    idom[0] = 0;
+
+    for (bool changed = true; changed;) {
+        changed = false;
+
+        // The roots are numbered last, skip them
+        for (size_t i = reached - 1; i-- > 0;) {
+            size_t node = order[i];
+            size_t newIdom = UNDEFINED;
+
+            for (size_t p = predecessorStart[node]; p < predecessorStart[node + 1]; ++p) {
+                size_t predecessor = predecessors[p];
+
+                if (idom[predecessor] == UNDEFINED) {
+                    continue;
+                }
+
+                if (newIdom == UNDEFINED) {
+                    newIdom = predecessor;
+                    continue;
+                }
+
+                size_t a = predecessor;
+                size_t b = newIdom;
+
+                while (a != b) {
+                    while (post[a] < post[b]) a = idom[a];
+                    while (post[b] < post[a]) b = idom[b];
+                }
+
+                newIdom = a;
+            }
+
+            if (idom[node] != newIdom) {
+                idom[node] = newIdom;
+                changed = true;
+            }
+        }
+    }
+
+    free(predecessorStart);
+    free(predecessors);
+}
+
+typedef struct {
+    size_t node;
+    size_t retained;
+} Retained;
+
+static int compareRetained(const void *a, const void *b) {
+    size_t left = ((const Retained *) a)->retained;
+    size_t right = ((const Retained *) b)->retained;
+
+    return (left < right) - (left > right);
+}
+
+static bool parseOptions(int argc, char *argv[], const char **path, int *top) {
+    *path = NULL;
+    *top = 20;
+
+    for (int i = 2; i < argc; ++i) {
+        if (strcmp(argv[i], "--top") == 0 && i + 1 < argc) {
+            *top = atoi(argv[++i]);
+        } else if (argv[i][0] == '-' || *path != NULL) {
+            return false;
+        } else {
+            *path = argv[i];
+        }
+    }
+
+    return *path != NULL && *top > 0;
+}
+
+int analyzeHeap(int argc, char *argv[]) {
+    const char *path;
+    int top;
+
+    if (!parseOptions(argc, argv, &path, &top)) {
+        fprintf(stderr, USAGE);
+        return 64;
+    }
+
+    char *source = readSnapshot(path);
+    if (source == NULL) {
+        fprintf(stderr, "Could not open snapshot \"%s\".\n", path);
+        return 74;
+    }
+
+    Graph graph;
+    if (!parseSnapshot(source, &graph)) {
+        fprintf(stderr, "\"%s\" is not a valid heap snapshot.\n", path);
+        freeGraph(&graph);
+        free(source);
+        return 65;
+    }
+
+    size_t *order = malloc(sizeof(size_t) * graph.nodeCount);
+    size_t *post = malloc(sizeof(size_t) * graph.nodeCount);
+    size_t *idom = malloc(sizeof(size_t) * graph.nodeCount);
+    size_t reached = postorder(&graph, order, post);
+
+    dominators(&graph, order, post, reached, idom);
+
+    // A node's dominator is numbered after it, so retained sizes fold up the dominator tree in postorder
+    Retained *retained = malloc(sizeof(Retained) * graph.nodeCount);
+    size_t total = 0;
+
+    for (size_t i = 0; i < graph.nodeCount; ++i) {
+        retained[i] = (Retained) {i, graph.size[i]};
+        total += graph.size[i];
+    }
+
+    for (size_t i = 0; i < reached; ++i) {
+        size_t node = order[i];
+
+        if (node != 0) {
+            retained[idom[node]].retained += retained[node].retained;
+        }
+    }
+
+    size_t *typeCounts = calloc(graph.typeCount, sizeof(size_t));
+    size_t *typeBytes = calloc(graph.typeCount, sizeof(size_t));
+
+    for (size_t i = 1; i < graph.nodeCount; ++i) {
+        typeCounts[graph.type[i]]++;
+        typeBytes[graph.type[i]] += graph.size[i];
+    }
+
+    printf("%zu objects, %zu references, %zu bytes\n\n", graph.nodeCount - 1, graph.edgeCount, total);
+
+    printf("%12s %14s  %s\n", "Count", "Bytes", "Type");
+    for (int i = 0; i < graph.typeCount; ++i) {
+        if (typeCounts[i] > 0) {
+            printf("%12zu %14zu  %s\n", typeCounts[i], typeBytes[i], graph.types[i]);
+        }
+    }
+
+    // The roots retain everything, leave them out
+    qsort(retained + 1, graph.nodeCount - 1, sizeof(Retained), compareRetained);
+
+    printf("\n%14s %10s %10s  %-12s %s\n", "Retained", "Shallow", "Node", "Type", "Name");
+    for (size_t i = 1; i < graph.nodeCount && i <= (size_t) top; ++i) {
+        size_t node = retained[i].node;
+        printf("%14zu %10zu %10zu  %-12s %s\n", retained[i].retained, graph.size[node], node,
+               graph.types[graph.type[node]], graph.name[node]);
+    }
+
+    free(typeCounts);
+    free(typeBytes);
+    free(retained);
+    free(order);
+    free(post);
+    free(idom);
+    freeGraph(&graph);
+    free(source);
+
+    return 0;
+}
@@ -0,0 +1,11 @@
+#ifndef dictu_heap_cli_h
+#define dictu_heap_cli_h
+
+/**
+ * dictu --heap <snapshot> reads a file written by System.heapSnapshot(), computes
+ * each object's dominator and the bytes it retains, and prints the heap by type
+ * along with the objects retaining the most. Returns the exit code.
+ */
+int analyzeHeap(int argc, char *argv[]);
+
+#endif //dictu_heap_cli_h
@@ -9,6 +9,8 @@
 #endif
 
 #include "../include/dictu_include.h"
+#include "bench.h"
+#include "heap.h"
 
 #ifndef DISABLE_LINENOISE
 #include "linenoise.h"
@@ -177,7 +179,7 @@ static char *readFile(const char *path) {
     return buffer;
 }
 
-static void runFile(DictuVM *vm, int argc, char *argv[]) {
+static int runFile(DictuVM *vm, int argc, char *argv[]) {
     UNUSED(argc);
 
     char *source = readFile(argv[1]);
@@ -190,22 +192,66 @@ static void runFile(DictuVM *vm, int argc, char *argv[]) {
     DictuInterpretResult result = dictuInterpret(vm, argv[1], source);
     free(source);
 
-    if (result == INTERPRET_COMPILE_ERROR) exit(65);
-    if (result == INTERPRET_RUNTIME_ERROR) exit(70);
+    if (result == INTERPRET_COMPILE_ERROR) return 65;
+    if (result == INTERPRET_RUNTIME_ERROR) return 70;
+
+    return 0;
 }
 
 int main(int argc, char *argv[]) {
+    if (argc >= 2 && strcmp(argv[1], "--bench") == 0) {
+        return runBenchmarks(argc, argv);
+    }
+
+    if (argc >= 2 && strcmp(argv[1], "--heap") == 0) {
+        return analyzeHeap(argc, argv);
+    }
+
+    char *profilePath = NULL;
+    char *callsPath = NULL;
+
+    while (argc >= 2 && (strncmp(argv[1], "--profile=", 10) == 0 || strncmp(argv[1], "--calls=", 8) == 0)) {
+        if (argv[1][2] == 'p') {
+            profilePath = argv[1] + 10;
+        } else {
+            callsPath = argv[1] + 8;
+        }
+
+        // Drop the flag so the script sees the usual arguments
+        argv[1] = argv[0];
+        argv++;
+        argc--;
+    }
+
     DictuVM *vm = dictuInitVM(argc == 1, argc, argv);
+    int status = 0;
+
+    if (profilePath != NULL && !dictuProfileStart(vm, 0)) {
+        fprintf(stderr, "Unable to start the profiler, it is not supported on this platform.\n");
+        profilePath = NULL;
+    }
+
+    if (callsPath != NULL) {
+        dictuCallProfileStart(vm);
+    }
 
     if (argc == 1) {
         repl(vm, argc, argv);
     } else if (argc >= 2) {
-        runFile(vm, argc, argv);
+        status = runFile(vm, argc, argv);
     } else {
         fprintf(stderr, "Usage: dictu [path] [args]\n");
         exit(64);
     }
 
+    if (profilePath != NULL && !dictuProfileStop(vm, profilePath)) {
+        fprintf(stderr, "Could not write profile to \"%s\".\n", profilePath);
+    }
+
+    if (callsPath != NULL && !dictuCallProfileStop(vm, callsPath)) {
+        fprintf(stderr, "Could not write call profile to \"%s\".\n", callsPath);
+    }
+
     dictuFreeVM(vm);
-    return 0;
+    return status;
 }
@@ -2,6 +2,7 @@
 #define dictu_include_h
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #define DICTU_MAJOR_VERSION "0"
 #define DICTU_MINOR_VERSION "14"
@@ -23,4 +24,21 @@ void dictuFreeVM(DictuVM *vm);
 
 DictuInterpretResult dictuInterpret(DictuVM *vm, char *moduleName, char *source);
 
+// Number of garbage collections the VM has run
+size_t dictuGCCount(DictuVM *vm);
+
+// Starts sampling the VM's call stack hz times a second of CPU time, or at the default rate if hz is 0.
+// Returns false if profiling is unsupported on this platform or a profile is already running.
+bool dictuProfileStart(DictuVM *vm, int hz);
+
+// Stops the profile and writes it to path as collapsed stacks, one "frame;frame;frame count" per line
+bool dictuProfileStop(DictuVM *vm, const char *path);
+
+// Starts timing every call to a Dictu function. Returns false if a call profile is already running.
+bool dictuCallProfileStart(DictuVM *vm);
+
+// Stops the call profile and writes it to path, as JSON if path ends in ".json" and as a table otherwise.
+// Does nothing and returns true if the profile was already stopped, e.g. by System.calls.stop().
+bool dictuCallProfileStop(DictuVM *vm, const char *path);
+
 #endif //dictu_include_h
@@ -1,8 +1,26 @@
 #include "base64.h"
 
+// Input consumed per write by encodeTo() and decodeTo(), a multiple of both 3 and 4
+#define BASE64_CHUNK_SIZE 49152
+
+static bool getUrlSafe(DictuVM *vm, const char *name, int argCount, Value *args, int position, bool *urlSafe) {
+    *urlSafe = false;
+
+    if (argCount > position) {
+        if (!IS_BOOL(args[position])) {
+            runtimeError(vm, "Optional argument passed to %s() must be a boolean.", name);
+            return false;
+        }
+
+        *urlSafe = AS_BOOL(args[position]);
+    }
+
+    return true;
+}
+
 static Value encode(DictuVM *vm, int argCount, Value *args) {
-    if (argCount != 1) {
-        runtimeError(vm, "encode() takes 1 argument (%d given)", argCount);
+    if (argCount != 1 && argCount != 2) {
+        runtimeError(vm, "encode() takes 1 or 2 arguments (%d given)", argCount);
         return EMPTY_VAL;
     }
 
@@ -11,22 +29,28 @@ static Value encode(DictuVM *vm, int argCount, Value *args) {
         return EMPTY_VAL;
     }
 
+    bool urlSafe;
+    if (!getUrlSafe(vm, "encode", argCount, args, 1, &urlSafe)) {
+        return EMPTY_VAL;
+    }
+
     ObjString *string = AS_STRING(args[0]);
 
     int size = b64e_size(string->length) + 1;
     char *buffer = ALLOCATE(vm, char, size);
 
-    int actualSize = b64_encode((unsigned char*)string->chars, string->length, (unsigned char*)buffer);
+    int actualSize = b64_encode_alphabet((unsigned char*)string->chars, string->length, (unsigned char*)buffer, urlSafe);
 
-    ObjString *encodedString = copyString(vm, buffer, actualSize);
-    FREE_ARRAY(vm, char, buffer, size);
+    // Hand the buffer straight to the string rather than copying it
+    buffer = SHRINK_ARRAY(vm, buffer, char, size, actualSize + 1);
+    buffer[actualSize] = '\0';
 
-    return OBJ_VAL(encodedString);
+    return OBJ_VAL(takeString(vm, buffer, actualSize));
 }
 
 static Value decode(DictuVM *vm, int argCount, Value *args) {
-    if (argCount != 1) {
-        runtimeError(vm, "encode() takes 1 argument (%d given)", argCount);
+    if (argCount != 1 && argCount != 2) {
+        runtimeError(vm, "decode() takes 1 or 2 arguments (%d given)", argCount);
         return EMPTY_VAL;
     }
 
@@ -35,17 +59,145 @@ static Value decode(DictuVM *vm, int argCount, Value *args) {
         return EMPTY_VAL;
     }
 
+    bool urlSafe;
+    if (!getUrlSafe(vm, "decode", argCount, args, 1, &urlSafe)) {
+        return EMPTY_VAL;
+    }
+
     ObjString *encodedString = AS_STRING(args[0]);
 
     int size = b64d_size(encodedString->length) + 1;
     char *buffer = ALLOCATE(vm, char, size);
 
-    int actualSize = b64_decode((unsigned char*)encodedString->chars, encodedString->length, (unsigned char*)buffer);
+    long actualSize = b64_decode_alphabet((unsigned char*)encodedString->chars, encodedString->length, (unsigned char*)buffer, urlSafe);
+
+    if (actualSize < 0) {
+        FREE_ARRAY(vm, char, buffer, size);
+        errno = EINVAL;
+        SET_ERRNO(GET_SELF_CLASS);
+        return NIL_VAL;
+    }
+
+    buffer = SHRINK_ARRAY(vm, buffer, char, size, actualSize + 1);
+    buffer[actualSize] = '\0';
+
+    return OBJ_VAL(takeString(vm, buffer, actualSize));
+}
 
-    ObjString *string = copyString(vm, buffer, actualSize);
-    FREE_ARRAY(vm, char, buffer, size);
+static FILE *getWritableFile(DictuVM *vm, const char *name, Value value) {
+    if (!IS_FILE(value)) {
+        runtimeError(vm, "%s() second argument must be a file.", name);
+        return NULL;
+    }
+
+    ObjFile *file = AS_FILE(value);
+
+    if (!file->isOpen) {
+        runtimeError(vm, "%s() second argument is a file that has been closed.", name);
+        return NULL;
+    }
+
+    if (file->openType[0] == 'r' && strchr(file->openType, '+') == NULL) {
+        runtimeError(vm, "File is not writable!");
+        return NULL;
+    }
+
+    return file->file;
+}
+
+static Value encodeTo(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 2 && argCount != 3) {
+        runtimeError(vm, "encodeTo() takes 2 or 3 arguments (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    if (!IS_STRING(args[0])) {
+        runtimeError(vm, "encodeTo() first argument must be a string");
+        return EMPTY_VAL;
+    }
+
+    FILE *file = getWritableFile(vm, "encodeTo", args[1]);
+    if (file == NULL) {
+        return EMPTY_VAL;
+    }
+
+    bool urlSafe;
+    if (!getUrlSafe(vm, "encodeTo", argCount, args, 2, &urlSafe)) {
+        return EMPTY_VAL;
+    }
+
+    ObjString *string = AS_STRING(args[0]);
+    unsigned char buffer[BASE64_CHUNK_SIZE / 3 * 4];
+    size_t written = 0;
+
+    for (int i = 0; i < string->length; i += BASE64_CHUNK_SIZE) {
+        int length = string->length - i < BASE64_CHUNK_SIZE ? string->length - i : BASE64_CHUNK_SIZE;
+        size_t encoded = b64_encode_alphabet((unsigned char*)string->chars + i, length, buffer, urlSafe);
+
+        if (fwrite(buffer, 1, encoded, file) != encoded) {
+            SET_ERRNO(GET_SELF_CLASS);
+            return NIL_VAL;
+        }
+
+        written += encoded;
+    }
+
+    fflush(file);
+    return NUMBER_VAL(written);
+}
+
+static Value decodeTo(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 2 && argCount != 3) {
+        runtimeError(vm, "decodeTo() takes 2 or 3 arguments (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    if (!IS_STRING(args[0])) {
+        runtimeError(vm, "decodeTo() first argument must be a string");
+        return EMPTY_VAL;
+    }
+
+    FILE *file = getWritableFile(vm, "decodeTo", args[1]);
+    if (file == NULL) {
+        return EMPTY_VAL;
+    }
+
+    bool urlSafe;
+    if (!getUrlSafe(vm, "decodeTo", argCount, args, 2, &urlSafe)) {
+        return EMPTY_VAL;
+    }
+
+    ObjString *encodedString = AS_STRING(args[0]);
+    unsigned char buffer[BASE64_CHUNK_SIZE / 4 * 3];
+    size_t written = 0;
+
+    for (int i = 0; i < encodedString->length; i += BASE64_CHUNK_SIZE) {
+        int length = encodedString->length - i;
+        bool last = length <= BASE64_CHUNK_SIZE;
+
+        if (!last) {
+            length = BASE64_CHUNK_SIZE;
+        }
+
+        long decoded = b64_decode_alphabet((unsigned char*)encodedString->chars + i, length, buffer, urlSafe);
+
+        // Only the final chunk may be short, anything else means padding turned up early
+        if (decoded < 0 || (!last && decoded != BASE64_CHUNK_SIZE / 4 * 3)) {
+            errno = EINVAL;
+            SET_ERRNO(GET_SELF_CLASS);
+            return NIL_VAL;
+        }
+
+        if (fwrite(buffer, 1, decoded, file) != (size_t) decoded) {
+            SET_ERRNO(GET_SELF_CLASS);
+            return NIL_VAL;
+        }
+
+        written += decoded;
+    }
 
-    return OBJ_VAL(string);
+    fflush(file);
+    return NUMBER_VAL(written);
 }
 
 ObjModule *createBase64Module(DictuVM *vm) {
@@ -60,6 +212,8 @@ ObjModule *createBase64Module(DictuVM *vm) {
     defineNative(vm, &module->values, "strerror", strerrorNative);
     defineNative(vm, &module->values, "encode", encode);
     defineNative(vm, &module->values, "decode", decode);
+    defineNative(vm, &module->values, "encodeTo", encodeTo);
+    defineNative(vm, &module->values, "decodeTo", decodeTo);
 
     /**
      * Define Base64 properties
@@ -10,8 +10,46 @@
 
 #include "base64Lib.h"
 
+#include <string.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define B64_SIMD
+#include <immintrin.h>
+#endif
+
 //Base64 char table - used internally for encoding
 unsigned char b64_chr[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const unsigned char b64_url_chr[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+// Value of each character in an alphabet, 0xFF for characters outside it
+#define B64_INVALID 0xFF
+
+typedef struct {
+    const unsigned char *chr;
+    unsigned char value[256];
+} b64_alphabet;
+
+static b64_alphabet b64_standard = {b64_chr, {0}};
+static b64_alphabet b64_url = {b64_url_chr, {0}};
+static int b64_tables_ready = 0;
+
+static void b64_init_table(b64_alphabet *alphabet) {
+    memset(alphabet->value, B64_INVALID, sizeof(alphabet->value));
+
+    for (int i = 0; i < 64; i++) {
+        alphabet->value[alphabet->chr[i]] = i;
+    }
+}
+
+static const b64_alphabet *b64_get_alphabet(int url_safe) {
+    if (!b64_tables_ready) {
+        b64_init_table(&b64_standard);
+        b64_init_table(&b64_url);
+        b64_tables_ready = 1;
+    }
+
+    return url_safe ? &b64_url : &b64_standard;
+}
 
 unsigned int b64_int(unsigned int ch) {
 
@@ -22,95 +60,370 @@ unsigned int b64_int(unsigned int ch) {
     // 43     Plus (+)    >>  62
     // 47     Slash (/)   >>  63
     // 61     Equal (=)   >>  64~
-    if (ch==43)
-        return 62;
-    if (ch==47)
-        return 63;
     if (ch==61)
         return 64;
-    if ((ch>47) && (ch<58))
-        return ch + 4;
-    if ((ch>64) && (ch<91))
-        return ch - 'A';
-    if ((ch>96) && (ch<123))
-        return (ch - 'a') + 26;
-    return 0;
+
+    unsigned int value = b64_get_alphabet(0)->value[ch & 0xFF];
+    return value == B64_INVALID ? 0 : value;
 }
 
 unsigned int b64e_size(unsigned int in_size) {
 
     // size equals 4*floor((1/3)*(in_size+2));
-    unsigned int i, j = 0;
-    for (i=0;i<in_size;i++) {
-        if (i % 3 == 0)
-            j += 1;
-    }
-    return (4*j);
+    return 4 * ((in_size + 2) / 3);
 }
 
 unsigned int b64d_size(unsigned int in_size) {
 
-    return ((3*in_size)/4);
+    // Rounded up so unpadded input fits too
+    return 3 * ((in_size + 3) / 4);
 }
 
-unsigned int b64_encode(const unsigned char* in, unsigned int in_len, unsigned char* out) {
+/*
+ * Bulk encoders and decoders. These handle as much of the input as they can
+ * in whole blocks and return how many input bytes they consumed, leaving the
+ * rest (and the padding) to the scalar code.
+ */
+typedef size_t (*b64_bulk_fn)(const unsigned char *in, size_t in_len, unsigned char *out, const b64_alphabet *alphabet);
+
+static size_t b64_encode_scalar(const unsigned char *in, size_t in_len, unsigned char *out, const b64_alphabet *alphabet) {
+    const unsigned char *chr = alphabet->chr;
+    size_t i = 0;
+
+    for (; i + 3 <= in_len; i += 3) {
+        unsigned int v = (in[i] << 16) | (in[i + 1] << 8) | in[i + 2];
+        *out++ = chr[(v >> 18) & 0x3F];
+        *out++ = chr[(v >> 12) & 0x3F];
+        *out++ = chr[(v >> 6) & 0x3F];
+        *out++ = chr[v & 0x3F];
+    }
+
+    return i;
+}
 
-    unsigned int i=0, j=0, k=0, s[3];
+static size_t b64_decode_scalar(const unsigned char *in, size_t in_len, unsigned char *out, const b64_alphabet *alphabet) {
+    const unsigned char *value = alphabet->value;
+    size_t i = 0;
 
-    for (i=0;i<in_len;i++) {
-        s[j++]=*(in+i);
-        if (j==3) {
-            out[k+0] = b64_chr[ (s[0]&255)>>2 ];
-            out[k+1] = b64_chr[ ((s[0]&0x03)<<4)+((s[1]&0xF0)>>4) ];
-            out[k+2] = b64_chr[ ((s[1]&0x0F)<<2)+((s[2]&0xC0)>>6) ];
-            out[k+3] = b64_chr[ s[2]&0x3F ];
-            j=0; k+=4;
+    for (; i + 4 <= in_len; i += 4) {
+        unsigned int a = value[in[i]], b = value[in[i + 1]], c = value[in[i + 2]], d = value[in[i + 3]];
+
+        // Every invalid character has the top bit set
+        if ((a | b | c | d) & 0x80) {
+            break;
         }
+
+        unsigned int v = (a << 18) | (b << 12) | (c << 6) | d;
+        *out++ = v >> 16;
+        *out++ = v >> 8;
+        *out++ = v;
     }
 
-    if (j) {
-        if (j==1)
-            s[1] = 0;
-        out[k+0] = b64_chr[ (s[0]&255)>>2 ];
-        out[k+1] = b64_chr[ ((s[0]&0x03)<<4)+((s[1]&0xF0)>>4) ];
-        if (j==2)
-            out[k+2] = b64_chr[ ((s[1]&0x0F)<<2) ];
-        else
-            out[k+2] = '=';
-        out[k+3] = '=';
-        k+=4;
+    return i;
+}
+
+#ifdef B64_SIMD
+/*
+ * Vectorised versions of the above, after Wojciech Muła and Alfred Klomp's
+ * SIMD base64 work (http://0x80.pl/articles/index.html#base64-algorithm-new).
+ *
+ * Encoding spreads each 3 byte group over 4 lanes with pshufb and a pair of
+ * multiplies to get the 6 bit indices, then maps index ranges onto ASCII with
+ * a 16 entry pshufb table of offsets.
+ *
+ * Decoding maps characters back to 6 bit values by comparing against the
+ * ranges of the alphabet, which also gives the validation mask, then packs
+ * 4 values into 3 bytes with two multiply-adds and a shuffle.
+ */
+__attribute__((target("ssse3")))
+static inline __m128i b64_enc_reshuffle_ssse3(__m128i in) {
+    in = _mm_shuffle_epi8(in, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+
+    __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0FC0FC00));
+    __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003F03F0));
+    __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+
+    return _mm_or_si128(t1, t3);
+}
+
+__attribute__((target("ssse3")))
+static inline __m128i b64_enc_translate_ssse3(__m128i indices, __m128i offsets) {
+    // 0-25 -> 13, 26-51 -> 0, 52-61 -> 1-10, 62 -> 11, 63 -> 12
+    __m128i slot = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    slot = _mm_or_si128(slot, _mm_and_si128(upper, _mm_set1_epi8(13)));
+
+    return _mm_add_epi8(_mm_shuffle_epi8(offsets, slot), indices);
+}
+
+__attribute__((target("ssse3")))
+static size_t b64_encode_ssse3(const unsigned char *in, size_t in_len, unsigned char *out, const b64_alphabet *alphabet) {
+    const __m128i offsets = _mm_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, alphabet->chr[62] - 62, alphabet->chr[63] - 63, 'A', 0, 0
+    );
+    size_t i = 0;
+
+    // Each block uses 12 bytes but loads 16
+    for (; i + 16 <= in_len; i += 12) {
+        __m128i block = _mm_loadu_si128((const __m128i *) (in + i));
+        block = b64_enc_translate_ssse3(b64_enc_reshuffle_ssse3(block), offsets);
+        _mm_storeu_si128((__m128i *) out, block);
+        out += 16;
     }
 
-    out[k] = '\0';
+    return i + b64_encode_scalar(in + i, in_len - i, out, alphabet);
+}
 
-    return k;
+__attribute__((target("ssse3")))
+static inline __m128i b64_in_range_ssse3(__m128i c, char low, char high) {
+    return _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8(low - 1)), _mm_cmpgt_epi8(_mm_set1_epi8(high + 1), c));
 }
 
-unsigned int b64_decode(const unsigned char* in, unsigned int in_len, unsigned char* out) {
+__attribute__((target("ssse3")))
+static size_t b64_decode_ssse3(const unsigned char *in, size_t in_len, unsigned char *out, const b64_alphabet *alphabet) {
+    const char c62 = alphabet->chr[62], c63 = alphabet->chr[63];
+    size_t i = 0;
 
-    unsigned int i=0, j=0, k=0, s[4];
+    // Each block writes 16 bytes of which 12 are output, so keep clear of the end of out
+    for (; i + 24 <= in_len; i += 16) {
+        __m128i c = _mm_loadu_si128((const __m128i *) (in + i));
 
-    for (i=0;i<in_len;i++) {
-        s[j++]=b64_int(*(in+i));
-        if (j==4) {
-            out[k+0] = ((s[0]&255)<<2)+((s[1]&0x30)>>4);
-            if (s[2]!=64) {
-                out[k+1] = ((s[1]&0x0F)<<4)+((s[2]&0x3C)>>2);
-                if ((s[3]!=64)) {
-                    out[k+2] = ((s[2]&0x03)<<6)+(s[3]); k+=3;
-                } else {
-                    k+=2;
-                }
-            } else {
-                k+=1;
-            }
-            j=0;
+        __m128i upper = b64_in_range_ssse3(c, 'A', 'Z');
+        __m128i lower = b64_in_range_ssse3(c, 'a', 'z');
+        __m128i digit = b64_in_range_ssse3(c, '0', '9');
+        __m128i is62 = _mm_cmpeq_epi8(c, _mm_set1_epi8(c62));
+        __m128i is63 = _mm_cmpeq_epi8(c, _mm_set1_epi8(c63));
+
+        __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, _mm_or_si128(is62, is63)));
+        if (_mm_movemask_epi8(valid) != 0xFFFF) {
+            break;
+        }
+
+        __m128i shift = _mm_and_si128(upper, _mm_set1_epi8(-'A'));
+        shift = _mm_or_si128(shift, _mm_and_si128(lower, _mm_set1_epi8(26 - 'a')));
+        shift = _mm_or_si128(shift, _mm_and_si128(digit, _mm_set1_epi8(52 - '0')));
+        shift = _mm_or_si128(shift, _mm_and_si128(is62, _mm_set1_epi8(62 - c62)));
+        shift = _mm_or_si128(shift, _mm_and_si128(is63, _mm_set1_epi8(63 - c63)));
+        __m128i values = _mm_add_epi8(c, shift);
+
+        __m128i merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+        merged = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+        merged = _mm_shuffle_epi8(merged, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+
+        _mm_storeu_si128((__m128i *) out, merged);
+        out += 12;
+    }
+
+    return i + b64_decode_scalar(in + i, in_len - i, out, alphabet);
+}
+
+__attribute__((target("avx2")))
+static size_t b64_encode_avx2(const unsigned char *in, size_t in_len, unsigned char *out, const b64_alphabet *alphabet) {
+    const __m256i offsets = _mm256_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, alphabet->chr[62] - 62, alphabet->chr[63] - 63, 'A', 0, 0,
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, alphabet->chr[62] - 62, alphabet->chr[63] - 63, 'A', 0, 0
+    );
+    const __m256i spread = _mm256_setr_epi8(
+        1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+        1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10
+    );
+    size_t i = 0;
+
+    // Each lane takes 12 bytes, the second lane's load reads 4 past the 24 used
+    for (; i + 28 <= in_len; i += 24) {
+        __m256i block = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *) (in + i))),
+            _mm_loadu_si128((const __m128i *) (in + i + 12)), 1
+        );
+
+        block = _mm256_shuffle_epi8(block, spread);
+        __m256i t0 = _mm256_and_si256(block, _mm256_set1_epi32(0x0FC0FC00));
+        __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        __m256i t2 = _mm256_and_si256(block, _mm256_set1_epi32(0x003F03F0));
+        __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+        __m256i indices = _mm256_or_si256(t1, t3);
+
+        __m256i slot = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+        slot = _mm256_or_si256(slot, _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+
+        _mm256_storeu_si256((__m256i *) out, _mm256_add_epi8(_mm256_shuffle_epi8(offsets, slot), indices));
+        out += 32;
+    }
+
+    return i + b64_encode_ssse3(in + i, in_len - i, out, alphabet);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i b64_in_range_avx2(__m256i c, char low, char high) {
+    return _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8(low - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8(high + 1), c));
+}
+
+__attribute__((target("avx2")))
+static size_t b64_decode_avx2(const unsigned char *in, size_t in_len, unsigned char *out, const b64_alphabet *alphabet) {
+    const char c62 = alphabet->chr[62], c63 = alphabet->chr[63];
+    const __m256i pack = _mm256_setr_epi8(
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1
+    );
+    size_t i = 0;
+
+    // Each block writes 32 bytes of which 24 are output, so keep clear of the end of out
+    for (; i + 48 <= in_len; i += 32) {
+        __m256i c = _mm256_loadu_si256((const __m256i *) (in + i));
+
+        __m256i upper = b64_in_range_avx2(c, 'A', 'Z');
+        __m256i lower = b64_in_range_avx2(c, 'a', 'z');
+        __m256i digit = b64_in_range_avx2(c, '0', '9');
+        __m256i is62 = _mm256_cmpeq_epi8(c, _mm256_set1_epi8(c62));
+        __m256i is63 = _mm256_cmpeq_epi8(c, _mm256_set1_epi8(c63));
+
+        __m256i valid = _mm256_or_si256(_mm256_or_si256(upper, lower), _mm256_or_si256(digit, _mm256_or_si256(is62, is63)));
+        if (_mm256_movemask_epi8(valid) != -1) {
+            break;
+        }
+
+        __m256i shift = _mm256_and_si256(upper, _mm256_set1_epi8(-'A'));
+        shift = _mm256_or_si256(shift, _mm256_and_si256(lower, _mm256_set1_epi8(26 - 'a')));
+        shift = _mm256_or_si256(shift, _mm256_and_si256(digit, _mm256_set1_epi8(52 - '0')));
+        shift = _mm256_or_si256(shift, _mm256_and_si256(is62, _mm256_set1_epi8(62 - c62)));
+        shift = _mm256_or_si256(shift, _mm256_and_si256(is63, _mm256_set1_epi8(63 - c63)));
+        __m256i values = _mm256_add_epi8(c, shift);
+
+        __m256i merged = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+        merged = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+        merged = _mm256_shuffle_epi8(merged, pack);
+        merged = _mm256_permutevar8x32_epi32(merged, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+
+        _mm256_storeu_si256((__m256i *) out, merged);
+        out += 24;
+    }
+
+    return i + b64_decode_ssse3(in + i, in_len - i, out, alphabet);
+}
+#endif
+
+static size_t b64_encode_dispatch(const unsigned char *in, size_t in_len, unsigned char *out, const b64_alphabet *alphabet);
+static size_t b64_decode_dispatch(const unsigned char *in, size_t in_len, unsigned char *out, const b64_alphabet *alphabet);
+
+static b64_bulk_fn b64_encode_bulk = b64_encode_dispatch;
+static b64_bulk_fn b64_decode_bulk = b64_decode_dispatch;
+
+static void b64_select(void) {
+    b64_encode_bulk = b64_encode_scalar;
+    b64_decode_bulk = b64_decode_scalar;
+
+#ifdef B64_SIMD
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) {
+        b64_encode_bulk = b64_encode_avx2;
+        b64_decode_bulk = b64_decode_avx2;
+    } else if (__builtin_cpu_supports("ssse3")) {
+        b64_encode_bulk = b64_encode_ssse3;
+        b64_decode_bulk = b64_decode_ssse3;
+    }
+#endif
+}
+
+static size_t b64_encode_dispatch(const unsigned char *in, size_t in_len, unsigned char *out, const b64_alphabet *alphabet) {
+    b64_select();
+    return b64_encode_bulk(in, in_len, out, alphabet);
+}
+
+static size_t b64_decode_dispatch(const unsigned char *in, size_t in_len, unsigned char *out, const b64_alphabet *alphabet) {
+    b64_select();
+    return b64_decode_bulk(in, in_len, out, alphabet);
+}
+
+size_t b64_encode_alphabet(const unsigned char* in, size_t in_len, unsigned char* out, int url_safe) {
+    const b64_alphabet *alphabet = b64_get_alphabet(url_safe);
+    const unsigned char *chr = alphabet->chr;
+
+    size_t done = b64_encode_bulk(in, in_len, out, alphabet);
+    size_t k = done / 3 * 4;
+    size_t rest = in_len - done;
+
+    if (rest) {
+        unsigned int v = in[done] << 16;
+        if (rest == 2)
+            v |= in[done + 1] << 8;
+
+        out[k++] = chr[(v >> 18) & 0x3F];
+        out[k++] = chr[(v >> 12) & 0x3F];
+
+        if (rest == 2)
+            out[k++] = chr[(v >> 6) & 0x3F];
+
+        if (!url_safe) {
+            if (rest == 1)
+                out[k++] = '=';
+            out[k++] = '=';
         }
     }
 
     return k;
 }
 
+long b64_decode_alphabet(const unsigned char* in, size_t in_len, unsigned char* out, int url_safe) {
+    const b64_alphabet *alphabet = b64_get_alphabet(url_safe);
+    const unsigned char *value = alphabet->value;
+
+    // Padding is only allowed to round the input up to a whole group of 4
+    if (in_len % 4 == 0 && in_len > 0 && in[in_len - 1] == '=') {
+        in_len--;
+        if (in[in_len - 1] == '=')
+            in_len--;
+    }
+
+    size_t rest = in_len % 4;
+    if (rest == 1)
+        return -1;
+
+    size_t whole = in_len - rest;
+    size_t done = b64_decode_bulk(in, whole, out, alphabet);
+
+    // The bulk decoders stop at the first group holding an invalid character
+    if (done != whole)
+        return -1;
+
+    size_t k = done / 4 * 3;
+
+    if (rest) {
+        unsigned int a = value[in[done]], b = value[in[done + 1]];
+        unsigned int c = rest == 3 ? value[in[done + 2]] : 0;
+
+        if ((a | b | c) & 0x80)
+            return -1;
+
+        unsigned int v = (a << 18) | (b << 12) | (c << 6);
+        out[k++] = v >> 16;
+        if (rest == 3)
+            out[k++] = v >> 8;
+    }
+
+    return k;
+}
+
+unsigned int b64_encode(const unsigned char* in, unsigned int in_len, unsigned char* out) {
+
+    unsigned int k = b64_encode_alphabet(in, in_len, out, 0);
+    out[k] = '\0';
+
+    return k;
+}
+
+unsigned int b64_decode(const unsigned char* in, unsigned int in_len, unsigned char* out) {
+
+    long k = b64_decode_alphabet(in, in_len, out, 0);
+
+    return k < 0 ? 0 : k;
+}
+
 unsigned int b64_encodef(char *InFile, char *OutFile) {
 
     FILE *pInFile = fopen(InFile,"rb");
@@ -9,6 +9,7 @@
 */
 
 #include <stdio.h>
+#include <stddef.h>
 
 //Base64 char table function - used internally for decoding
 unsigned int b64_int(unsigned int ch);
@@ -33,6 +34,16 @@ unsigned int b64_encode(const unsigned char* in, unsigned int in_len, unsigned c
 // returns size of output excluding null byte
 unsigned int b64_decode(const unsigned char* in, unsigned int in_len, unsigned char* out);
 
+// As b64_encode, but url_safe selects the RFC 4648 URL and filename safe alphabet ("-_"), which is
+// written without padding. out needs b64e_size(in_len) bytes, no null byte is written.
+// returns size of output
+size_t b64_encode_alphabet(const unsigned char* in, size_t in_len, unsigned char* out, int url_safe);
+
+// As b64_decode, but url_safe selects the URL and filename safe alphabet. Padding is optional.
+// out needs b64d_size(in_len) bytes.
+// returns size of output, or -1 if the input is not valid base64
+long b64_decode_alphabet(const unsigned char* in, size_t in_len, unsigned char* out, int url_safe);
+
 // file-version b64_encode
 // Input : filenames
 // returns size of output
@@ -41,4 +52,4 @@ unsigned int b64_encodef(char *InFile, char *OutFile);
 // file-version b64_decode
 // Input : filenames
 // returns size of output
-unsigned int b64_decodef(char *InFile, char *OutFile);
\ No newline at end of file
+unsigned int b64_decodef(char *InFile, char *OutFile);
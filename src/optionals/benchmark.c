@@ -0,0 +1,316 @@
+#include "benchmark.h"
+
+// Batches are grown until one takes at least the sample time, but never by more than this per step
+#define MAX_GROWTH 10
+#define MAX_SAMPLES 10000
+
+typedef struct {
+    double warmup;      // Seconds spent calling the function before measuring
+    int samples;        // Number of timed batches
+    double sampleTime;  // Seconds each batch should take
+    double iterations;  // Calls per batch, 0 to pick it from sampleTime
+} BenchmarkOptions;
+
+static bool getOption(DictuVM *vm, ObjDict *dict, const char *key, double *value) {
+    Value result;
+
+    if (!dictGet(dict, OBJ_VAL(copyString(vm, key, strlen(key))), &result)) {
+        return true;
+    }
+
+    if (!IS_NUMBER(result) || AS_NUMBER(result) < 0) {
+        runtimeError(vm, "run() option \"%s\" must be a non-negative number.", key);
+        return false;
+    }
+
+    *value = AS_NUMBER(result);
+    return true;
+}
+
+static bool getOptions(DictuVM *vm, Value value, BenchmarkOptions *options) {
+    options->warmup = 0.1;
+    options->samples = 30;
+    options->sampleTime = 0.01;
+    options->iterations = 0;
+
+    if (IS_NIL(value)) {
+        return true;
+    }
+
+    if (!IS_DICT(value)) {
+        runtimeError(vm, "run() options must be a dictionary.");
+        return false;
+    }
+
+    ObjDict *dict = AS_DICT(value);
+    double samples = options->samples;
+
+    if (!getOption(vm, dict, "warmup", &options->warmup) ||
+        !getOption(vm, dict, "samples", &samples) ||
+        !getOption(vm, dict, "sampleTime", &options->sampleTime) ||
+        !getOption(vm, dict, "iterations", &options->iterations)) {
+        return false;
+    }
+
+    if (samples < 1 || samples > MAX_SAMPLES) {
+        runtimeError(vm, "run() option \"samples\" must be between 1 and %d.", MAX_SAMPLES);
+        return false;
+    }
+
+    options->samples = samples;
+    options->iterations = floor(options->iterations);
+
+    return true;
+}
+
+/**
+ * Calls the function iterations times and returns the elapsed nanoseconds,
+ * or a negative number if the function raised a runtime error.
+ */
+static double timeBatch(DictuVM *vm, Value function, double iterations) {
+    uint64_t start = monotonicNs();
+
+    for (double i = 0; i < iterations; ++i) {
+        if (IS_EMPTY(callFunction(vm, function, 0, NULL))) {
+            return -1;
+        }
+    }
+
+    return (double) (monotonicNs() - start);
+}
+
+static int compareDoubles(const void *a, const void *b) {
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+
+    return (x > y) - (x < y);
+}
+
+// Linear interpolation between the closest ranks of a sorted array
+static double percentileOf(const double *sorted, int count, double percent) {
+    double rank = percent / 100 * (count - 1);
+    int lower = rank;
+    int upper = lower + 1 < count ? lower + 1 : lower;
+
+    return sorted[lower] + (sorted[upper] - sorted[lower]) * (rank - lower);
+}
+
+static void setNumber(DictuVM *vm, ObjDict *dict, const char *key, double value) {
+    Value keyValue = OBJ_VAL(copyString(vm, key, strlen(key)));
+    push(vm, keyValue);
+    dictSet(vm, dict, keyValue, NUMBER_VAL(value));
+    pop(vm);
+}
+
+/**
+ * Tukey's fences: samples more than 1.5 interquartile ranges outside the
+ * quartiles are treated as noise (a GC cycle, a context switch) and dropped.
+ * Returns the number of samples kept, which are moved to the front.
+ */
+static int rejectOutliers(double *sorted, int count) {
+    if (count < 4) {
+        return count;
+    }
+
+    double lowerQuartile = percentileOf(sorted, count, 25);
+    double upperQuartile = percentileOf(sorted, count, 75);
+    double range = upperQuartile - lowerQuartile;
+    double low = lowerQuartile - 1.5 * range;
+    double high = upperQuartile + 1.5 * range;
+
+    int kept = 0;
+    for (int i = 0; i < count; ++i) {
+        if (sorted[i] >= low && sorted[i] <= high) {
+            sorted[kept++] = sorted[i];
+        }
+    }
+
+    return kept;
+}
+
+static Value runBenchmark(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 2 && argCount != 3) {
+        runtimeError(vm, "run() takes 2 or 3 arguments (%d given).", argCount);
+        return EMPTY_VAL;
+    }
+
+    if (!IS_STRING(args[0])) {
+        runtimeError(vm, "run() first argument must be a string.");
+        return EMPTY_VAL;
+    }
+
+    Value function = args[1];
+
+    if (!IS_CLOSURE(function) && !IS_BOUND_METHOD(function) && !IS_NATIVE(function)) {
+        runtimeError(vm, "run() second argument must be a function.");
+        return EMPTY_VAL;
+    }
+
+    BenchmarkOptions options;
+    if (!getOptions(vm, argCount == 3 ? args[2] : NIL_VAL, &options)) {
+        return EMPTY_VAL;
+    }
+
+    double sampleNs = options.sampleTime * 1e9;
+    double warmupNs = options.warmup * 1e9;
+    uint64_t warmupStart = monotonicNs();
+
+    do {
+        if (timeBatch(vm, function, 1) < 0) {
+            return EMPTY_VAL;
+        }
+    } while ((double) (monotonicNs() - warmupStart) < warmupNs);
+
+    double iterations = options.iterations;
+
+    if (iterations < 1) {
+        iterations = 1;
+
+        for (;;) {
+            double elapsed = timeBatch(vm, function, iterations);
+
+            if (elapsed < 0) {
+                return EMPTY_VAL;
+            }
+
+            if (elapsed >= sampleNs) {
+                break;
+            }
+
+            double scale = elapsed > 0 ? sampleNs / elapsed : MAX_GROWTH;
+            iterations = ceil(iterations * (scale < MAX_GROWTH ? scale : MAX_GROWTH));
+        }
+    }
+
+    double *samples = ALLOCATE(vm, double, options.samples);
+
+    for (int i = 0; i < options.samples; ++i) {
+        double elapsed = timeBatch(vm, function, iterations);
+
+        if (elapsed < 0) {
+            FREE_ARRAY(vm, double, samples, options.samples);
+            return EMPTY_VAL;
+        }
+
+        samples[i] = elapsed / iterations;
+    }
+
+    qsort(samples, options.samples, sizeof(double), compareDoubles);
+    int kept = rejectOutliers(samples, options.samples);
+
+    double sum = 0;
+    for (int i = 0; i < kept; ++i) {
+        sum += samples[i];
+    }
+
+    double mean = sum / kept;
+    double squares = 0;
+    for (int i = 0; i < kept; ++i) {
+        squares += (samples[i] - mean) * (samples[i] - mean);
+    }
+
+    ObjDict *result = initDict(vm);
+    push(vm, OBJ_VAL(result));
+
+    Value nameKey = OBJ_VAL(copyString(vm, "name", 4));
+    push(vm, nameKey);
+    dictSet(vm, result, nameKey, args[0]);
+    pop(vm);
+
+    setNumber(vm, result, "iterations", iterations);
+    setNumber(vm, result, "samples", kept);
+    setNumber(vm, result, "outliers", options.samples - kept);
+    setNumber(vm, result, "mean", mean);
+    setNumber(vm, result, "median", percentileOf(samples, kept, 50));
+    setNumber(vm, result, "p99", percentileOf(samples, kept, 99));
+    setNumber(vm, result, "min", samples[0]);
+    setNumber(vm, result, "max", samples[kept - 1]);
+    setNumber(vm, result, "stddev", kept > 1 ? sqrt(squares / (kept - 1)) : 0);
+    setNumber(vm, result, "opsPerSec", mean > 0 ? 1e9 / mean : INFINITY);
+
+    pop(vm);
+    FREE_ARRAY(vm, double, samples, options.samples);
+
+    return OBJ_VAL(result);
+}
+
+static int formatDuration(char *buffer, size_t size, double ns) {
+    if (ns < 1e3) {
+        return snprintf(buffer, size, "%.2fns", ns);
+    } else if (ns < 1e6) {
+        return snprintf(buffer, size, "%.2fus", ns / 1e3);
+    } else if (ns < 1e9) {
+        return snprintf(buffer, size, "%.2fms", ns / 1e6);
+    }
+
+    return snprintf(buffer, size, "%.2fs", ns / 1e9);
+}
+
+static bool getNumber(DictuVM *vm, ObjDict *dict, const char *key, double *value) {
+    Value result;
+
+    if (!dictGet(dict, OBJ_VAL(copyString(vm, key, strlen(key))), &result) || !IS_NUMBER(result)) {
+        runtimeError(vm, "format() argument is missing \"%s\", pass the result of run().", key);
+        return false;
+    }
+
+    *value = AS_NUMBER(result);
+    return true;
+}
+
+static Value formatBenchmark(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 1) {
+        runtimeError(vm, "format() takes 1 argument (%d given).", argCount);
+        return EMPTY_VAL;
+    }
+
+    if (!IS_DICT(args[0])) {
+        runtimeError(vm, "format() argument must be a dictionary.");
+        return EMPTY_VAL;
+    }
+
+    ObjDict *result = AS_DICT(args[0]);
+    Value name;
+
+    if (!dictGet(result, OBJ_VAL(copyString(vm, "name", 4)), &name) || !IS_STRING(name)) {
+        runtimeError(vm, "format() argument is missing \"name\", pass the result of run().");
+        return EMPTY_VAL;
+    }
+
+    double mean, median, p99, opsPerSec;
+    if (!getNumber(vm, result, "mean", &mean) || !getNumber(vm, result, "median", &median) ||
+        !getNumber(vm, result, "p99", &p99) || !getNumber(vm, result, "opsPerSec", &opsPerSec)) {
+        return EMPTY_VAL;
+    }
+
+    char meanText[32], medianText[32], p99Text[32];
+    formatDuration(meanText, sizeof(meanText), mean);
+    formatDuration(medianText, sizeof(medianText), median);
+    formatDuration(p99Text, sizeof(p99Text), p99);
+
+    int length = snprintf(NULL, 0, "%s: mean %s, median %s, p99 %s, %.0f ops/sec",
+                          AS_CSTRING(name), meanText, medianText, p99Text, opsPerSec);
+    char *buffer = ALLOCATE(vm, char, length + 1);
+    snprintf(buffer, length + 1, "%s: mean %s, median %s, p99 %s, %.0f ops/sec",
+             AS_CSTRING(name), meanText, medianText, p99Text, opsPerSec);
+
+    return OBJ_VAL(takeString(vm, buffer, length));
+}
+
+ObjModule *createBenchmarkModule(DictuVM *vm) {
+    ObjString *name = copyString(vm, "Benchmark", 9);
+    push(vm, OBJ_VAL(name));
+    ObjModule *module = newModule(vm, name);
+    push(vm, OBJ_VAL(module));
+
+    /**
+     * Define Benchmark methods
+     */
+    defineNative(vm, &module->values, "run", runBenchmark);
+    defineNative(vm, &module->values, "format", formatBenchmark);
+
+    pop(vm);
+    pop(vm);
+
+    return module;
+}
@@ -0,0 +1,12 @@
+#ifndef dictu_benchmark_h
+#define dictu_benchmark_h
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "optionals.h"
+#include "../vm/vm.h"
+
+ObjModule *createBenchmarkModule(DictuVM *vm);
+
+#endif //dictu_benchmark_h
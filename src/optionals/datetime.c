@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <math.h>
 
 #include "datetime.h"
 
@@ -11,6 +12,110 @@
 #define HAS_STRPTIME
 #endif
 
+#define MILLIS_PER_DAY 86400000LL
+// Number of distinct strftime() formats remembered per VM
+#define FORMAT_CACHE_SIZE 8
+// Longest output of a single directive handled without libc, a 64-bit year and its sign
+#define FORMAT_MAX_DIRECTIVE 21
+
+/**
+ * A strftime() format split into literal runs and directives. Formats made up
+ * entirely of numeric directives are written directly, anything else (names,
+ * locale formats, timezones) is handed to libc.
+ */
+typedef struct {
+    char directive; // 0 for a literal run of the format
+    int start;
+    int length;
+} FormatOp;
+
+typedef struct {
+    char *format;
+    int length;
+    FormatOp *ops;
+    int opCount;
+    bool native;
+    int size; // Buffer size libc needed last time
+} FormatEntry;
+
+typedef struct {
+    FormatEntry entries[FORMAT_CACHE_SIZE];
+    int count;
+    int next;
+} FormatCache;
+
+#define AS_FORMAT_CACHE(v) ((FormatCache *)AS_ABSTRACT(v)->data)
+
+/**
+ * Proleptic Gregorian calendar conversions, from Howard Hinnant's
+ * "chrono-Compatible Low-Level Date Algorithms". These avoid gmtime/timegm and
+ * the timezone machinery behind them.
+ */
+static long long daysFromCivil(long long year, int month, int day) {
+    year -= month <= 2;
+    long long era = (year >= 0 ? year : year - 399) / 400;
+    long long yearOfEra = year - era * 400;
+    long long dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    long long dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+
+    return era * 146097 + dayOfEra - 719468;
+}
+
+static void civilFromDays(long long days, long long *year, int *month, int *day) {
+    days += 719468;
+    long long era = (days >= 0 ? days : days - 146096) / 146097;
+    long long dayOfEra = days - era * 146097;
+    long long yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    long long dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    long long monthIndex = (5 * dayOfYear + 2) / 153;
+
+    *day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+    *month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+    *year = yearOfEra + era * 400 + (*month <= 2);
+}
+
+static bool isLeapYear(long long year) {
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+static int daysInMonth(long long year, int month) {
+    static const int days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+    return month == 2 && isLeapYear(year) ? 29 : days[month - 1];
+}
+
+static long long floorDivide(long long a, long long b) {
+    long long quotient = a / b;
+
+    return (a % b != 0 && (a < 0) != (b < 0)) ? quotient - 1 : quotient;
+}
+
+static char *writeDigits(char *out, long long value, int width) {
+    char digits[FORMAT_MAX_DIRECTIVE];
+    int count = 0;
+    bool negative = value < 0;
+    unsigned long long magnitude = negative ? -(unsigned long long) value : (unsigned long long) value;
+
+    do {
+        digits[count++] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude != 0);
+
+    if (negative) {
+        *out++ = '-';
+    }
+
+    while (count < width--) {
+        *out++ = '0';
+    }
+
+    while (count > 0) {
+        *out++ = digits[--count];
+    }
+
+    return out;
+}
+
 static Value nowNative(DictuVM *vm, int argCount, Value *args) {
     UNUSED(args);
 
@@ -49,6 +154,200 @@ static Value nowUTCNative(DictuVM *vm, int argCount, Value *args) {
     return OBJ_VAL(copyString(vm, time, strlen(time) - 1));
 }
 
+static Value nowEpochNative(DictuVM *vm, int argCount, Value *args) {
+    UNUSED(args);
+
+    if (argCount != 0) {
+        runtimeError(vm, "nowEpoch() takes no arguments (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+
+    return NUMBER_VAL((double) ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+static void freeFormatCache(DictuVM *vm, ObjAbstract *abstract) {
+    FormatCache *cache = abstract->data;
+
+    for (int i = 0; i < cache->count; ++i) {
+        FREE_ARRAY(vm, char, cache->entries[i].format, cache->entries[i].length + 1);
+        FREE_ARRAY(vm, FormatOp, cache->entries[i].ops, cache->entries[i].length);
+    }
+
+    FREE(vm, FormatCache, cache);
+}
+
+static Value newFormatCache(DictuVM *vm) {
+    ObjAbstract *abstract = initAbstract(vm, freeFormatCache);
+    push(vm, OBJ_VAL(abstract));
+
+    FormatCache *cache = ALLOCATE(vm, FormatCache, 1);
+    cache->count = 0;
+    cache->next = 0;
+    abstract->data = cache;
+
+    pop(vm);
+
+    return OBJ_VAL(abstract);
+}
+
+static void compileFormat(FormatEntry *entry) {
+    entry->opCount = 0;
+    entry->native = false;
+
+    int literalStart = 0;
+
+    for (int i = 0; i < entry->length; ++i) {
+        if (entry->format[i] != '%') {
+            continue;
+        }
+
+        if (i > literalStart) {
+            entry->ops[entry->opCount++] = (FormatOp) {0, literalStart, i - literalStart};
+        }
+
+        char directive = i + 1 < entry->length ? entry->format[i + 1] : '\0';
+
+        switch (directive) {
+            case 'Y': case 'y': case 'm': case 'd': case 'e': case 'j':
+            case 'H': case 'M': case 'S': case 'F': case 'T':
+                entry->ops[entry->opCount++] = (FormatOp) {directive, i, 2};
+                break;
+
+            case '%':
+                entry->ops[entry->opCount++] = (FormatOp) {0, i + 1, 1};
+                break;
+
+            default:
+                entry->native = true;
+                return;
+        }
+
+        i++;
+        literalStart = i + 1;
+    }
+
+    if (entry->length > literalStart) {
+        entry->ops[entry->opCount++] = (FormatOp) {0, literalStart, entry->length - literalStart};
+    }
+}
+
+static FormatEntry *getFormat(DictuVM *vm, ObjModule *module, ObjString *format) {
+    Value value;
+    tableGet(&module->values, copyString(vm, "__formats__", 11), &value);
+    FormatCache *cache = AS_FORMAT_CACHE(value);
+
+    for (int i = 0; i < cache->count; ++i) {
+        FormatEntry *entry = &cache->entries[i];
+
+        if (entry->length == format->length && memcmp(entry->format, format->chars, format->length) == 0) {
+            return entry;
+        }
+    }
+
+    FormatEntry *entry = &cache->entries[cache->next];
+
+    if (cache->count < FORMAT_CACHE_SIZE) {
+        cache->count++;
+    } else {
+        FREE_ARRAY(vm, char, entry->format, entry->length + 1);
+        FREE_ARRAY(vm, FormatOp, entry->ops, entry->length);
+    }
+
+    cache->next = (cache->next + 1) % FORMAT_CACHE_SIZE;
+
+    // Keep the entry valid for freeFormatCache should either allocation collect
+    entry->format = NULL;
+    entry->ops = NULL;
+    entry->length = 0;
+
+    char *chars = ALLOCATE(vm, char, format->length + 1);
+    memcpy(chars, format->chars, format->length + 1);
+    FormatOp *ops = ALLOCATE(vm, FormatOp, format->length);
+
+    entry->format = chars;
+    entry->ops = ops;
+    entry->length = format->length;
+    entry->size = 0;
+    compileFormat(entry);
+
+    return entry;
+}
+
+static Value formatFast(DictuVM *vm, FormatEntry *entry, time_t t) {
+    long long days = floorDivide(t, 86400);
+    long long seconds = t - days * 86400;
+    long long year;
+    int month, day;
+    civilFromDays(days, &year, &month, &day);
+
+    int hour = seconds / 3600;
+    int minute = seconds / 60 % 60;
+    int second = seconds % 60;
+
+    int size = 1;
+    for (int i = 0; i < entry->opCount; ++i) {
+        size += entry->ops[i].directive == 0 ? entry->ops[i].length : FORMAT_MAX_DIRECTIVE + 6;
+    }
+
+    // Typical formats fit on the stack, only long ones need a heap buffer
+    char stackBuffer[256];
+    char *buffer = size <= (int) sizeof(stackBuffer) ? stackBuffer : ALLOCATE(vm, char, size);
+    char *out = buffer;
+
+    for (int i = 0; i < entry->opCount; ++i) {
+        FormatOp *op = &entry->ops[i];
+
+        switch (op->directive) {
+            case 0:
+                memcpy(out, entry->format + op->start, op->length);
+                out += op->length;
+                break;
+            case 'Y': out = writeDigits(out, year, 1); break;
+            case 'y': out = writeDigits(out, (year % 100 + 100) % 100, 2); break;
+            case 'm': out = writeDigits(out, month, 2); break;
+            case 'd': out = writeDigits(out, day, 2); break;
+            case 'e':
+                if (day < 10) {
+                    *out++ = ' ';
+                }
+                out = writeDigits(out, day, 1);
+                break;
+            case 'j': out = writeDigits(out, days - daysFromCivil(year, 1, 1) + 1, 3); break;
+            case 'H': out = writeDigits(out, hour, 2); break;
+            case 'M': out = writeDigits(out, minute, 2); break;
+            case 'S': out = writeDigits(out, second, 2); break;
+            case 'F':
+                out = writeDigits(out, year, 1);
+                *out++ = '-';
+                out = writeDigits(out, month, 2);
+                *out++ = '-';
+                out = writeDigits(out, day, 2);
+                break;
+            case 'T':
+                out = writeDigits(out, hour, 2);
+                *out++ = ':';
+                out = writeDigits(out, minute, 2);
+                *out++ = ':';
+                out = writeDigits(out, second, 2);
+                break;
+        }
+    }
+
+    int length = out - buffer;
+
+    if (buffer == stackBuffer) {
+        return OBJ_VAL(copyString(vm, buffer, length));
+    }
+
+    buffer = SHRINK_ARRAY(vm, buffer, char, size, length + 1);
+    buffer[length] = '\0';
+
+    return OBJ_VAL(takeString(vm, buffer, length));
+}
+
 static Value strftimeNative(DictuVM *vm, int argCount, Value *args) {
     if (argCount != 1 && argCount != 2) {
         runtimeError(vm, "strftime() takes 1 or 2 arguments (%d given)", argCount);
@@ -79,11 +378,21 @@ static Value strftimeNative(DictuVM *vm, int argCount, Value *args) {
     if (0 == format->length)
         return OBJ_VAL(copyString(vm, "", 0));
 
+    FormatEntry *entry = getFormat(vm, GET_SELF_CLASS, format);
+
+    if (!entry->native) {
+        return formatFast(vm, entry, t);
+    }
+
     char *fmt = format->chars;
 
     struct tm tictoc;
     int len = (format->length > 128 ? format->length * 4 : 128);
 
+    if (entry->size > len) {
+        len = entry->size;
+    }
+
     char *point = ALLOCATE(vm, char, len);
     if (point == NULL) {
         runtimeError(vm, "Memory error on strftime()!");
@@ -120,6 +429,7 @@ static Value strftimeNative(DictuVM *vm, int argCount, Value *args) {
     }
 
     int length = strlen(point);
+    entry->size = len;
 
     if (length != len) {
         point = SHRINK_ARRAY(vm, point, char, len, length + 1);
@@ -152,8 +462,223 @@ static Value strptimeNative(DictuVM *vm, int argCount, Value *args) {
 
     return NUMBER_VAL((double) mktime(&tictoc));
 }
+
+static Value strptimeEpochNative(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 2) {
+        runtimeError(vm, "strptimeEpoch() takes 2 arguments (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    if (!IS_STRING(args[0]) || !IS_STRING(args[1])) {
+        runtimeError(vm, "strptimeEpoch() arguments must be strings");
+        return EMPTY_VAL;
+    }
+
+    struct tm tictoc = {0};
+    tictoc.tm_mday = 1;
+
+    char *end = strptime(AS_CSTRING(args[1]), AS_CSTRING(args[0]), &tictoc);
+
+    if (end == NULL) {
+        return NIL_VAL;
+    }
+
+    long long days = daysFromCivil(tictoc.tm_year + 1900LL, tictoc.tm_mon + 1, tictoc.tm_mday);
+    long long seconds = days * 86400 + tictoc.tm_hour * 3600 + tictoc.tm_min * 60 + tictoc.tm_sec;
+
+    return NUMBER_VAL((double) seconds * 1000);
+}
 #endif
 
+static bool parseDigits(const char **cursor, const char *end, int count, int *out) {
+    const char *p = *cursor;
+
+    if (end - p < count) {
+        return false;
+    }
+
+    int value = 0;
+
+    for (int i = 0; i < count; ++i) {
+        if (p[i] < '0' || p[i] > '9') {
+            return false;
+        }
+
+        value = value * 10 + (p[i] - '0');
+    }
+
+    *cursor = p + count;
+    *out = value;
+
+    return true;
+}
+
+static bool expect(const char **cursor, const char *end, char c) {
+    if (*cursor < end && **cursor == c) {
+        (*cursor)++;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * Parses YYYY-MM-DD, optionally followed by T (or a space) and HH:MM[:SS[.fff]]
+ * and a Z or +HH[:MM] offset. Times without an offset are taken as UTC.
+ */
+static bool parseISO(const char *p, const char *end, double *millis) {
+    int year, month, day, hour = 0, minute = 0, second = 0, fraction = 0;
+
+    if (!parseDigits(&p, end, 4, &year) || !expect(&p, end, '-') ||
+        !parseDigits(&p, end, 2, &month) || !expect(&p, end, '-') ||
+        !parseDigits(&p, end, 2, &day)) {
+        return false;
+    }
+
+    if (month < 1 || month > 12 || day < 1 || day > daysInMonth(year, month)) {
+        return false;
+    }
+
+    long long offset = 0;
+
+    if (p < end && (*p == 'T' || *p == 't' || *p == ' ')) {
+        p++;
+
+        if (!parseDigits(&p, end, 2, &hour) || !expect(&p, end, ':') || !parseDigits(&p, end, 2, &minute)) {
+            return false;
+        }
+
+        if (expect(&p, end, ':')) {
+            if (!parseDigits(&p, end, 2, &second)) {
+                return false;
+            }
+
+            if (p < end && (*p == '.' || *p == ',')) {
+                p++;
+
+                int scale = 100;
+                const char *start = p;
+
+                // Anything finer than milliseconds is dropped
+                while (p < end && *p >= '0' && *p <= '9') {
+                    fraction += (*p - '0') * scale;
+                    scale /= 10;
+                    p++;
+                }
+
+                if (p == start) {
+                    return false;
+                }
+            }
+        }
+
+        // Allow a leap second through, it lands on the next minute
+        if (hour > 23 || minute > 59 || second > 60) {
+            return false;
+        }
+
+        if (p < end && (*p == 'Z' || *p == 'z')) {
+            p++;
+        } else if (p < end && (*p == '+' || *p == '-')) {
+            int sign = *p++ == '-' ? -1 : 1;
+            int offsetHours, offsetMinutes = 0;
+
+            if (!parseDigits(&p, end, 2, &offsetHours)) {
+                return false;
+            }
+
+            if (p < end) {
+                expect(&p, end, ':');
+
+                if (!parseDigits(&p, end, 2, &offsetMinutes)) {
+                    return false;
+                }
+            }
+
+            if (offsetHours > 23 || offsetMinutes > 59) {
+                return false;
+            }
+
+            offset = sign * (offsetHours * 3600 + offsetMinutes * 60);
+        }
+    }
+
+    if (p != end) {
+        return false;
+    }
+
+    long long seconds = daysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second - offset;
+    *millis = (double) (seconds * 1000 + fraction);
+
+    return true;
+}
+
+static Value parseISONative(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 1) {
+        runtimeError(vm, "parseISO() takes 1 argument (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    if (!IS_STRING(args[0])) {
+        runtimeError(vm, "parseISO() argument must be a string");
+        return EMPTY_VAL;
+    }
+
+    ObjString *string = AS_STRING(args[0]);
+    double millis;
+
+    if (!parseISO(string->chars, string->chars + string->length, &millis)) {
+        return NIL_VAL;
+    }
+
+    return NUMBER_VAL(millis);
+}
+
+static Value formatISONative(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 1) {
+        runtimeError(vm, "formatISO() takes 1 argument (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    if (!IS_NUMBER(args[0])) {
+        runtimeError(vm, "formatISO() argument must be a number");
+        return EMPTY_VAL;
+    }
+
+    double value = AS_NUMBER(args[0]);
+
+    // 0000-01-01 to 9999-12-31, the range ISO 8601 covers without expanded years
+    if (!(value >= -62167219200000.0 && value < 253402300800000.0)) {
+        runtimeError(vm, "formatISO() timestamp is out of range");
+        return EMPTY_VAL;
+    }
+
+    long long millis = (long long) floor(value);
+    long long days = floorDivide(millis, MILLIS_PER_DAY);
+    long long dayMillis = millis - days * MILLIS_PER_DAY;
+    long long year;
+    int month, day;
+    civilFromDays(days, &year, &month, &day);
+
+    char buffer[25];
+    char *out = writeDigits(buffer, year, 4);
+    *out++ = '-';
+    out = writeDigits(out, month, 2);
+    *out++ = '-';
+    out = writeDigits(out, day, 2);
+    *out++ = 'T';
+    out = writeDigits(out, dayMillis / 3600000, 2);
+    *out++ = ':';
+    out = writeDigits(out, dayMillis / 60000 % 60, 2);
+    *out++ = ':';
+    out = writeDigits(out, dayMillis / 1000 % 60, 2);
+    *out++ = '.';
+    out = writeDigits(out, dayMillis % 1000, 3);
+    *out++ = 'Z';
+
+    return OBJ_VAL(copyString(vm, buffer, out - buffer));
+}
+
 ObjModule *createDatetimeModule(DictuVM *vm) {
     ObjString *name = copyString(vm, "Datetime", 8);
     push(vm, OBJ_VAL(name));
@@ -166,15 +691,20 @@ ObjModule *createDatetimeModule(DictuVM *vm) {
     defineNative(vm, &module->values, "strerror", strerrorNative);
     defineNative(vm, &module->values, "now", nowNative);
     defineNative(vm, &module->values, "nowUTC", nowUTCNative);
+    defineNative(vm, &module->values, "nowEpoch", nowEpochNative);
     defineNative(vm, &module->values, "strftime", strftimeNative);
     #ifdef HAS_STRPTIME
     defineNative(vm, &module->values, "strptime", strptimeNative);
+    defineNative(vm, &module->values, "strptimeEpoch", strptimeEpochNative);
     #endif
+    defineNative(vm, &module->values, "parseISO", parseISONative);
+    defineNative(vm, &module->values, "formatISO", formatISONative);
 
     /**
      * Define Datetime properties
      */
     defineNativeProperty(vm, &module->values, "errno", NUMBER_VAL(0));
+    defineNativeProperty(vm, &module->values, "__formats__", newFormatCache(vm));
 
     pop(vm);
     pop(vm);
@@ -1,8 +1,332 @@
 #include "hashlib.h"
+#include <math.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+// Size of the chunks hashFile() reads
+#define HASH_FILE_BUFFER_SIZE 65536
+
+// Upper bound on the threads bcryptVerifyMany() will start
+#define BCRYPT_MAX_THREADS 64
+
+typedef enum {
+    HASH_SHA256,
+    HASH_XXH3,
+    HASH_XXH128
+} HashType;
+
+// Longest digest produced by any of the hashers
+#define MAX_DIGEST_SIZE TC_SHA256_DIGEST_SIZE
+
+typedef struct {
+    HashType type;
+    struct tc_sha256_state_struct sha256;
+    XXH3_state_t *xxh3;
+} Hasher;
+
+#define AS_HASHER(v) ((Hasher*)AS_ABSTRACT(v)->data)
+
+static void hexEncode(const uint8_t *digest, int length, char *buffer) {
+    static const char hex[] = "0123456789abcdef";
+
+    for (int i = 0; i < length; i++) {
+        buffer[i * 2] = hex[digest[i] >> 4];
+        buffer[i * 2 + 1] = hex[digest[i] & 0x0F];
+    }
+}
+
+// Returns false if the xxHash state can't be allocated
+static bool initHasher(Hasher *hasher, HashType type, uint64_t seed) {
+    hasher->type = type;
+    hasher->xxh3 = NULL;
+
+    switch (type) {
+        case HASH_SHA256: {
+            tc_sha256_init(&hasher->sha256);
+            break;
+        }
+
+        case HASH_XXH3: {
+            hasher->xxh3 = XXH3_createState();
+            if (hasher->xxh3 == NULL) {
+                return false;
+            }
+
+            XXH3_64bits_reset_withSeed(hasher->xxh3, seed);
+            break;
+        }
+
+        case HASH_XXH128: {
+            hasher->xxh3 = XXH3_createState();
+            if (hasher->xxh3 == NULL) {
+                return false;
+            }
+
+            XXH3_128bits_reset_withSeed(hasher->xxh3, seed);
+            break;
+        }
+    }
+
+    return true;
+}
+
+static void updateHasher(Hasher *hasher, const uint8_t *data, size_t length) {
+    switch (hasher->type) {
+        case HASH_SHA256: {
+            tc_sha256_update(&hasher->sha256, data, length);
+            break;
+        }
+
+        case HASH_XXH3: {
+            XXH3_64bits_update(hasher->xxh3, data, length);
+            break;
+        }
+
+        case HASH_XXH128: {
+            XXH3_128bits_update(hasher->xxh3, data, length);
+            break;
+        }
+    }
+}
+
+/**
+ * Writes the big endian digest of everything hashed so far and returns its length.
+ * The state is left untouched so the hasher can carry on being updated.
+ */
+static int digestHasher(Hasher *hasher, uint8_t *digest) {
+    switch (hasher->type) {
+        case HASH_SHA256: {
+            struct tc_sha256_state_struct state = hasher->sha256;
+            tc_sha256_final(digest, &state);
+            return TC_SHA256_DIGEST_SIZE;
+        }
+
+        case HASH_XXH3: {
+            XXH64_canonical_t canonical;
+            XXH64_canonicalFromHash(&canonical, XXH3_64bits_digest(hasher->xxh3));
+            memcpy(digest, canonical.digest, sizeof(canonical.digest));
+            return sizeof(canonical.digest);
+        }
+
+        case HASH_XXH128: {
+            XXH128_canonical_t canonical;
+            XXH128_canonicalFromHash(&canonical, XXH3_128bits_digest(hasher->xxh3));
+            memcpy(digest, canonical.digest, sizeof(canonical.digest));
+            return sizeof(canonical.digest);
+        }
+    }
+
+    return 0;
+}
+
+static void freeHasherState(Hasher *hasher) {
+    if (hasher->xxh3 != NULL) {
+        XXH3_freeState(hasher->xxh3);
+    }
+}
+
+static Value hexdigestValue(DictuVM *vm, Hasher *hasher) {
+    uint8_t digest[MAX_DIGEST_SIZE];
+    int length = digestHasher(hasher, digest);
+
+    char buffer[MAX_DIGEST_SIZE * 2];
+    hexEncode(digest, length, buffer);
+
+    return OBJ_VAL(copyString(vm, buffer, length * 2));
+}
+
+static Value updateHash(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 1) {
+        runtimeError(vm, "update() takes 1 argument (%d given).", argCount);
+        return EMPTY_VAL;
+    }
+
+    if (!IS_STRING(args[1])) {
+        runtimeError(vm, "Argument passed to update() must be a string.");
+        return EMPTY_VAL;
+    }
+
+    ObjString *string = AS_STRING(args[1]);
+    updateHasher(AS_HASHER(args[0]), (const uint8_t *) string->chars, string->length);
+
+    return args[0];
+}
+
+static Value digestHash(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 0) {
+        runtimeError(vm, "digest() takes no arguments (%d given).", argCount);
+        return EMPTY_VAL;
+    }
+
+    uint8_t digest[MAX_DIGEST_SIZE];
+    int length = digestHasher(AS_HASHER(args[0]), digest);
+
+    return OBJ_VAL(copyString(vm, (const char *) digest, length));
+}
+
+static Value hexdigestHash(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 0) {
+        runtimeError(vm, "hexdigest() takes no arguments (%d given).", argCount);
+        return EMPTY_VAL;
+    }
+
+    return hexdigestValue(vm, AS_HASHER(args[0]));
+}
+
+static void freeHash(DictuVM *vm, ObjAbstract *abstract) {
+    freeHasherState(abstract->data);
+    FREE(vm, Hasher, abstract->data);
+}
+
+static Value newHasher(DictuVM *vm, HashType type, uint64_t seed, const char *name) {
+    ObjAbstract *abstract = initAbstract(vm, freeHash);
+    push(vm, OBJ_VAL(abstract));
+
+    Hasher *hasher = ALLOCATE(vm, Hasher, 1);
+    bool initialised = initHasher(hasher, type, seed);
+    abstract->data = hasher;
+
+    if (!initialised) {
+        pop(vm);
+        runtimeError(vm, "Memory error on %s()!", name);
+        return EMPTY_VAL;
+    }
+
+    /**
+     * Setup hasher object methods
+     */
+    defineNative(vm, &abstract->values, "update", updateHash);
+    defineNative(vm, &abstract->values, "digest", digestHash);
+    defineNative(vm, &abstract->values, "hexdigest", hexdigestHash);
+    pop(vm);
+
+    return OBJ_VAL(abstract);
+}
+
+// Seeds are unsigned 64 bit integers, anything else would be undefined to convert
+static bool isSeed(double number) {
+    return number >= 0 && number < 18446744073709551616.0 && number == floor(number);
+}
+
+/**
+ * xxh3() and xxh128() either hash a string with an optional seed, or when not
+ * given a string return a hasher with an optional seed.
+ */
+static Value xxhash(DictuVM *vm, int argCount, Value *args, HashType type, const char *name) {
+    if (argCount > 2) {
+        runtimeError(vm, "%s() takes between 0 and 2 arguments (%d given).", name, argCount);
+        return EMPTY_VAL;
+    }
+
+    if (argCount == 0 || IS_NUMBER(args[0])) {
+        if (argCount == 2) {
+            runtimeError(vm, "Argument passed to %s() must be a string.", name);
+            return EMPTY_VAL;
+        }
+
+        if (argCount == 1 && !isSeed(AS_NUMBER(args[0]))) {
+            runtimeError(vm, "Seed passed to %s() must be a non-negative integer.", name);
+            return EMPTY_VAL;
+        }
+
+        return newHasher(vm, type, argCount == 1 ? (uint64_t) AS_NUMBER(args[0]) : 0, name);
+    }
+
+    if (!IS_STRING(args[0])) {
+        runtimeError(vm, "Argument passed to %s() must be a string.", name);
+        return EMPTY_VAL;
+    }
+
+    uint64_t seed = 0;
+
+    if (argCount == 2) {
+        if (!IS_NUMBER(args[1])) {
+            runtimeError(vm, "Seed passed to %s() must be a number.", name);
+            return EMPTY_VAL;
+        }
+
+        if (!isSeed(AS_NUMBER(args[1]))) {
+            runtimeError(vm, "Seed passed to %s() must be a non-negative integer.", name);
+            return EMPTY_VAL;
+        }
+
+        seed = (uint64_t) AS_NUMBER(args[1]);
+    }
+
+    ObjString *string = AS_STRING(args[0]);
+    uint8_t digest[MAX_DIGEST_SIZE];
+    int length;
+
+    if (type == HASH_XXH3) {
+        XXH64_canonical_t canonical;
+        XXH64_canonicalFromHash(&canonical, XXH3_64bits_withSeed(string->chars, string->length, seed));
+        memcpy(digest, canonical.digest, sizeof(canonical.digest));
+        length = sizeof(canonical.digest);
+    } else {
+        XXH128_canonical_t canonical;
+        XXH128_canonicalFromHash(&canonical, XXH3_128bits_withSeed(string->chars, string->length, seed));
+        memcpy(digest, canonical.digest, sizeof(canonical.digest));
+        length = sizeof(canonical.digest);
+    }
+
+    char buffer[MAX_DIGEST_SIZE * 2];
+    hexEncode(digest, length, buffer);
+
+    return OBJ_VAL(copyString(vm, buffer, length * 2));
+}
+
+static Value xxh3(DictuVM *vm, int argCount, Value *args) {
+    return xxhash(vm, argCount, args, HASH_XXH3, "xxh3");
+}
+
+static Value xxh128(DictuVM *vm, int argCount, Value *args) {
+    return xxhash(vm, argCount, args, HASH_XXH128, "xxh128");
+}
+
+static Value crc32cNative(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 1 && argCount != 2) {
+        runtimeError(vm, "crc32c() takes 1 or 2 arguments (%d given).", argCount);
+        return EMPTY_VAL;
+    }
+
+    if (!IS_STRING(args[0])) {
+        runtimeError(vm, "Argument passed to crc32c() must be a string.");
+        return EMPTY_VAL;
+    }
+
+    uint32_t crc = 0;
+
+    if (argCount == 2) {
+        if (!IS_NUMBER(args[1])) {
+            runtimeError(vm, "Checksum passed to crc32c() must be a number.");
+            return EMPTY_VAL;
+        }
+
+        double number = AS_NUMBER(args[1]);
+
+        if (!(number >= 0 && number <= UINT32_MAX && number == floor(number))) {
+            runtimeError(vm, "Checksum passed to crc32c() must be an unsigned 32 bit integer.");
+            return EMPTY_VAL;
+        }
+
+        crc = (uint32_t) number;
+    }
+
+    ObjString *string = AS_STRING(args[0]);
+
+    return NUMBER_VAL(crc32c(crc, (const uint8_t *) string->chars, string->length));
+}
 
 static Value sha256(DictuVM *vm, int argCount, Value *args) {
+    if (argCount == 0) {
+        return newHasher(vm, HASH_SHA256, 0, "sha256");
+    }
+
     if (argCount != 1) {
-        runtimeError(vm, "sha256() takes 1 argument (%d given).", argCount);
+        runtimeError(vm, "sha256() takes 0 or 1 arguments (%d given).", argCount);
         return EMPTY_VAL;
     }
 
@@ -28,13 +352,96 @@ static Value sha256(DictuVM *vm, int argCount, Value *args) {
         return NIL_VAL;
     }
 
-    char buffer[65];
+    char buffer[64];
+    hexEncode(digest, 32, buffer);
 
-    for (int i = 0; i < 32; i++ ) {
-        sprintf( buffer + i * 2, "%02x", digest[i] );
+    return OBJ_VAL(copyString(vm, buffer, 64));
+}
+
+static Value hashFile(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 1 && argCount != 2) {
+        runtimeError(vm, "hashFile() takes 1 or 2 arguments (%d given).", argCount);
+        return EMPTY_VAL;
     }
 
-    return OBJ_VAL(copyString(vm, buffer, 64));
+    if (!IS_STRING(args[0])) {
+        runtimeError(vm, "Argument passed to hashFile() must be a string.");
+        return EMPTY_VAL;
+    }
+
+    HashType type = HASH_SHA256;
+    bool checksum = false;
+
+    if (argCount == 2) {
+        if (!IS_STRING(args[1])) {
+            runtimeError(vm, "Algorithm passed to hashFile() must be a string.");
+            return EMPTY_VAL;
+        }
+
+        char *algorithm = AS_CSTRING(args[1]);
+
+        if (strcmp(algorithm, "xxh3") == 0) {
+            type = HASH_XXH3;
+        } else if (strcmp(algorithm, "xxh128") == 0) {
+            type = HASH_XXH128;
+        } else if (strcmp(algorithm, "crc32c") == 0) {
+            checksum = true;
+        } else if (strcmp(algorithm, "sha256") != 0) {
+            runtimeError(vm, "Unknown algorithm '%s' passed to hashFile().", algorithm);
+            return EMPTY_VAL;
+        }
+    }
+
+    FILE *file = fopen(AS_CSTRING(args[0]), "rb");
+
+    if (file == NULL) {
+        SET_ERRNO(GET_SELF_CLASS);
+        return NIL_VAL;
+    }
+
+    Hasher hasher;
+    uint32_t crc = 0;
+
+    if (!checksum && !initHasher(&hasher, type, 0)) {
+        fclose(file);
+        runtimeError(vm, "Memory error on hashFile()!");
+        return EMPTY_VAL;
+    }
+
+    uint8_t *buffer = ALLOCATE(vm, uint8_t, HASH_FILE_BUFFER_SIZE);
+    size_t read;
+
+    while ((read = fread(buffer, 1, HASH_FILE_BUFFER_SIZE, file)) > 0) {
+        if (checksum) {
+            crc = crc32c(crc, buffer, read);
+        } else {
+            updateHasher(&hasher, buffer, read);
+        }
+    }
+
+    bool failed = ferror(file);
+
+    FREE_ARRAY(vm, uint8_t, buffer, HASH_FILE_BUFFER_SIZE);
+    fclose(file);
+
+    if (failed) {
+        if (!checksum) {
+            freeHasherState(&hasher);
+        }
+
+        errno = EIO;
+        SET_ERRNO(GET_SELF_CLASS);
+        return NIL_VAL;
+    }
+
+    if (checksum) {
+        return NUMBER_VAL(crc);
+    }
+
+    Value result = hexdigestValue(vm, &hasher);
+    freeHasherState(&hasher);
+
+    return result;
 }
 
 static Value hmac(DictuVM *vm, int argCount, Value *args) {
@@ -70,11 +477,8 @@ static Value hmac(DictuVM *vm, int argCount, Value *args) {
     tc_hmac_final(digest, TC_SHA256_DIGEST_SIZE, &h);
 
     if (!raw) {
-        char buffer[65];
-
-        for (int i = 0; i < 32; i++ ) {
-            sprintf( buffer + i * 2, "%02x", digest[i] );
-        }
+        char buffer[64];
+        hexEncode(digest, 32, buffer);
 
         return OBJ_VAL(copyString(vm, buffer, 64));
     }
@@ -127,6 +531,162 @@ static Value bcryptVerify(DictuVM *vm, int argCount, Value *args) {
     return BOOL_VAL(bcrypt_checkpass(stringA->chars, stringB->chars) == 0);
 }
 
+typedef struct {
+    const char *password;
+    const char *hash;
+    bool matched;
+} VerifyJob;
+
+typedef struct {
+    VerifyJob *jobs;
+    int count;
+    int start;
+    int step;
+} VerifyWorker;
+
+static int cpuCount(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? count : 1;
+#endif
+}
+
+// Each worker takes every step-th job, bcrypt costs are near enough equal that this balances well
+#ifdef _WIN32
+static DWORD WINAPI verifyWorker(LPVOID arg) {
+#else
+static void *verifyWorker(void *arg) {
+#endif
+    VerifyWorker *worker = arg;
+
+    for (int i = worker->start; i < worker->count; i += worker->step) {
+        VerifyJob *job = &worker->jobs[i];
+        job->matched = bcrypt_checkpass(job->password, job->hash) == 0;
+    }
+
+    return 0;
+}
+
+static void runVerifyJobs(VerifyJob *jobs, int count, int threadCount) {
+    VerifyWorker workers[BCRYPT_MAX_THREADS];
+#ifdef _WIN32
+    HANDLE threads[BCRYPT_MAX_THREADS];
+#else
+    pthread_t threads[BCRYPT_MAX_THREADS];
+#endif
+    bool started[BCRYPT_MAX_THREADS];
+
+    // The calling thread runs the first share itself rather than sitting idle
+    for (int i = 0; i < threadCount; i++) {
+        workers[i] = (VerifyWorker) {jobs, count, i, threadCount};
+        started[i] = false;
+
+        if (i == 0) {
+            continue;
+        }
+
+#ifdef _WIN32
+        threads[i] = CreateThread(NULL, 0, verifyWorker, &workers[i], 0, NULL);
+        started[i] = threads[i] != NULL;
+#else
+        started[i] = pthread_create(&threads[i], NULL, verifyWorker, &workers[i]) == 0;
+#endif
+    }
+
+    for (int i = 0; i < threadCount; i++) {
+        if (!started[i]) {
+            verifyWorker(&workers[i]);
+        }
+    }
+
+    for (int i = 1; i < threadCount; i++) {
+        if (!started[i]) {
+            continue;
+        }
+
+#ifdef _WIN32
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+#else
+        pthread_join(threads[i], NULL);
+#endif
+    }
+}
+
+static Value bcryptVerifyMany(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 1 && argCount != 2) {
+        runtimeError(vm, "bcryptVerifyMany() takes 1 or 2 arguments (%d given).", argCount);
+        return EMPTY_VAL;
+    }
+
+    if (!IS_LIST(args[0])) {
+        runtimeError(vm, "Argument passed to bcryptVerifyMany() must be a list.");
+        return EMPTY_VAL;
+    }
+
+    int threadCount = cpuCount();
+
+    if (argCount == 2) {
+        if (!IS_NUMBER(args[1]) || !(AS_NUMBER(args[1]) >= 1)) {
+            runtimeError(vm, "Optional argument passed to bcryptVerifyMany() must be a positive number.");
+            return EMPTY_VAL;
+        }
+
+        // Clamped as a double, a large count would otherwise wrap when converted
+        threadCount = AS_NUMBER(args[1]) < BCRYPT_MAX_THREADS ? AS_NUMBER(args[1]) : BCRYPT_MAX_THREADS;
+    }
+
+    ObjList *pairs = AS_LIST(args[0]);
+    int count = pairs->values.count;
+
+    for (int i = 0; i < count; i++) {
+        Value pair = pairs->values.values[i];
+
+        if (!IS_LIST(pair) || AS_LIST(pair)->values.count != 2 ||
+            !IS_STRING(AS_LIST(pair)->values.values[0]) || !IS_STRING(AS_LIST(pair)->values.values[1])) {
+            runtimeError(vm, "bcryptVerifyMany() expects a list of [string, string] pairs.");
+            return EMPTY_VAL;
+        }
+    }
+
+    if (threadCount > count) {
+        threadCount = count;
+    }
+
+    if (threadCount > BCRYPT_MAX_THREADS) {
+        threadCount = BCRYPT_MAX_THREADS;
+    }
+
+    VerifyJob *jobs = ALLOCATE(vm, VerifyJob, count);
+
+    // The strings stay reachable through the argument list, and nothing
+    // allocates while the workers run, so they can read the chars directly
+    for (int i = 0; i < count; i++) {
+        ObjList *pair = AS_LIST(pairs->values.values[i]);
+        jobs[i].password = AS_CSTRING(pair->values.values[0]);
+        jobs[i].hash = AS_CSTRING(pair->values.values[1]);
+        jobs[i].matched = false;
+    }
+
+    runVerifyJobs(jobs, count, threadCount);
+
+    ObjList *results = initList(vm);
+    push(vm, OBJ_VAL(results));
+
+    for (int i = 0; i < count; i++) {
+        writeValueArray(vm, &results->values, BOOL_VAL(jobs[i].matched));
+    }
+
+    pop(vm);
+    FREE_ARRAY(vm, VerifyJob, jobs, count);
+
+    return OBJ_VAL(results);
+}
+
 static Value verify(DictuVM *vm, int argCount, Value *args) {
     if (argCount != 2) {
         runtimeError(vm, "verify() takes 2 arguments (%d given).", argCount);
@@ -159,10 +719,15 @@ ObjModule *createHashlibModule(DictuVM *vm) {
      */
     defineNative(vm, &module->values, "strerror", strerrorNative);
     defineNative(vm, &module->values, "sha256", sha256);
+    defineNative(vm, &module->values, "hashFile", hashFile);
+    defineNative(vm, &module->values, "xxh3", xxh3);
+    defineNative(vm, &module->values, "xxh128", xxh128);
+    defineNative(vm, &module->values, "crc32c", crc32cNative);
     defineNative(vm, &module->values, "hmac", hmac);
     defineNative(vm, &module->values, "bcrypt", bcrypt);
     defineNative(vm, &module->values, "verify", verify);
     defineNative(vm, &module->values, "bcryptVerify", bcryptVerify);
+    defineNative(vm, &module->values, "bcryptVerifyMany", bcryptVerifyMany);
 
     /**
      * Define Http properties
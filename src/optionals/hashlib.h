@@ -6,6 +6,9 @@
 #include "hashlib/sha256.h"
 #include "hashlib/hmac.h"
 #include "hashlib/bcrypt/bcrypt.h"
+#include "hashlib/crc32c.h"
+#define XXH_STATIC_LINKING_ONLY
+#include "hashlib/xxhash/xxhash.h"
 
 ObjModule *createHashlibModule(DictuVM *vm);
 
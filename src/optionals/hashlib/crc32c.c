@@ -0,0 +1,109 @@
+#include <string.h>
+
+#include "crc32c.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define CRC32C_SSE42
+#include <nmmintrin.h>
+#endif
+
+// Reversed Castagnoli polynomial
+#define CRC32C_POLY 0x82F63B78
+
+typedef uint32_t (*Crc32cFn)(uint32_t crc, const uint8_t *data, size_t length);
+
+static uint32_t crc32cDispatch(uint32_t crc, const uint8_t *data, size_t length);
+
+static Crc32cFn crc32cImpl = crc32cDispatch;
+
+// Tables for slicing-by-8, table[k][b] is the CRC of byte b followed by k zero bytes
+static uint32_t table[8][256];
+
+static void initTable(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+
+        for (int j = 0; j < 8; j++) {
+            crc = (crc >> 1) ^ (CRC32C_POLY & (0 - (crc & 1)));
+        }
+
+        table[0][i] = crc;
+    }
+
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int k = 1; k < 8; k++) {
+            table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xFF];
+        }
+    }
+}
+
+static uint32_t crc32cSlicing(uint32_t crc, const uint8_t *data, size_t length) {
+    while (length >= 8) {
+        uint32_t low, high;
+        memcpy(&low, data, 4);
+        memcpy(&high, data + 4, 4);
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        low = __builtin_bswap32(low);
+        high = __builtin_bswap32(high);
+#endif
+
+        low ^= crc;
+        crc = table[7][low & 0xFF] ^ table[6][(low >> 8) & 0xFF] ^
+              table[5][(low >> 16) & 0xFF] ^ table[4][low >> 24] ^
+              table[3][high & 0xFF] ^ table[2][(high >> 8) & 0xFF] ^
+              table[1][(high >> 16) & 0xFF] ^ table[0][high >> 24];
+
+        data += 8;
+        length -= 8;
+    }
+
+    while (length-- > 0) {
+        crc = (crc >> 8) ^ table[0][(crc ^ *data++) & 0xFF];
+    }
+
+    return crc;
+}
+
+#ifdef CRC32C_SSE42
+__attribute__((target("sse4.2")))
+static uint32_t crc32cSSE42(uint32_t crc, const uint8_t *data, size_t length) {
+    uint64_t crc64 = crc;
+
+    while (length >= 8) {
+        uint64_t chunk;
+        memcpy(&chunk, data, 8);
+        crc64 = _mm_crc32_u64(crc64, chunk);
+        data += 8;
+        length -= 8;
+    }
+
+    crc = (uint32_t) crc64;
+
+    while (length-- > 0) {
+        crc = _mm_crc32_u8(crc, *data++);
+    }
+
+    return crc;
+}
+#endif
+
+static uint32_t crc32cDispatch(uint32_t crc, const uint8_t *data, size_t length) {
+#ifdef CRC32C_SSE42
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("sse4.2")) {
+        crc32cImpl = crc32cSSE42;
+        return crc32cImpl(crc, data, length);
+    }
+#endif
+
+    initTable();
+    crc32cImpl = crc32cSlicing;
+
+    return crc32cImpl(crc, data, length);
+}
+
+uint32_t crc32c(uint32_t crc, const uint8_t *data, size_t length) {
+    return ~crc32cImpl(~crc, data, length);
+}
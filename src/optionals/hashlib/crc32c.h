@@ -0,0 +1,13 @@
+#ifndef dictu_crc32c_h
+#define dictu_crc32c_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * CRC-32C (Castagnoli). Passing the result of a previous call as crc continues
+ * the checksum over the new data, start with 0.
+ */
+uint32_t crc32c(uint32_t crc, const uint8_t *data, size_t length);
+
+#endif //dictu_crc32c_h
@@ -34,7 +34,20 @@
 #include "constants.h"
 #include "utils.h"
 
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define TC_SHA256_SHANI
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+typedef void (*compress_fn)(unsigned int *iv, const uint8_t *data, size_t blocks);
+
 static void compress(unsigned int *iv, const uint8_t *data);
+static void compress_blocks_generic(unsigned int *iv, const uint8_t *data, size_t blocks);
+static void select_compress(void);
+
+/* Chosen on first use based on the instructions the CPU supports */
+static compress_fn compress_blocks = (compress_fn) 0;
 
 int tc_sha256_init(TCSha256State_t s)
 {
@@ -49,6 +62,10 @@ int tc_sha256_init(TCSha256State_t s)
      * of the square roots of the first 8 primes: 2, 3, 5, 7, 11, 13, 17
      * and 19.
      */
+    if (compress_blocks == (compress_fn) 0) {
+        select_compress();
+    }
+
     _set((uint8_t *) s, 0x00, sizeof(*s));
     s->iv[0] = 0x6a09e667;
     s->iv[1] = 0xbb67ae85;
@@ -72,13 +89,37 @@ int tc_sha256_update(TCSha256State_t s, const uint8_t *data, size_t datalen)
         return TC_CRYPTO_SUCCESS;
     }
 
-    while (datalen-- > 0) {
-        s->leftover[s->leftover_offset++] = *(data++);
-        if (s->leftover_offset >= TC_SHA256_BLOCK_SIZE) {
-            compress(s->iv, s->leftover);
-            s->leftover_offset = 0;
-            s->bits_hashed += (TC_SHA256_BLOCK_SIZE << 3);
+    /* top up a partially filled block first */
+    if (s->leftover_offset > 0) {
+        size_t space = TC_SHA256_BLOCK_SIZE - s->leftover_offset;
+        size_t n = datalen < space ? datalen : space;
+
+        _copy(s->leftover + s->leftover_offset, space, data, n);
+        s->leftover_offset += n;
+        data += n;
+        datalen -= n;
+
+        if (s->leftover_offset < TC_SHA256_BLOCK_SIZE) {
+            return TC_CRYPTO_SUCCESS;
         }
+
+        compress_blocks(s->iv, s->leftover, 1);
+        s->leftover_offset = 0;
+        s->bits_hashed += (TC_SHA256_BLOCK_SIZE << 3);
+    }
+
+    /* whole blocks are hashed straight from the input */
+    size_t blocks = datalen / TC_SHA256_BLOCK_SIZE;
+    if (blocks > 0) {
+        compress_blocks(s->iv, data, blocks);
+        s->bits_hashed += (uint64_t) blocks * (TC_SHA256_BLOCK_SIZE << 3);
+        data += blocks * TC_SHA256_BLOCK_SIZE;
+        datalen -= blocks * TC_SHA256_BLOCK_SIZE;
+    }
+
+    if (datalen > 0) {
+        _copy(s->leftover, sizeof(s->leftover), data, datalen);
+        s->leftover_offset = datalen;
     }
 
     return TC_CRYPTO_SUCCESS;
@@ -101,7 +142,7 @@ int tc_sha256_final(uint8_t *digest, TCSha256State_t s)
         /* there is not room for all the padding in this block */
         _set(s->leftover + s->leftover_offset, 0x00,
              sizeof(s->leftover) - s->leftover_offset);
-        compress(s->iv, s->leftover);
+        compress_blocks(s->iv, s->leftover, 1);
         s->leftover_offset = 0;
     }
 
@@ -118,7 +159,7 @@ int tc_sha256_final(uint8_t *digest, TCSha256State_t s)
     s->leftover[sizeof(s->leftover) - 8] = (uint8_t)(s->bits_hashed >> 56);
 
     /* hash the padding and length */
-    compress(s->iv, s->leftover);
+    compress_blocks(s->iv, s->leftover, 1);
 
     /* copy the iv out to digest */
     for (i = 0; i < TC_SHA256_STATE_BLOCKS; ++i) {
@@ -214,4 +255,88 @@ static void compress(unsigned int *iv, const uint8_t *data)
 
     iv[0] += a; iv[1] += b; iv[2] += c; iv[3] += d;
     iv[4] += e; iv[5] += f; iv[6] += g; iv[7] += h;
-}
\ No newline at end of file
+}
+
+static void compress_blocks_generic(unsigned int *iv, const uint8_t *data, size_t blocks)
+{
+    while (blocks-- > 0) {
+        compress(iv, data);
+        data += TC_SHA256_BLOCK_SIZE;
+    }
+}
+
+#ifdef TC_SHA256_SHANI
+/*
+ * SHA-256 using the Intel SHA extensions. The state is held as ABEF / CDGH
+ * pairs as required by sha256rnds2, and the message schedule is computed four
+ * words at a time with sha256msg1 / sha256msg2.
+ */
+__attribute__((target("sha,sse4.1")))
+static void compress_blocks_shani(unsigned int *iv, const uint8_t *data, size_t blocks)
+{
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i state0, state1, tmp;
+    __m128i msg[4];
+
+    tmp = _mm_loadu_si128((const __m128i *) &iv[0]);
+    state1 = _mm_loadu_si128((const __m128i *) &iv[4]);
+    tmp = _mm_shuffle_epi32(tmp, 0xB1);            /* CDAB */
+    state1 = _mm_shuffle_epi32(state1, 0x1B);      /* EFGH */
+    state0 = _mm_alignr_epi8(tmp, state1, 8);      /* ABEF */
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);   /* CDGH */
+
+    while (blocks-- > 0) {
+        __m128i abef = state0;
+        __m128i cdgh = state1;
+
+#pragma GCC unroll 16
+        for (int i = 0; i < 16; ++i) {
+            __m128i w;
+
+            if (i < 4) {
+                w = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 16 * i)), mask);
+            } else {
+                /* msg[i & 3] holds words i-4, msg[(i + 3) & 3] holds words i-1 */
+                w = _mm_sha256msg1_epu32(msg[i & 3], msg[(i + 1) & 3]);
+                w = _mm_add_epi32(w, _mm_alignr_epi8(msg[(i + 3) & 3], msg[(i + 2) & 3], 4));
+                w = _mm_sha256msg2_epu32(w, msg[(i + 3) & 3]);
+            }
+
+            msg[i & 3] = w;
+
+            __m128i k = _mm_add_epi32(w, _mm_loadu_si128((const __m128i *) &k256[4 * i]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, k);
+            k = _mm_shuffle_epi32(k, 0x0E);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, k);
+        }
+
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+        data += TC_SHA256_BLOCK_SIZE;
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);         /* FEBA */
+    state1 = _mm_shuffle_epi32(state1, 0xB1);      /* DCHG */
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);   /* DCBA */
+    state1 = _mm_alignr_epi8(state1, tmp, 8);      /* HGFE */
+
+    _mm_storeu_si128((__m128i *) &iv[0], state0);
+    _mm_storeu_si128((__m128i *) &iv[4], state1);
+}
+#endif
+
+static void select_compress(void)
+{
+#ifdef TC_SHA256_SHANI
+    unsigned int eax, ebx, ecx, edx;
+
+    /* SHA is leaf 7 EBX bit 29, SSSE3 and SSE4.1 are leaf 1 ECX bits 9 and 19 */
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & (1u << 9)) && (ecx & (1u << 19)) &&
+        __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & (1u << 29))) {
+        compress_blocks = compress_blocks_shani;
+        return;
+    }
+#endif
+
+    compress_blocks = compress_blocks_generic;
+}
@@ -0,0 +1,13 @@
+/*
+ * xxHash - Extremely Fast Hash algorithm
+ * Copyright (C) 2012-2023 Yann Collet
+ *
+ * BSD 2-Clause License (https://www.opensource.org/licenses/bsd-license.php)
+ *
+ * Builds the xxHash implementation once, see xxhash.h for the full license.
+ */
+
+#define XXH_STATIC_LINKING_ONLY
+#define XXH_IMPLEMENTATION
+
+#include "xxhash.h"
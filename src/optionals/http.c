@@ -1,5 +1,7 @@
 #include "http.h"
 
+#include <limits.h>
+
 static Value strerrorHttpNative(DictuVM *vm, int argCount, Value *args) {
     if (argCount > 1) {
         runtimeError(vm, "strerror() takes either 0 or 1 arguments (%d given)", argCount);
@@ -147,10 +149,6 @@ static ObjDict *endRequest(DictuVM *vm, CURL *curl, Response response) {
     pop(vm);
     pop(vm);
 
-    /* always cleanup */
-    curl_easy_cleanup(curl);
-    curl_global_cleanup();
-
     return responseVal;
 }
 
@@ -209,7 +207,13 @@ static Value get(DictuVM *vm, int argCount, Value *args) {
             return NIL_VAL;
         }
 
-        return OBJ_VAL(endRequest(vm, curl, response));
+        ObjDict *responseVal = endRequest(vm, curl, response);
+
+        /* always cleanup */
+        curl_easy_cleanup(curl);
+        curl_global_cleanup();
+
+        return OBJ_VAL(responseVal);
     }
 
     /* always cleanup */
@@ -300,7 +304,13 @@ static Value post(DictuVM *vm, int argCount, Value *args) {
             return NIL_VAL;
         }
 
-        return OBJ_VAL(endRequest(vm, curl, response));
+        ObjDict *responseVal = endRequest(vm, curl, response);
+
+        /* always cleanup */
+        curl_easy_cleanup(curl);
+        curl_global_cleanup();
+
+        return OBJ_VAL(responseVal);
     }
 
     /* always cleanup */
@@ -313,6 +323,541 @@ static Value post(DictuVM *vm, int argCount, Value *args) {
     return NIL_VAL;
 }
 
+// Default number of transfers getMany() and postMany() keep in flight
+#define HTTP_DEFAULT_CONCURRENCY 8
+
+typedef struct {
+    CURL *curl;
+    Response response;
+    // Position of the request in the batch
+    int index;
+    char *postValue;
+} Transfer;
+
+typedef struct {
+    DictuVM *vm;
+    ObjList *requests;
+    // Responses are stored here in request order, in flight ones hold their headers list
+    ObjList *results;
+    bool post;
+    int next;
+} Batch;
+
+static void startTransfer(Batch *batch, CURLM *multi, Transfer *transfer) {
+    DictuVM *vm = batch->vm;
+    int index = batch->next++;
+    Value request = batch->requests->values.values[index];
+
+    createResponse(vm, &transfer->response);
+    batch->results->values.values[index] = OBJ_VAL(transfer->response.headers);
+    pop(vm);
+
+    transfer->index = index;
+    transfer->postValue = NULL;
+
+    if (batch->post) {
+        ObjList *pair = AS_LIST(request);
+        transfer->postValue = dictToPostArgs(AS_DICT(pair->values.values[1]));
+        curl_easy_setopt(transfer->curl, CURLOPT_URL, AS_CSTRING(pair->values.values[0]));
+        curl_easy_setopt(transfer->curl, CURLOPT_POSTFIELDS, transfer->postValue);
+    } else {
+        curl_easy_setopt(transfer->curl, CURLOPT_URL, AS_CSTRING(request));
+        curl_easy_setopt(transfer->curl, CURLOPT_HTTPGET, 1L);
+    }
+
+    curl_multi_add_handle(multi, transfer->curl);
+}
+
+static void finishTransfer(Batch *batch, Transfer *transfer, CURLcode result) {
+    DictuVM *vm = batch->vm;
+    Value response;
+
+    free(transfer->postValue);
+    transfer->postValue = NULL;
+
+    if (result == CURLE_OK) {
+        // endRequest expects the headers to be on the stack as left by createResponse
+        push(vm, OBJ_VAL(transfer->response.headers));
+        response = OBJ_VAL(endRequest(vm, transfer->curl, transfer->response));
+    } else {
+        if (transfer->response.res != NULL) {
+            FREE_ARRAY(vm, char, transfer->response.res, transfer->response.len + 1);
+        }
+
+        ObjDict *error = initDict(vm);
+        push(vm, OBJ_VAL(error));
+
+        ObjString *string = copyString(vm, "error", 5);
+        push(vm, OBJ_VAL(string));
+        dictSet(vm, error, OBJ_VAL(string), NUMBER_VAL(result));
+        pop(vm);
+        pop(vm);
+
+        response = OBJ_VAL(error);
+    }
+
+    batch->results->values.values[transfer->index] = response;
+}
+
+/**
+ * Runs every request in the batch through a curl multi handle, keeping at most
+ * concurrency transfers in flight. Easy handles are reused as transfers finish
+ * so connections to the same host are kept alive.
+ */
+static Value performBatch(DictuVM *vm, const char *name, ObjList *requests, bool post, int concurrency, long timeout) {
+    ObjList *results = initList(vm);
+    push(vm, OBJ_VAL(results));
+
+    for (int i = 0; i < requests->values.count; ++i) {
+        writeValueArray(vm, &results->values, NIL_VAL);
+    }
+
+    if (concurrency > requests->values.count) {
+        concurrency = requests->values.count;
+    }
+
+    if (concurrency == 0) {
+        pop(vm);
+        return OBJ_VAL(results);
+    }
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    CURLM *multi = curl_multi_init();
+
+    if (multi == NULL) {
+        curl_global_cleanup();
+        pop(vm);
+
+        runtimeError(vm, "Memory error on %s()!", name);
+        return EMPTY_VAL;
+    }
+
+    Transfer *transfers = ALLOCATE(vm, Transfer, concurrency);
+    Batch batch = {vm, requests, results, post, 0};
+    int active = 0;
+
+    for (int i = 0; i < concurrency; ++i) {
+        Transfer *transfer = &transfers[i];
+        transfer->curl = curl_easy_init();
+
+        if (transfer->curl == NULL) {
+            // Nothing has been started yet, only the handles already created need freeing
+            for (int j = 0; j < i; ++j) {
+                curl_easy_cleanup(transfers[j].curl);
+            }
+
+            FREE_ARRAY(vm, Transfer, transfers, concurrency);
+            curl_multi_cleanup(multi);
+            curl_global_cleanup();
+            pop(vm);
+
+            runtimeError(vm, "Memory error on %s()!", name);
+            return EMPTY_VAL;
+        }
+
+        curl_easy_setopt(transfer->curl, CURLOPT_TIMEOUT, timeout);
+        curl_easy_setopt(transfer->curl, CURLOPT_WRITEFUNCTION, writeResponse);
+        curl_easy_setopt(transfer->curl, CURLOPT_WRITEDATA, &transfer->response);
+        curl_easy_setopt(transfer->curl, CURLOPT_HEADERFUNCTION, writeHeaders);
+        curl_easy_setopt(transfer->curl, CURLOPT_HEADERDATA, &transfer->response);
+        curl_easy_setopt(transfer->curl, CURLOPT_PRIVATE, transfer);
+    }
+
+    for (int i = 0; i < concurrency; ++i) {
+        startTransfer(&batch, multi, &transfers[i]);
+        active++;
+    }
+
+    while (active > 0) {
+        int running;
+        curl_multi_perform(multi, &running);
+
+        CURLMsg *message;
+        int queued;
+
+        while ((message = curl_multi_info_read(multi, &queued)) != NULL) {
+            if (message->msg != CURLMSG_DONE) {
+                continue;
+            }
+
+            Transfer *transfer;
+            curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, (char **) &transfer);
+            CURLcode result = message->data.result;
+
+            curl_multi_remove_handle(multi, transfer->curl);
+            finishTransfer(&batch, transfer, result);
+            active--;
+
+            if (batch.next < requests->values.count) {
+                startTransfer(&batch, multi, transfer);
+                active++;
+            }
+        }
+
+        if (active > 0) {
+            curl_multi_poll(multi, NULL, 0, 1000, NULL);
+        }
+    }
+
+    for (int i = 0; i < concurrency; ++i) {
+        curl_easy_cleanup(transfers[i].curl);
+    }
+
+    FREE_ARRAY(vm, Transfer, transfers, concurrency);
+    curl_multi_cleanup(multi);
+    curl_global_cleanup();
+    pop(vm);
+
+    return OBJ_VAL(results);
+}
+
+static bool getBatchOptions(DictuVM *vm, int argCount, Value *args, const char *name, int *concurrency, long *timeout) {
+    *concurrency = HTTP_DEFAULT_CONCURRENCY;
+    *timeout = 20;
+
+    if (argCount != 2) {
+        return true;
+    }
+
+    if (!IS_DICT(args[1])) {
+        runtimeError(vm, "Options passed to %s() must be a dictionary.", name);
+        return false;
+    }
+
+    ObjDict *options = AS_DICT(args[1]);
+    Value option;
+
+    if (dictGet(options, OBJ_VAL(copyString(vm, "concurrency", 11)), &option)) {
+        if (!IS_NUMBER(option) || !(AS_NUMBER(option) >= 1)) {
+            runtimeError(vm, "%s() concurrency option must be a positive number.", name);
+            return false;
+        }
+
+        // Clamped as a double so it converts safely, performBatch() caps it at the request count anyway
+        *concurrency = AS_NUMBER(option) < INT_MAX ? AS_NUMBER(option) : INT_MAX;
+    }
+
+    if (dictGet(options, OBJ_VAL(copyString(vm, "timeout", 7)), &option)) {
+        if (!IS_NUMBER(option)) {
+            runtimeError(vm, "%s() timeout option must be a number.", name);
+            return false;
+        }
+
+        *timeout = AS_NUMBER(option);
+    }
+
+    return true;
+}
+
+static Value getMany(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 1 && argCount != 2) {
+        runtimeError(vm, "getMany() takes 1 or 2 arguments (%d given).", argCount);
+        return EMPTY_VAL;
+    }
+
+    if (!IS_LIST(args[0])) {
+        runtimeError(vm, "URLs passed to getMany() must be a list.");
+        return EMPTY_VAL;
+    }
+
+    ObjList *urls = AS_LIST(args[0]);
+
+    for (int i = 0; i < urls->values.count; ++i) {
+        if (!IS_STRING(urls->values.values[i])) {
+            runtimeError(vm, "URLs passed to getMany() must be strings.");
+            return EMPTY_VAL;
+        }
+    }
+
+    int concurrency;
+    long timeout;
+
+    if (!getBatchOptions(vm, argCount, args, "getMany", &concurrency, &timeout)) {
+        return EMPTY_VAL;
+    }
+
+    return performBatch(vm, "getMany", urls, false, concurrency, timeout);
+}
+
+static Value postMany(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 1 && argCount != 2) {
+        runtimeError(vm, "postMany() takes 1 or 2 arguments (%d given).", argCount);
+        return EMPTY_VAL;
+    }
+
+    if (!IS_LIST(args[0])) {
+        runtimeError(vm, "Requests passed to postMany() must be a list.");
+        return EMPTY_VAL;
+    }
+
+    ObjList *requests = AS_LIST(args[0]);
+
+    for (int i = 0; i < requests->values.count; ++i) {
+        Value request = requests->values.values[i];
+
+        if (!IS_LIST(request) || AS_LIST(request)->values.count != 2 ||
+            !IS_STRING(AS_LIST(request)->values.values[0]) || !IS_DICT(AS_LIST(request)->values.values[1])) {
+            runtimeError(vm, "Requests passed to postMany() must be lists of a URL and a dictionary.");
+            return EMPTY_VAL;
+        }
+    }
+
+    int concurrency;
+    long timeout;
+
+    if (!getBatchOptions(vm, argCount, args, "postMany", &concurrency, &timeout)) {
+        return EMPTY_VAL;
+    }
+
+    return performBatch(vm, "postMany", requests, true, concurrency, timeout);
+}
+
+typedef struct {
+    // Reused for every request so open connections are kept alive
+    CURL *curl;
+    // Shares the DNS cache, TLS sessions and connection pool between handles
+    CURLSH *share;
+    struct curl_slist *headers;
+    long timeout;
+} Client;
+
+#define AS_HTTP_CLIENT(v) ((Client*)AS_ABSTRACT(v)->data)
+
+static ObjModule *getHttpModule(DictuVM *vm) {
+    Value module = 0;
+    tableGet(&vm->modules, copyString(vm, "HTTP", 4), &module);
+    return AS_MODULE(module);
+}
+
+static Value clientRequest(DictuVM *vm, Client *client, char *url, long timeout, char *postValue) {
+    CURL *curl = client->curl;
+    Response response;
+    createResponse(vm, &response);
+
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, timeout);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &response);
+
+    if (postValue != NULL) {
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, postValue);
+    } else {
+        curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+    }
+
+    CURLcode curlResponse = curl_easy_perform(curl);
+
+    if (curlResponse != CURLE_OK) {
+        if (response.res != NULL) {
+            FREE_ARRAY(vm, char, response.res, response.len + 1);
+        }
+
+        pop(vm);
+
+        errno = curlResponse;
+        SET_ERRNO(getHttpModule(vm));
+        return NIL_VAL;
+    }
+
+    return OBJ_VAL(endRequest(vm, curl, response));
+}
+
+static Value getClient(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 1 && argCount != 2) {
+        runtimeError(vm, "get() takes 1 or 2 arguments (%d given).", argCount);
+        return EMPTY_VAL;
+    }
+
+    Client *client = AS_HTTP_CLIENT(args[0]);
+    long timeout = client->timeout;
+
+    if (argCount == 2) {
+        if (!IS_NUMBER(args[2])) {
+            runtimeError(vm, "Timeout passed to get() must be a number.");
+            return EMPTY_VAL;
+        }
+
+        timeout = AS_NUMBER(args[2]);
+    }
+
+    if (!IS_STRING(args[1])) {
+        runtimeError(vm, "URL passed to get() must be a string.");
+        return EMPTY_VAL;
+    }
+
+    return clientRequest(vm, client, AS_CSTRING(args[1]), timeout, NULL);
+}
+
+static Value postClient(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 1 && argCount != 2 && argCount != 3) {
+        runtimeError(vm, "post() takes between 1 and 3 arguments (%d given).", argCount);
+        return EMPTY_VAL;
+    }
+
+    Client *client = AS_HTTP_CLIENT(args[0]);
+    long timeout = client->timeout;
+    ObjDict *dict = NULL;
+
+    if (argCount == 3) {
+        if (!IS_NUMBER(args[3])) {
+            runtimeError(vm, "Timeout passed to post() must be a number.");
+            return EMPTY_VAL;
+        }
+
+        timeout = (long) AS_NUMBER(args[3]);
+    }
+
+    if (argCount >= 2) {
+        if (!IS_DICT(args[2])) {
+            runtimeError(vm, "Post values passed to post() must be a dictionary.");
+            return EMPTY_VAL;
+        }
+
+        dict = AS_DICT(args[2]);
+    }
+
+    if (!IS_STRING(args[1])) {
+        runtimeError(vm, "URL passed to post() must be a string.");
+        return EMPTY_VAL;
+    }
+
+    char *postValue = "";
+
+    if (dict != NULL) {
+        postValue = dictToPostArgs(dict);
+    }
+
+    Value response = clientRequest(vm, client, AS_CSTRING(args[1]), timeout, postValue);
+
+    if (dict != NULL) {
+        free(postValue);
+    }
+
+    return response;
+}
+
+static void freeClient(DictuVM *vm, ObjAbstract *abstract) {
+    Client *client = abstract->data;
+
+    curl_easy_cleanup(client->curl);
+    curl_share_cleanup(client->share);
+    curl_slist_free_all(client->headers);
+    curl_global_cleanup();
+
+    FREE(vm, Client, abstract->data);
+}
+
+static bool getClientOption(DictuVM *vm, ObjDict *options, char *name, Value *value) {
+    return dictGet(options, OBJ_VAL(copyString(vm, name, strlen(name))), value);
+}
+
+static Value newClient(DictuVM *vm, int argCount, Value *args) {
+    if (argCount > 1) {
+        runtimeError(vm, "Client() takes 0 or 1 arguments (%d given).", argCount);
+        return EMPTY_VAL;
+    }
+
+    long timeout = 20;
+    long connectTimeout = 0;
+    ObjList *headers = NULL;
+
+    if (argCount == 1) {
+        if (!IS_DICT(args[0])) {
+            runtimeError(vm, "Options passed to Client() must be a dictionary.");
+            return EMPTY_VAL;
+        }
+
+        ObjDict *options = AS_DICT(args[0]);
+        Value option;
+
+        if (getClientOption(vm, options, "timeout", &option)) {
+            if (!IS_NUMBER(option)) {
+                runtimeError(vm, "Client() timeout option must be a number.");
+                return EMPTY_VAL;
+            }
+
+            timeout = AS_NUMBER(option);
+        }
+
+        if (getClientOption(vm, options, "connectTimeout", &option)) {
+            if (!IS_NUMBER(option)) {
+                runtimeError(vm, "Client() connectTimeout option must be a number.");
+                return EMPTY_VAL;
+            }
+
+            connectTimeout = AS_NUMBER(option);
+        }
+
+        if (getClientOption(vm, options, "headers", &option)) {
+            if (!IS_LIST(option)) {
+                runtimeError(vm, "Client() headers option must be a list.");
+                return EMPTY_VAL;
+            }
+
+            headers = AS_LIST(option);
+
+            for (int i = 0; i < headers->values.count; ++i) {
+                if (!IS_STRING(headers->values.values[i])) {
+                    runtimeError(vm, "Client() headers must be strings.");
+                    return EMPTY_VAL;
+                }
+            }
+        }
+    }
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    CURL *curl = curl_easy_init();
+    CURLSH *share = curl_share_init();
+
+    if (curl == NULL || share == NULL) {
+        curl_easy_cleanup(curl);
+        curl_share_cleanup(share);
+        curl_global_cleanup();
+
+        errno = CURLE_FAILED_INIT;
+        SET_ERRNO(GET_SELF_CLASS);
+        return NIL_VAL;
+    }
+
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+
+    ObjAbstract *abstract = initAbstract(vm, freeClient);
+    push(vm, OBJ_VAL(abstract));
+
+    Client *client = ALLOCATE(vm, Client, 1);
+    client->curl = curl;
+    client->share = share;
+    client->headers = NULL;
+    client->timeout = timeout;
+    abstract->data = client;
+
+    if (headers != NULL) {
+        for (int i = 0; i < headers->values.count; ++i) {
+            client->headers = curl_slist_append(client->headers, AS_CSTRING(headers->values.values[i]));
+        }
+    }
+
+    curl_easy_setopt(curl, CURLOPT_SHARE, share);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, client->headers);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, connectTimeout);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writeResponse);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, writeHeaders);
+
+    /**
+     * Setup Client object methods
+     */
+    defineNative(vm, &abstract->values, "get", getClient);
+    defineNative(vm, &abstract->values, "post", postClient);
+    pop(vm);
+
+    return OBJ_VAL(abstract);
+}
+
 ObjModule *createHTTPModule(DictuVM *vm) {
     ObjString *name = copyString(vm, "HTTP", 4);
     push(vm, OBJ_VAL(name));
@@ -325,6 +870,9 @@ ObjModule *createHTTPModule(DictuVM *vm) {
     defineNative(vm, &module->values, "strerror", strerrorHttpNative);
     defineNative(vm, &module->values, "get", get);
     defineNative(vm, &module->values, "post", post);
+    defineNative(vm, &module->values, "getMany", getMany);
+    defineNative(vm, &module->values, "postMany", postMany);
+    defineNative(vm, &module->values, "Client", newClient);
 
     /**
      * Define Http properties
@@ -12,6 +12,8 @@ struct json_error_table_t {
   { JSON_EINVAL, "Invalid JSON object"},
 #define JSON_ENOSERIAL 4
   { JSON_ENOSERIAL, "Object is not serializable"},
+#define JSON_EIO 5
+  { JSON_EIO, "Unable to write JSON output"},
   { -1, NULL}};
 
 static Value strerrorJsonNative(DictuVM *vm, int argCount, Value *args) {
@@ -43,185 +45,1127 @@ static Value strerrorJsonNative(DictuVM *vm, int argCount, Value *args) {
         }
     }
 
-    runtimeError(vm, "strerror() argument should be <= %d", JSON_ENOSERIAL);
+    runtimeError(vm, "strerror() argument should be <= %d", JSON_EIO);
     return EMPTY_VAL;
 }
 
-static Value parseJson(DictuVM *vm, json_value *json) {
-    switch (json->type) {
-        case json_none:
-        case json_null: {
+#define JSON_MAX_DEPTH 1024
+#define JSON_KEY_CACHE_SIZE 64
+
+// Top level object keys to keep, anything else is skipped without being built
+typedef struct {
+    int count;
+    char **keys;
+    int *lengths;
+} JsonProjection;
+
+typedef struct {
+    DictuVM *vm;
+    const char *current;
+    const char *end;
+    int depth;
+    JsonProjection *projection;
+    // Values of containers that are still being parsed. This is a Dictu list
+    // so that everything parsed so far is visible to the GC.
+    ObjList *stack;
+    // Scratch space used to unescape strings
+    char *buffer;
+    int bufferCapacity;
+    // Recently seen object keys, so repeated keys skip hashing and interning
+    ObjString *keyCache[JSON_KEY_CACHE_SIZE];
+} JsonParser;
+
+static bool parseValue(JsonParser *parser, Value *value);
+
+static void initJsonParser(DictuVM *vm, JsonParser *parser, const char *source, int length,
+                           JsonProjection *projection) {
+    parser->vm = vm;
+    parser->current = source;
+    parser->end = source + length;
+    parser->depth = 0;
+    parser->projection = projection;
+    parser->buffer = NULL;
+    parser->bufferCapacity = 0;
+    memset(parser->keyCache, 0, sizeof(parser->keyCache));
+
+    parser->stack = initList(vm);
+    // Push to stack to avoid GC
+    push(vm, OBJ_VAL(parser->stack));
+}
+
+static void freeJsonParser(JsonParser *parser) {
+    FREE_ARRAY(parser->vm, char, parser->buffer, parser->bufferCapacity);
+    freeValueArray(parser->vm, &parser->stack->values);
+    pop(parser->vm);
+}
+
+static inline void skipWhitespace(JsonParser *parser) {
+    // Compact JSON rarely has whitespace between tokens
+    if (parser->current < parser->end && (unsigned char) *parser->current > ' ') {
+        return;
+    }
+
+    parser->current = jsonScanner.skipWhitespace(parser->current, parser->end);
+}
+
+/**
+ * Ensures there is room for count more values on the parser stack. This must
+ * happen before a value is parsed, as growing the stack can trigger the GC and
+ * a freshly parsed value is not reachable until it has been stored.
+ */
+static void reserveStack(JsonParser *parser, int count) {
+    ValueArray *stack = &parser->stack->values;
+
+    if (stack->capacity < stack->count + count) {
+        int oldCapacity = stack->capacity;
+        stack->capacity = GROW_CAPACITY(stack->count + count);
+        stack->values = GROW_ARRAY(parser->vm, stack->values, Value,
+                                   oldCapacity, stack->capacity);
+    }
+}
+
+static bool matchLiteral(JsonParser *parser, const char *literal, int length) {
+    if (parser->end - parser->current < length ||
+        memcmp(parser->current, literal, length) != 0) {
+        return false;
+    }
+
+    parser->current += length;
+    return true;
+}
+
+static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool parseHex4(const char *chars, uint32_t *codePoint) {
+    uint32_t result = 0;
+
+    for (int i = 0; i < 4; ++i) {
+        int digit = hexDigit(chars[i]);
+        if (digit < 0) {
+            return false;
+        }
+
+        result = (result << 4) | digit;
+    }
+
+    *codePoint = result;
+    return true;
+}
+
+static int encodeUtf8(char *out, uint32_t codePoint) {
+    if (codePoint < 0x80) {
+        out[0] = codePoint;
+        return 1;
+    }
+
+    if (codePoint < 0x800) {
+        out[0] = 0xC0 | (codePoint >> 6);
+        out[1] = 0x80 | (codePoint & 0x3F);
+        return 2;
+    }
+
+    if (codePoint < 0x10000) {
+        out[0] = 0xE0 | (codePoint >> 12);
+        out[1] = 0x80 | ((codePoint >> 6) & 0x3F);
+        out[2] = 0x80 | (codePoint & 0x3F);
+        return 3;
+    }
+
+    out[0] = 0xF0 | (codePoint >> 18);
+    out[1] = 0x80 | ((codePoint >> 12) & 0x3F);
+    out[2] = 0x80 | ((codePoint >> 6) & 0x3F);
+    out[3] = 0x80 | (codePoint & 0x3F);
+    return 4;
+}
+
+/**
+ * Decodes the escaped string between start and end into the parser buffer.
+ * An escape never decodes to more bytes than it occupies in the source, so
+ * the source length is always enough room.
+ */
+static bool unescapeString(JsonParser *parser, const char *start, const char *end, int *length) {
+    int needed = end - start + 1;
+
+    if (parser->bufferCapacity < needed) {
+        int oldCapacity = parser->bufferCapacity;
+        parser->bufferCapacity = GROW_CAPACITY(needed);
+        parser->buffer = GROW_ARRAY(parser->vm, parser->buffer, char,
+                                    oldCapacity, parser->bufferCapacity);
+    }
+
+    char *out = parser->buffer;
+
+    while (start < end) {
+        if (*start != '\\') {
+            *out++ = *start++;
+            continue;
+        }
+
+        start++;
+
+        switch (*start++) {
+            case '"': *out++ = '"'; break;
+            case '\\': *out++ = '\\'; break;
+            case '/': *out++ = '/'; break;
+            case 'b': *out++ = '\b'; break;
+            case 'f': *out++ = '\f'; break;
+            case 'n': *out++ = '\n'; break;
+            case 'r': *out++ = '\r'; break;
+            case 't': *out++ = '\t'; break;
+            case 'u': {
+                uint32_t codePoint;
+                if (end - start < 4 || !parseHex4(start, &codePoint)) {
+                    return false;
+                }
+
+                start += 4;
+
+                // Combine a UTF-16 surrogate pair into a single code point
+                if (codePoint >= 0xD800 && codePoint <= 0xDBFF &&
+                    end - start >= 6 && start[0] == '\\' && start[1] == 'u') {
+                    uint32_t low;
+                    if (parseHex4(start + 2, &low) && low >= 0xDC00 && low <= 0xDFFF) {
+                        codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                        start += 6;
+                    }
+                }
+
+                out += encodeUtf8(out, codePoint);
+                break;
+            }
+
+            default:
+                return false;
+        }
+    }
+
+    *length = out - parser->buffer;
+    return true;
+}
+
+/**
+ * Finds the end of the string starting at the parser's current position
+ * (just after the opening quote), leaving the parser past the closing quote.
+ */
+static bool scanString(JsonParser *parser, const char **start, const char **end, bool *escaped) {
+    const char *current = parser->current;
+    *start = current;
+    *escaped = false;
+
+    for (;;) {
+        current = jsonScanner.scanString(current, parser->end);
+
+        if (current >= parser->end) {
+            return false;
+        }
+
+        if (*current == '"') {
+            *end = current;
+            parser->current = current + 1;
+            return true;
+        }
+
+        if (*current != '\\') {
+            // Unescaped control character
+            return false;
+        }
+
+        *escaped = true;
+        // Skip the escaped character so \" does not end the string
+        current += 2;
+    }
+}
+
+static bool parseString(JsonParser *parser, Value *value) {
+    const char *start, *end;
+    bool escaped;
+
+    if (!scanString(parser, &start, &end, &escaped)) {
+        return false;
+    }
+
+    if (!escaped) {
+        *value = OBJ_VAL(copyString(parser->vm, start, end - start));
+        return true;
+    }
+
+    int length;
+    if (!unescapeString(parser, start, end, &length)) {
+        return false;
+    }
+
+    *value = OBJ_VAL(copyString(parser->vm, parser->buffer, length));
+    return true;
+}
+
+static bool parseKey(JsonParser *parser, const char *start, const char *end, bool escaped, Value *value) {
+    if (escaped) {
+        int length;
+        if (!unescapeString(parser, start, end, &length)) {
+            return false;
+        }
+
+        *value = OBJ_VAL(copyString(parser->vm, parser->buffer, length));
+        return true;
+    }
+
+    int length = end - start;
+    int slot = length;
+
+    if (length > 0) {
+        slot += (unsigned char) start[0] * 31 + (unsigned char) start[length - 1] * 7;
+    }
+
+    slot &= JSON_KEY_CACHE_SIZE - 1;
+
+    ObjString *key = parser->keyCache[slot];
+    if (key == NULL || key->length != length || memcmp(key->chars, start, length) != 0) {
+        key = copyString(parser->vm, start, length);
+        parser->keyCache[slot] = key;
+    }
+
+    *value = OBJ_VAL(key);
+    return true;
+}
+
+static bool parseNumber(JsonParser *parser, Value *value) {
+    const char *start = parser->current;
+    const char *current = start;
+    const char *end = parser->end;
+    bool negative = false;
+    bool isInteger = true;
+
+    if (current < end && *current == '-') {
+        negative = true;
+        current++;
+    }
+
+    const char *digits = current;
+
+    if (current < end && *current == '0') {
+        current++;
+    } else {
+        while (current < end && *current >= '0' && *current <= '9') {
+            current++;
+        }
+    }
+
+    int digitCount = current - digits;
+    if (digitCount == 0) {
+        return false;
+    }
+
+    if (current < end && *current == '.') {
+        isInteger = false;
+        current++;
+
+        const char *fraction = current;
+        while (current < end && *current >= '0' && *current <= '9') {
+            current++;
+        }
+
+        if (current == fraction) {
+            return false;
+        }
+    }
+
+    if (current < end && (*current == 'e' || *current == 'E')) {
+        isInteger = false;
+        current++;
+
+        if (current < end && (*current == '+' || *current == '-')) {
+            current++;
+        }
+
+        const char *exponent = current;
+        while (current < end && *current >= '0' && *current <= '9') {
+            current++;
+        }
+
+        if (current == exponent) {
+            return false;
+        }
+    }
+
+    parser->current = current;
+
+    // Integers of up to 15 digits are exactly representable as a double
+    if (isInteger && digitCount <= 15) {
+        int64_t result = 0;
+
+        for (const char *c = digits; c < current; ++c) {
+            result = result * 10 + (*c - '0');
+        }
+
+        *value = NUMBER_VAL(negative ? -(double) result : (double) result);
+        return true;
+    }
+
+    *value = NUMBER_VAL(strtod(start, NULL));
+    return true;
+}
+
+static bool isSelectedKey(JsonParser *parser, const char *start, const char *end, bool escaped, bool *selected) {
+    JsonProjection *projection = parser->projection;
+
+    if (projection == NULL || parser->depth != 1) {
+        *selected = true;
+        return true;
+    }
+
+    int length = end - start;
+
+    if (escaped) {
+        if (!unescapeString(parser, start, end, &length)) {
+            return false;
+        }
+
+        start = parser->buffer;
+    }
+
+    *selected = false;
+
+    for (int i = 0; i < projection->count; ++i) {
+        if (projection->lengths[i] == length && memcmp(projection->keys[i], start, length) == 0) {
+            *selected = true;
+            break;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Validates the next value without creating any Dictu objects for it.
+ */
+static bool skipValue(JsonParser *parser) {
+    skipWhitespace(parser);
+
+    if (parser->current == parser->end) {
+        return false;
+    }
+
+    switch (*parser->current) {
+        case '{':
+        case '[': {
+            if (parser->depth == JSON_MAX_DEPTH) {
+                return false;
+            }
+
+            char close = *parser->current == '{' ? '}' : ']';
+            parser->current++;
+            skipWhitespace(parser);
+
+            if (parser->current < parser->end && *parser->current == close) {
+                parser->current++;
+                return true;
+            }
+
+            parser->depth++;
+
+            for (;;) {
+                if (close == '}') {
+                    const char *start, *end;
+                    bool escaped;
+
+                    skipWhitespace(parser);
+
+                    if (parser->current == parser->end || *parser->current != '"') {
+                        return false;
+                    }
+
+                    parser->current++;
+
+                    if (!scanString(parser, &start, &end, &escaped)) {
+                        return false;
+                    }
+
+                    skipWhitespace(parser);
+
+                    if (parser->current == parser->end || *parser->current != ':') {
+                        return false;
+                    }
+
+                    parser->current++;
+                }
+
+                if (!skipValue(parser)) {
+                    return false;
+                }
+
+                skipWhitespace(parser);
+
+                if (parser->current == parser->end) {
+                    return false;
+                }
+
+                char c = *parser->current++;
+
+                if (c == close) {
+                    break;
+                }
+
+                if (c != ',') {
+                    return false;
+                }
+            }
+
+            parser->depth--;
+            return true;
+        }
+
+        case '"': {
+            const char *start, *end;
+            bool escaped;
+
+            parser->current++;
+            return scanString(parser, &start, &end, &escaped);
+        }
+
+        case 't':
+            return matchLiteral(parser, "true", 4);
+
+        case 'f':
+            return matchLiteral(parser, "false", 5);
+
+        case 'n':
+            return matchLiteral(parser, "null", 4);
+
+        default: {
+            Value number;
+            return parseNumber(parser, &number);
+        }
+    }
+}
+
+static bool parseArray(JsonParser *parser, Value *value) {
+    DictuVM *vm = parser->vm;
+    ValueArray *stack = &parser->stack->values;
+    int base = stack->count;
+
+    skipWhitespace(parser);
+
+    if (parser->current < parser->end && *parser->current == ']') {
+        parser->current++;
+    } else {
+        for (;;) {
+            reserveStack(parser, 1);
+
+            Value element;
+            if (!parseValue(parser, &element)) {
+                return false;
+            }
+
+            stack->values[stack->count++] = element;
+            skipWhitespace(parser);
+
+            if (parser->current == parser->end) {
+                return false;
+            }
+
+            char c = *parser->current++;
+
+            if (c == ']') {
+                break;
+            }
+
+            if (c != ',') {
+                return false;
+            }
+        }
+    }
+
+    int count = stack->count - base;
+    ObjList *list = initList(vm);
+
+    if (count > 0) {
+        // Push to stack to avoid GC
+        push(vm, OBJ_VAL(list));
+        list->values.values = ALLOCATE(vm, Value, count);
+        list->values.capacity = count;
+        memcpy(list->values.values, stack->values + base, sizeof(Value) * count);
+        list->values.count = count;
+        pop(vm);
+    }
+
+    stack->count = base;
+    *value = OBJ_VAL(list);
+    return true;
+}
+
+static bool parseObject(JsonParser *parser, Value *value) {
+    DictuVM *vm = parser->vm;
+    ValueArray *stack = &parser->stack->values;
+    int base = stack->count;
+
+    skipWhitespace(parser);
+
+    if (parser->current < parser->end && *parser->current == '}') {
+        parser->current++;
+    } else {
+        for (;;) {
+            reserveStack(parser, 2);
+
+            if (parser->current == parser->end || *parser->current != '"') {
+                return false;
+            }
+
+            parser->current++;
+
+            const char *start, *end;
+            bool escaped, selected;
+
+            if (!scanString(parser, &start, &end, &escaped) ||
+                !isSelectedKey(parser, start, end, escaped, &selected)) {
+                return false;
+            }
+
+            skipWhitespace(parser);
+
+            if (parser->current == parser->end || *parser->current != ':') {
+                return false;
+            }
+
+            parser->current++;
+
+            if (selected) {
+                Value key;
+                if (!parseKey(parser, start, end, escaped, &key)) {
+                    return false;
+                }
+
+                stack->values[stack->count++] = key;
+
+                Value element;
+                if (!parseValue(parser, &element)) {
+                    return false;
+                }
+
+                stack->values[stack->count++] = element;
+            } else if (!skipValue(parser)) {
+                return false;
+            }
+
+            skipWhitespace(parser);
+
+            if (parser->current == parser->end) {
+                return false;
+            }
+
+            char c = *parser->current++;
+
+            if (c == '}') {
+                break;
+            }
+
+            if (c != ',') {
+                return false;
+            }
+
+            skipWhitespace(parser);
+        }
+    }
+
+    int count = (stack->count - base) / 2;
+    ObjDict *dict = initDict(vm);
+
+    if (count > 0) {
+        // Push to stack to avoid GC
+        push(vm, OBJ_VAL(dict));
+        dictReserve(vm, dict, count);
+
+        for (int i = base; i < stack->count; i += 2) {
+            dictSet(vm, dict, stack->values[i], stack->values[i + 1]);
+        }
+
+        pop(vm);
+    }
+
+    stack->count = base;
+    *value = OBJ_VAL(dict);
+    return true;
+}
+
+static bool parseValue(JsonParser *parser, Value *value) {
+    skipWhitespace(parser);
+
+    if (parser->current == parser->end) {
+        return false;
+    }
+
+    switch (*parser->current) {
+        case '{':
+        case '[': {
+            if (parser->depth == JSON_MAX_DEPTH) {
+                return false;
+            }
+
+            parser->depth++;
+            bool isObject = *parser->current++ == '{';
+            bool result = isObject ? parseObject(parser, value) : parseArray(parser, value);
+            parser->depth--;
+
+            return result;
+        }
+
+        case '"': {
+            parser->current++;
+            return parseString(parser, value);
+        }
+
+        case 't': {
+            *value = TRUE_VAL;
+            return matchLiteral(parser, "true", 4);
+        }
+
+        case 'f': {
+            *value = FALSE_VAL;
+            return matchLiteral(parser, "false", 5);
+        }
+
+        case 'n': {
             // TODO: We return nil on failure however "null" is valid JSON
             // TODO: We need a better way of handling this scenario
-            return NIL_VAL;
-        }
-
-        case json_object: {
-            ObjDict *dict = initDict(vm);
-            // Push value to stack to avoid GC
-            push(vm, OBJ_VAL(dict));
-
-            for (unsigned int i = 0; i < json->u.object.length; i++) {
-                Value val = parseJson(vm, json->u.object.values[i].value);
-                push(vm, val);
-                Value key = OBJ_VAL(copyString(vm, json->u.object.values[i].name, json->u.object.values[i].name_length));
-                push(vm, key);
-                dictSet(vm, dict, key, val);
-                pop(vm);
-                pop(vm);
-            }
+            *value = NIL_VAL;
+            return matchLiteral(parser, "null", 4);
+        }
+
+        default: {
+            return parseNumber(parser, value);
+        }
+    }
+}
+
+/**
+ * Parses a complete JSON document straight into Dictu values.
+ * The source must be NUL terminated after length bytes.
+ */
+static bool parseJson(DictuVM *vm, const char *source, int length, JsonProjection *projection, Value *value) {
+    JsonParser parser;
+    initJsonParser(vm, &parser, source, length, projection);
+
+    bool result = parseValue(&parser, value);
+
+    if (result) {
+        skipWhitespace(&parser);
+        result = parser.current == parser.end;
+    }
+
+    freeJsonParser(&parser);
+    return result;
+}
+
+static Value parse(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 1) {
+        runtimeError(vm, "parse() takes 1 argument (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    if (!IS_STRING(args[0])) {
+        runtimeError(vm, "parse() argument must be a string.");
+        return EMPTY_VAL;
+    }
+
+    ObjString *json = AS_STRING(args[0]);
+    Value val;
+
+    if (!parseJson(vm, json->chars, json->length, NULL, &val)) {
+        errno = JSON_EINVAL;
+        SET_ERRNO(GET_SELF_CLASS);
+        return NIL_VAL;
+    }
+
+    return val;
+}
+
+#define JSON_WRITE_BUFFER_SIZE 65536
 
-            pop(vm);
+typedef enum {
+    JSON_SINGLE_LINE,
+    JSON_COMPACT,
+    JSON_MULTILINE
+} JsonWriteMode;
 
-            return OBJ_VAL(dict);
-        }
+typedef struct {
+    DictuVM *vm;
+    char *buffer;
+    int length;
+    int capacity;
+    JsonWriteMode mode;
+    int indent;
+    int depth;
+    // Set when the output is streamed rather than returned as a string
+    FILE *file;
+    Value socket;
+    size_t written;
+    int error;
+} JsonWriter;
 
-        case json_array: {
-            ObjList *list = initList(vm);
-            // Push value to stack to avoid GC
-            push(vm, OBJ_VAL(list));
+static void initJsonWriter(DictuVM *vm, JsonWriter *writer, JsonWriteMode mode, int indent) {
+    writer->vm = vm;
+    writer->buffer = NULL;
+    writer->length = 0;
+    writer->capacity = 0;
+    writer->mode = mode;
+    writer->indent = indent;
+    writer->depth = 0;
+    writer->file = NULL;
+    writer->socket = NIL_VAL;
+    writer->written = 0;
+    writer->error = 0;
+}
 
-            for (unsigned int i = 0; i < json->u.array.length; i++) {
-                Value val = parseJson(vm, json->u.array.values[i]);
-                push(vm, val);
-                writeValueArray(vm, &list->values, val);
-                pop(vm);
-            }
+static void freeJsonWriter(JsonWriter *writer) {
+    FREE_ARRAY(writer->vm, char, writer->buffer, writer->capacity);
+}
 
-            // Pop list
-            pop(vm);
+static bool isStreaming(JsonWriter *writer) {
+    return writer->file != NULL || !IS_NIL(writer->socket);
+}
 
-            return OBJ_VAL(list);
-        }
+static void flushOutput(JsonWriter *writer, const char *chars, size_t length) {
+    if (writer->error != 0 || length == 0) {
+        return;
+    }
 
-        case json_integer: {
-            return NUMBER_VAL(json->u.integer);
-        }
+    bool result;
 
-        case json_double: {
-            return NUMBER_VAL(json->u.dbl);
-        }
+    if (writer->file != NULL) {
+        result = fwrite(chars, sizeof(char), length, writer->file) == length;
+    } else {
+        result = sendAllSocket(writer->socket, chars, length);
+    }
 
-        case json_string: {
-            return OBJ_VAL(copyString(vm, json->u.string.ptr, json->u.string.length));
-        }
+    if (!result) {
+        writer->error = JSON_EIO;
+        return;
+    }
+
+    writer->written += length;
+}
 
-        case json_boolean: {
-            return BOOL_VAL(json->u.boolean);
+static void flushJsonWriter(JsonWriter *writer) {
+    flushOutput(writer, writer->buffer, writer->length);
+    writer->length = 0;
+}
+
+static void reserveOutput(JsonWriter *writer, int length) {
+    if (writer->capacity >= writer->length + length) {
+        return;
+    }
+
+    int oldCapacity = writer->capacity;
+    int capacity = GROW_CAPACITY(oldCapacity);
+
+    while (capacity < writer->length + length) {
+        capacity *= 2;
+    }
+
+    writer->buffer = GROW_ARRAY(writer->vm, writer->buffer, char, oldCapacity, capacity);
+    writer->capacity = capacity;
+}
+
+static void writeChars(JsonWriter *writer, const char *chars, int length) {
+    if (isStreaming(writer) && writer->length + length > JSON_WRITE_BUFFER_SIZE) {
+        flushJsonWriter(writer);
+
+        // Too big to be worth buffering
+        if (length > JSON_WRITE_BUFFER_SIZE) {
+            flushOutput(writer, chars, length);
+            return;
         }
+    }
 
-        default: {
-            errno = JSON_ENOTYPE;
-            return EMPTY_VAL;
+    reserveOutput(writer, length);
+    memcpy(writer->buffer + writer->length, chars, length);
+    writer->length += length;
+}
+
+static inline void writeChar(JsonWriter *writer, char c) {
+    if (writer->length < writer->capacity) {
+        writer->buffer[writer->length++] = c;
+        return;
+    }
+
+    writeChars(writer, &c, 1);
+}
+
+static void writeNewline(JsonWriter *writer) {
+    int length = 1 + writer->depth * writer->indent;
+    char indentation[256];
+
+    if (length > (int) sizeof(indentation)) {
+        writeChar(writer, '\n');
+
+        for (int i = 0; i < writer->depth * writer->indent; ++i) {
+            writeChar(writer, ' ');
         }
+
+        return;
     }
+
+    indentation[0] = '\n';
+    memset(indentation + 1, ' ', length - 1);
+    writeChars(writer, indentation, length);
 }
 
-static Value parse(DictuVM *vm, int argCount, Value *args) {
-    if (argCount != 1) {
-        runtimeError(vm, "parse() takes 1 argument (%d given)", argCount);
-        return EMPTY_VAL;
+static void writeSeparator(JsonWriter *writer) {
+    switch (writer->mode) {
+        case JSON_SINGLE_LINE:
+            writeChars(writer, ", ", 2);
+            break;
+
+        case JSON_COMPACT:
+            writeChar(writer, ',');
+            break;
+
+        case JSON_MULTILINE:
+            writeChar(writer, ',');
+            writeNewline(writer);
+            break;
     }
+}
 
-    if (!IS_STRING(args[0])) {
-        runtimeError(vm, "parse() argument must be a string.");
-        return EMPTY_VAL;
+static void writeNumber(JsonWriter *writer, double number) {
+    char digits[32];
+    int length;
+
+    if (isnan(number) || isinf(number)) {
+        // JSON has no representation for these
+        writeChars(writer, "null", 4);
+        return;
     }
 
-    ObjString *json = AS_STRING(args[0]);
-    json_value *json_obj = json_parse(json->chars, json->length);
+    if (fabs(number) < 1e18 && number == (int64_t) number) {
+        int64_t integer = (int64_t) number;
+        uint64_t magnitude = integer < 0 ? -(uint64_t) integer : (uint64_t) integer;
+        char *end = digits + sizeof(digits);
+        char *start = end;
 
-    if (json_obj == NULL) {
-        errno = JSON_EINVAL;
-        SET_ERRNO(GET_SELF_CLASS);
-        return NIL_VAL;
+        do {
+            *--start = '0' + magnitude % 10;
+            magnitude /= 10;
+        } while (magnitude != 0);
+
+        if (integer < 0) {
+            *--start = '-';
+        }
+
+        writeChars(writer, start, end - start);
+        return;
     }
 
-    Value val = parseJson(vm, json_obj);
+    // Use the shortest representation that reads back as the same double
+    length = snprintf(digits, sizeof(digits), "%.15g", number);
+    if (strtod(digits, NULL) != number) {
+        length = snprintf(digits, sizeof(digits), "%.17g", number);
+    }
 
-    if (val == EMPTY_VAL) {
-        SET_ERRNO(GET_SELF_CLASS);
-        return NIL_VAL;
+    writeChars(writer, digits, length);
+}
+
+static void writeString(JsonWriter *writer, const char *chars, int length) {
+    const char *current = chars;
+    const char *end = chars + length;
+
+    writeChar(writer, '"');
+
+    while (current < end) {
+        // Copy everything up to the next character that needs escaping
+        const char *stop = jsonScanner.scanString(current, end);
+        writeChars(writer, current, stop - current);
+
+        if (stop == end) {
+            break;
+        }
+
+        unsigned char c = *stop;
+
+        switch (c) {
+            case '"': writeChars(writer, "\\\"", 2); break;
+            case '\\': writeChars(writer, "\\\\", 2); break;
+            case '\b': writeChars(writer, "\\b", 2); break;
+            case '\f': writeChars(writer, "\\f", 2); break;
+            case '\n': writeChars(writer, "\\n", 2); break;
+            case '\r': writeChars(writer, "\\r", 2); break;
+            case '\t': writeChars(writer, "\\t", 2); break;
+            default: {
+                char escape[7];
+                snprintf(escape, sizeof(escape), "\\u%04x", c);
+                writeChars(writer, escape, 6);
+            }
+        }
+
+        current = stop + 1;
     }
 
-    json_value_free(json_obj);
+    writeChar(writer, '"');
+}
+
+static void writeKey(JsonWriter *writer, Value key) {
+    if (IS_STRING(key)) {
+        ObjString *string = AS_STRING(key);
+        writeString(writer, string->chars, string->length);
+    } else if (IS_NIL(key)) {
+        writeChars(writer, "\"null\"", 6);
+    } else {
+        char *string = valueToString(key);
+        writeString(writer, string, strlen(string));
+        free(string);
+    }
 
-    return val;
+    if (writer->mode == JSON_COMPACT) {
+        writeChar(writer, ':');
+    } else {
+        writeChars(writer, ": ", 2);
+    }
 }
 
-json_value* stringifyJson(DictuVM *vm, Value value) {
+static bool writeValue(JsonWriter *writer, Value value) {
     if (IS_NIL(value)) {
-        return json_null_new();
-    } else if (IS_BOOL(value)) {
-        return json_boolean_new(AS_BOOL(value));
-    } else if (IS_NUMBER(value)) {
-        double num = AS_NUMBER(value);
+        writeChars(writer, "null", 4);
+        return true;
+    }
+
+    if (IS_BOOL(value)) {
+        if (AS_BOOL(value)) {
+            writeChars(writer, "true", 4);
+        } else {
+            writeChars(writer, "false", 5);
+        }
+
+        return true;
+    }
+
+    if (IS_NUMBER(value)) {
+        writeNumber(writer, AS_NUMBER(value));
+        return true;
+    }
+
+    if (!IS_OBJ(value)) {
+        return false;
+    }
 
-        if ((int) num == num) {
-            return json_integer_new((int) num);
+    switch (AS_OBJ(value)->type) {
+        case OBJ_STRING: {
+            ObjString *string = AS_STRING(value);
+            writeString(writer, string->chars, string->length);
+            return true;
         }
 
-        return json_double_new(num);
-    } else if (IS_OBJ(value)) {
-        switch (AS_OBJ(value)->type) {
-            case OBJ_STRING: {
-                return json_string_new(AS_CSTRING(value));
+        case OBJ_LIST: {
+            ObjList *list = AS_LIST(value);
+
+            if (list->values.count == 0) {
+                writeChars(writer, "[]", 2);
+                return true;
             }
 
-            case OBJ_LIST: {
-                ObjList *list = AS_LIST(value);
-                json_value *json = json_array_new(list->values.count);
+            // Also stops self referencing lists recursing forever
+            if (writer->depth == JSON_MAX_DEPTH) {
+                return false;
+            }
+
+            writeChar(writer, '[');
+            writer->depth++;
+
+            if (writer->mode == JSON_MULTILINE) {
+                writeNewline(writer);
+            }
 
-                for (int i = 0; i < list->values.count; i++) {
-                    json_array_push(json, stringifyJson(vm, list->values.values[i]));
+            for (int i = 0; i < list->values.count; i++) {
+                if (i != 0) {
+                    writeSeparator(writer);
                 }
 
-                return json;
+                if (!writeValue(writer, list->values.values[i])) {
+                    return false;
+                }
             }
 
-            case OBJ_DICT: {
-                ObjDict *dict = AS_DICT(value);
-                json_value *json = json_object_new(dict->count);
+            writer->depth--;
 
-                for (int i = 0; i <= dict->capacityMask; i++) {
-                    DictItem *entry = &dict->entries[i];
-                    if (IS_EMPTY(entry->key)) {
-                        continue;
-                    }
+            if (writer->mode == JSON_MULTILINE) {
+                writeNewline(writer);
+            }
 
-                    char *key;
-
-                    if (IS_STRING(entry->key)) {
-                        ObjString *s = AS_STRING(entry->key);
-                        key = s->chars;
-                    } else if (IS_NIL(entry->key)) {
-                        key = malloc(5);
-                        memcpy(key, "null", 4);
-                        key[4] = '\0';
-                    } else {
-                        key = valueToString(entry->key);
-                    }
+            writeChar(writer, ']');
+            return true;
+        }
 
-                    json_object_push(
-                            json,
-                            key,
-                            stringifyJson(vm, entry->value)
-                    );
+        case OBJ_DICT: {
+            ObjDict *dict = AS_DICT(value);
 
-                    if (!IS_STRING(entry->key)) {
-                        free(key);
-                    }
+            if (dict->count == 0) {
+                writeChars(writer, "{}", 2);
+                return true;
+            }
+
+            if (writer->depth == JSON_MAX_DEPTH) {
+                return false;
+            }
+
+            writeChar(writer, '{');
+            writer->depth++;
+
+            if (writer->mode == JSON_MULTILINE) {
+                writeNewline(writer);
+            }
+
+            bool first = true;
+
+            for (int i = 0; i <= dict->capacityMask; i++) {
+                DictItem *entry = &dict->entries[i];
+                if (IS_EMPTY(entry->key)) {
+                    continue;
+                }
+
+                if (!first) {
+                    writeSeparator(writer);
                 }
 
-                return json;
+                first = false;
+                writeKey(writer, entry->key);
+
+                if (!writeValue(writer, entry->value)) {
+                    return false;
+                }
+            }
+
+            writer->depth--;
+
+            if (writer->mode == JSON_MULTILINE) {
+                writeNewline(writer);
             }
 
-            // Pass through and return NULL
-            default: {}
+            writeChar(writer, '}');
+            return true;
+        }
+
+        default: {
+            return false;
         }
     }
+}
+
+static bool getWriteMode(DictuVM *vm, const char *function, Value indent, JsonWriteMode *mode) {
+    if (!IS_NUMBER(indent)) {
+        runtimeError(vm, "%s() indent argument must be a number.", function);
+        return false;
+    }
+
+    if (AS_NUMBER(indent) < 0) {
+        runtimeError(vm, "%s() indent argument must not be negative.", function);
+        return false;
+    }
 
-    return NULL;
+    *mode = AS_NUMBER(indent) == 0 ? JSON_COMPACT : JSON_MULTILINE;
+    return true;
 }
 
 static Value stringify(DictuVM *vm, int argCount, Value *args) {
@@ -230,49 +1174,334 @@ static Value stringify(DictuVM *vm, int argCount, Value *args) {
         return EMPTY_VAL;
     }
 
-    int indent = 4;
-    int lineType = json_serialize_mode_single_line;
+    JsonWriteMode mode = JSON_SINGLE_LINE;
+    int indent = 0;
 
     if (argCount == 2) {
-        if (!IS_NUMBER(args[1])) {
-            runtimeError(vm, "stringify() second argument must be a number.");
+        if (!getWriteMode(vm, "stringify", args[1], &mode)) {
             return EMPTY_VAL;
         }
 
-        lineType = json_serialize_mode_multiline;
         indent = AS_NUMBER(args[1]);
     }
 
-    json_value *json = stringifyJson(vm, args[0]);
+    JsonWriter writer;
+    initJsonWriter(vm, &writer, mode, indent);
 
-    if (json == NULL) {
+    if (!writeValue(&writer, args[0])) {
+        freeJsonWriter(&writer);
         errno = JSON_ENOSERIAL;
         SET_ERRNO(GET_SELF_CLASS);
         return NIL_VAL;
     }
 
-    json_serialize_opts default_opts =
-    {
-        lineType,
-        json_serialize_opt_pack_brackets,
-        indent
-    };
+    // Hand the buffer over to the string, trimmed to size with room for the terminator
+    char *buffer = SHRINK_ARRAY(vm, writer.buffer, char, writer.capacity, writer.length + 1);
+    return OBJ_VAL(takeString(vm, buffer, writer.length));
+}
+
+static bool setWriterOutput(DictuVM *vm, const char *argument, JsonWriter *writer, Value output) {
+    if (IS_FILE(output)) {
+        ObjFile *file = AS_FILE(output);
+
+        if (!file->isOpen) {
+            runtimeError(vm, "%s argument is a file that has been closed.", argument);
+            return false;
+        }
+
+        if (file->openType[0] == 'r' && strchr(file->openType, '+') == NULL) {
+            runtimeError(vm, "File is not writable!");
+            return false;
+        }
+
+        writer->file = file->file;
+        return true;
+    }
+
+    if (isSocket(output)) {
+        writer->socket = output;
+        return true;
+    }
+
+    runtimeError(vm, "%s argument must be a file or a socket.", argument);
+    return false;
+}
+
+static Value finishStreaming(DictuVM *vm, ObjModule *module, JsonWriter *writer) {
+    flushJsonWriter(writer);
+    freeJsonWriter(writer);
+
+    if (writer->file != NULL) {
+        fflush(writer->file);
+    }
+
+    if (writer->error != 0) {
+        errno = writer->error;
+        SET_ERRNO(module);
+        return NIL_VAL;
+    }
+
+    return NUMBER_VAL(writer->written);
+}
+
+static Value dump(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 2 && argCount != 3) {
+        runtimeError(vm, "dump() takes 2 or 3 arguments (%d given).", argCount);
+        return EMPTY_VAL;
+    }
+
+    JsonWriteMode mode = JSON_SINGLE_LINE;
+    int indent = 0;
+
+    if (argCount == 3) {
+        if (!getWriteMode(vm, "dump", args[2], &mode)) {
+            return EMPTY_VAL;
+        }
+
+        indent = AS_NUMBER(args[2]);
+    }
+
+    JsonWriter writer;
+    initJsonWriter(vm, &writer, mode, indent);
+
+    if (!setWriterOutput(vm, "dump() second", &writer, args[1])) {
+        return EMPTY_VAL;
+    }
+
+    if (!writeValue(&writer, args[0])) {
+        writer.error = JSON_ENOSERIAL;
+    }
+
+    return finishStreaming(vm, GET_SELF_CLASS, &writer);
+}
+
+static Value writeLines(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 2) {
+        runtimeError(vm, "writeLines() takes 2 arguments (%d given).", argCount);
+        return EMPTY_VAL;
+    }
+
+    if (!IS_LIST(args[1])) {
+        runtimeError(vm, "writeLines() second argument must be a list.");
+        return EMPTY_VAL;
+    }
+
+    JsonWriter writer;
+    initJsonWriter(vm, &writer, JSON_COMPACT, 0);
+
+    if (!setWriterOutput(vm, "writeLines() first", &writer, args[0])) {
+        return EMPTY_VAL;
+    }
+
+    ObjList *list = AS_LIST(args[1]);
+
+    for (int i = 0; i < list->values.count && writer.error == 0; ++i) {
+        if (!writeValue(&writer, list->values.values[i])) {
+            writer.error = JSON_ENOSERIAL;
+            break;
+        }
+
+        writeChar(&writer, '\n');
+    }
+
+    return finishStreaming(vm, GET_SELF_CLASS, &writer);
+}
+
+typedef struct {
+    // Also held in the reader's values so the GC keeps it alive
+    ObjFile *file;
+    // Reused for every record
+    char *line;
+    int lineCapacity;
+    int lineLength;
+    // Set once hasNext() has read the next record ahead
+    bool buffered;
+    JsonProjection projection;
+} JsonLinesReader;
+
+#define AS_JSON_LINES_READER(v) ((JsonLinesReader*)AS_ABSTRACT(v)->data)
+
+static ObjModule *getJsonModule(DictuVM *vm) {
+    Value module = 0;
+    tableGet(&vm->modules, copyString(vm, "JSON", 4), &module);
+    return AS_MODULE(module);
+}
+
+/**
+ * Reads the next non blank line into the reader's buffer, returning false at
+ * the end of the file.
+ */
+static bool readRecord(DictuVM *vm, JsonLinesReader *reader) {
+    for (;;) {
+        reader->lineLength = 0;
+
+        for (;;) {
+            if (reader->lineCapacity - reader->lineLength < 2) {
+                int oldCapacity = reader->lineCapacity;
+                reader->lineCapacity = GROW_CAPACITY(oldCapacity);
+                reader->line = GROW_ARRAY(vm, reader->line, char, oldCapacity, reader->lineCapacity);
+            }
+
+            char *chunk = reader->line + reader->lineLength;
+            if (fgets(chunk, reader->lineCapacity - reader->lineLength, reader->file->file) == NULL) {
+                break;
+            }
+
+            reader->lineLength += strlen(chunk);
+
+            if (reader->line[reader->lineLength - 1] == '\n') {
+                break;
+            }
+        }
+
+        if (reader->lineLength == 0) {
+            return false;
+        }
+
+        while (reader->lineLength > 0 &&
+               (reader->line[reader->lineLength - 1] == '\n' || reader->line[reader->lineLength - 1] == '\r')) {
+            reader->lineLength--;
+        }
+
+        reader->line[reader->lineLength] = '\0';
+
+        const char *end = reader->line + reader->lineLength;
+        if (jsonScanner.skipWhitespace(reader->line, end) != end) {
+            return true;
+        }
+    }
+}
+
+static Value hasNextJsonLines(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 0) {
+        runtimeError(vm, "hasNext() takes no arguments (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    JsonLinesReader *reader = AS_JSON_LINES_READER(args[0]);
+
+    if (!reader->file->isOpen) {
+        runtimeError(vm, "hasNext() file has been closed");
+        return EMPTY_VAL;
+    }
+
+    if (!reader->buffered) {
+        reader->buffered = readRecord(vm, reader);
+    }
+
+    return BOOL_VAL(reader->buffered);
+}
+
+static Value nextJsonLines(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 0) {
+        runtimeError(vm, "next() takes no arguments (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    JsonLinesReader *reader = AS_JSON_LINES_READER(args[0]);
+
+    if (!reader->file->isOpen) {
+        runtimeError(vm, "next() file has been closed");
+        return EMPTY_VAL;
+    }
+
+    if (!reader->buffered && !readRecord(vm, reader)) {
+        return NIL_VAL;
+    }
+
+    reader->buffered = false;
+
+    JsonProjection *projection = reader->projection.count > 0 ? &reader->projection : NULL;
+    Value val;
+
+    if (!parseJson(vm, reader->line, reader->lineLength, projection, &val)) {
+        errno = JSON_EINVAL;
+        SET_ERRNO(getJsonModule(vm));
+        return NIL_VAL;
+    }
+
+    return val;
+}
+
+static void freeJsonLines(DictuVM *vm, ObjAbstract *abstract) {
+    JsonLinesReader *reader = abstract->data;
+
+    for (int i = 0; i < reader->projection.count; ++i) {
+        FREE_ARRAY(vm, char, reader->projection.keys[i], reader->projection.lengths[i]);
+    }
+
+    FREE_ARRAY(vm, char *, reader->projection.keys, reader->projection.count);
+    FREE_ARRAY(vm, int, reader->projection.lengths, reader->projection.count);
+    FREE_ARRAY(vm, char, reader->line, reader->lineCapacity);
+    FREE(vm, JsonLinesReader, abstract->data);
+}
+
+static Value lines(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 1 && argCount != 2) {
+        runtimeError(vm, "lines() takes 1 or 2 arguments (%d given).", argCount);
+        return EMPTY_VAL;
+    }
+
+    if (!IS_FILE(args[0])) {
+        runtimeError(vm, "lines() first argument must be a file.");
+        return EMPTY_VAL;
+    }
+
+    ObjList *keys = NULL;
 
+    if (argCount == 2) {
+        if (!IS_LIST(args[1])) {
+            runtimeError(vm, "lines() second argument must be a list.");
+            return EMPTY_VAL;
+        }
+
+        keys = AS_LIST(args[1]);
+
+        for (int i = 0; i < keys->values.count; ++i) {
+            if (!IS_STRING(keys->values.values[i])) {
+                runtimeError(vm, "lines() keys must be strings.");
+                return EMPTY_VAL;
+            }
+        }
+    }
 
-    int length = json_measure_ex(json, default_opts);
-    char *buf = ALLOCATE(vm, char, length);
-    json_serialize_ex(buf, json, default_opts);
-    int actualLength = strlen(buf);
+    ObjAbstract *abstract = initAbstract(vm, freeJsonLines);
+    push(vm, OBJ_VAL(abstract));
 
-    // json_measure_ex can produce a length larger than the actual string returned
-    // so we need to cater for this case
-    if (actualLength != length) {
-        buf = SHRINK_ARRAY(vm, buf, char, length, actualLength + 1);
+    JsonLinesReader *reader = ALLOCATE(vm, JsonLinesReader, 1);
+    reader->file = AS_FILE(args[0]);
+    reader->line = NULL;
+    reader->lineCapacity = 0;
+    reader->lineLength = 0;
+    reader->buffered = false;
+    reader->projection.count = 0;
+    reader->projection.keys = NULL;
+    reader->projection.lengths = NULL;
+    abstract->data = reader;
+
+    if (keys != NULL && keys->values.count > 0) {
+        int count = keys->values.count;
+        reader->projection.keys = ALLOCATE(vm, char *, count);
+        reader->projection.lengths = ALLOCATE(vm, int, count);
+
+        for (int i = 0; i < count; ++i) {
+            ObjString *key = AS_STRING(keys->values.values[i]);
+            reader->projection.keys[i] = ALLOCATE(vm, char, key->length);
+            memcpy(reader->projection.keys[i], key->chars, key->length);
+            reader->projection.lengths[i] = key->length;
+            reader->projection.count++;
+        }
     }
 
-    ObjString *string = takeString(vm, buf, actualLength);
-    json_builder_free(json);
-    return OBJ_VAL(string);
+    /**
+     * Setup JSON lines reader methods
+     */
+    defineNativeProperty(vm, &abstract->values, "file", args[0]);
+    defineNative(vm, &abstract->values, "hasNext", hasNextJsonLines);
+    defineNative(vm, &abstract->values, "next", nextJsonLines);
+    pop(vm);
+
+    return OBJ_VAL(abstract);
 }
 
 ObjModule *createJSONModule(DictuVM *vm) {
@@ -281,12 +1510,17 @@ ObjModule *createJSONModule(DictuVM *vm) {
     ObjModule *module = newModule(vm, name);
     push(vm, OBJ_VAL(module));
 
+    initJsonScanner();
+
     /**
      * Define Json methods
      */
     defineNative(vm, &module->values, "strerror", strerrorJsonNative);
     defineNative(vm, &module->values, "parse", parse);
     defineNative(vm, &module->values, "stringify", stringify);
+    defineNative(vm, &module->values, "dump", dump);
+    defineNative(vm, &module->values, "lines", lines);
+    defineNative(vm, &module->values, "writeLines", writeLines);
 
     /**
      * Define Json properties
@@ -296,6 +1530,7 @@ ObjModule *createJSONModule(DictuVM *vm) {
     defineNativeProperty(vm, &module->values, "ENOTYPE", NUMBER_VAL(JSON_ENOTYPE));
     defineNativeProperty(vm, &module->values, "EINVAL", NUMBER_VAL(JSON_EINVAL));
     defineNativeProperty(vm, &module->values, "ENOSERIAL", NUMBER_VAL(JSON_ENOSERIAL));
+    defineNativeProperty(vm, &module->values, "EIO", NUMBER_VAL(JSON_EIO));
     pop(vm);
     pop(vm);
 
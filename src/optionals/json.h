@@ -1,8 +1,10 @@
 #ifndef dictu_json_h
 #define dictu_json_h
 
-#include "json/jsonParseLib.h"
-#include "json/jsonBuilderLib.h"
+#include <math.h>
+
+#include "json/jsonScan.h"
+#include "socket.h"
 #include "optionals.h"
 #include "../vm/vm.h"
 
@@ -0,0 +1,230 @@
+#include <stdint.h>
+
+#include "jsonScan.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define JSON_SCAN_SSE2
+#include <emmintrin.h>
+
+#if defined(__GNUC__)
+#define JSON_SCAN_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+#define JSON_BLOCK_SIZE 64
+
+// Bytes that end the fast path while scanning a string
+static const uint8_t stringStop[256] = {
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    ['"'] = 1,
+    ['\\'] = 1
+};
+
+static const uint8_t whitespace[256] = {
+    [' '] = 1,
+    ['\t'] = 1,
+    ['\n'] = 1,
+    ['\r'] = 1
+};
+
+static const char *scanStringScalar(const char *current, const char *end) {
+    while (current < end && !stringStop[(uint8_t) *current]) {
+        current++;
+    }
+
+    return current;
+}
+
+static const char *skipWhitespaceScalar(const char *current, const char *end) {
+    while (current < end && whitespace[(uint8_t) *current]) {
+        current++;
+    }
+
+    return current;
+}
+
+#ifdef JSON_SCAN_SSE2
+static inline int ctz64(uint64_t mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return index;
+#else
+    return __builtin_ctzll(mask);
+#endif
+}
+
+static inline uint32_t stringMaskSSE2(__m128i chunk) {
+    __m128i quote = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('"'));
+    __m128i backslash = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\'));
+    // Unsigned chunk <= 0x1F
+    __m128i control = _mm_cmpeq_epi8(_mm_max_epu8(chunk, _mm_set1_epi8(0x1F)), _mm_set1_epi8(0x1F));
+
+    return _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(quote, backslash), control));
+}
+
+static inline uint32_t whitespaceMaskSSE2(__m128i chunk) {
+    __m128i space = _mm_cmpeq_epi8(chunk, _mm_set1_epi8(' '));
+    __m128i tab = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\t'));
+    __m128i newline = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n'));
+    __m128i carriage = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r'));
+
+    return _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(space, tab), _mm_or_si128(newline, carriage)));
+}
+
+static uint64_t blockStringMaskSSE2(const char *block) {
+    uint64_t mask = 0;
+
+    for (int i = 0; i < JSON_BLOCK_SIZE; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *) (block + i));
+        mask |= (uint64_t) stringMaskSSE2(chunk) << i;
+    }
+
+    return mask;
+}
+
+static uint64_t blockWhitespaceMaskSSE2(const char *block) {
+    uint64_t mask = 0;
+
+    for (int i = 0; i < JSON_BLOCK_SIZE; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *) (block + i));
+        mask |= (uint64_t) whitespaceMaskSSE2(chunk) << i;
+    }
+
+    return mask;
+}
+
+static const char *scanStringSSE2(const char *current, const char *end) {
+    while (end - current >= JSON_BLOCK_SIZE) {
+        uint64_t mask = blockStringMaskSSE2(current);
+        if (mask != 0) {
+            return current + ctz64(mask);
+        }
+
+        current += JSON_BLOCK_SIZE;
+    }
+
+    while (end - current >= 16) {
+        uint32_t mask = stringMaskSSE2(_mm_loadu_si128((const __m128i *) current));
+        if (mask != 0) {
+            return current + ctz64(mask);
+        }
+
+        current += 16;
+    }
+
+    return scanStringScalar(current, end);
+}
+
+static const char *skipWhitespaceSSE2(const char *current, const char *end) {
+    // Most gaps between tokens are a single byte, so only go wide on long runs
+    current = skipWhitespaceScalar(current, current + 2 < end ? current + 2 : end);
+    if (current == end || !whitespace[(uint8_t) *current]) {
+        return current;
+    }
+
+    while (end - current >= JSON_BLOCK_SIZE) {
+        uint64_t mask = ~blockWhitespaceMaskSSE2(current);
+        if (mask != 0) {
+            return current + ctz64(mask);
+        }
+
+        current += JSON_BLOCK_SIZE;
+    }
+
+    return skipWhitespaceScalar(current, end);
+}
+#endif
+
+#ifdef JSON_SCAN_AVX2
+__attribute__((target("avx2")))
+static inline uint32_t stringMaskAVX2(__m256i chunk) {
+    __m256i quote = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"'));
+    __m256i backslash = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\\'));
+    __m256i control = _mm256_cmpeq_epi8(_mm256_max_epu8(chunk, _mm256_set1_epi8(0x1F)), _mm256_set1_epi8(0x1F));
+
+    return _mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(quote, backslash), control));
+}
+
+__attribute__((target("avx2")))
+static inline uint32_t whitespaceMaskAVX2(__m256i chunk) {
+    __m256i space = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' '));
+    __m256i tab = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\t'));
+    __m256i newline = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n'));
+    __m256i carriage = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\r'));
+
+    return _mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(space, tab), _mm256_or_si256(newline, carriage)));
+}
+
+__attribute__((target("avx2")))
+static const char *scanStringAVX2(const char *current, const char *end) {
+    while (end - current >= JSON_BLOCK_SIZE) {
+        uint64_t low = stringMaskAVX2(_mm256_loadu_si256((const __m256i *) current));
+        uint64_t high = stringMaskAVX2(_mm256_loadu_si256((const __m256i *) (current + 32)));
+        uint64_t mask = low | (high << 32);
+
+        if (mask != 0) {
+            return current + ctz64(mask);
+        }
+
+        current += JSON_BLOCK_SIZE;
+    }
+
+    if (end - current >= 32) {
+        uint32_t mask = stringMaskAVX2(_mm256_loadu_si256((const __m256i *) current));
+        if (mask != 0) {
+            return current + ctz64(mask);
+        }
+
+        current += 32;
+    }
+
+    return scanStringSSE2(current, end);
+}
+
+__attribute__((target("avx2")))
+static const char *skipWhitespaceAVX2(const char *current, const char *end) {
+    current = skipWhitespaceScalar(current, current + 2 < end ? current + 2 : end);
+    if (current == end || !whitespace[(uint8_t) *current]) {
+        return current;
+    }
+
+    while (end - current >= JSON_BLOCK_SIZE) {
+        uint64_t low = whitespaceMaskAVX2(_mm256_loadu_si256((const __m256i *) current));
+        uint64_t high = whitespaceMaskAVX2(_mm256_loadu_si256((const __m256i *) (current + 32)));
+        uint64_t mask = ~(low | (high << 32));
+
+        if (mask != 0) {
+            return current + ctz64(mask);
+        }
+
+        current += JSON_BLOCK_SIZE;
+    }
+
+    return skipWhitespaceScalar(current, end);
+}
+#endif
+
+JsonScanner jsonScanner = {
+    scanStringScalar,
+    skipWhitespaceScalar
+};
+
+void initJsonScanner(void) {
+#ifdef JSON_SCAN_AVX2
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) {
+        jsonScanner.scanString = scanStringAVX2;
+        jsonScanner.skipWhitespace = skipWhitespaceAVX2;
+        return;
+    }
+#endif
+
+#ifdef JSON_SCAN_SSE2
+    jsonScanner.scanString = scanStringSSE2;
+    jsonScanner.skipWhitespace = skipWhitespaceSSE2;
+#endif
+}
@@ -0,0 +1,23 @@
+#ifndef dictu_json_scan_h
+#define dictu_json_scan_h
+
+/**
+ * Block scanners used by the JSON parser to skip over runs of bytes that
+ * need no per-byte handling. Vectorised versions are selected at runtime
+ * based on what the CPU supports, with a scalar fallback.
+ */
+
+typedef const char *(*JsonScanFn)(const char *current, const char *end);
+
+typedef struct {
+    // Returns the first byte that is a quote, backslash or control character
+    JsonScanFn scanString;
+    // Returns the first byte that is not JSON whitespace
+    JsonScanFn skipWhitespace;
+} JsonScanner;
+
+extern JsonScanner jsonScanner;
+
+void initJsonScanner(void);
+
+#endif //dictu_json_scan_h
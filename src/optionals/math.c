@@ -1,6 +1,7 @@
 #include "math.h"
 #include "../vm/vm.h"
 #include <math.h>
+#include <limits.h>
 
 static Value averageNative(DictuVM *vm, int argCount, Value *args) {
     double average = 0;
@@ -221,6 +222,1066 @@ static Value tanNative(DictuVM *vm, int argCount, Value *args) {
     return NUMBER_VAL(tan(AS_NUMBER(args[0])));
 }
 
+/**
+ * Statistics kernels.
+ *
+ * Each checks the whole list up front, so the loops doing the arithmetic
+ * have no per-element type checks or branches and the compiler can
+ * vectorise them. The reductions keep several independent accumulators
+ * for the same reason.
+ */
+
+static bool isNumericList(const Value *values, int count) {
+    bool numeric = true;
+
+    for (int i = 0; i < count; ++i) {
+        numeric &= IS_NUMBER(values[i]);
+    }
+
+    return numeric;
+}
+
+// Fetches the values of a list argument, raising an error unless they are all numbers
+static bool getNumberList(DictuVM *vm, const char *name, Value value, Value **values, int *count) {
+    if (!IS_LIST(value)) {
+        runtimeError(vm, "%s() argument must be a list", name);
+        return false;
+    }
+
+    ObjList *list = AS_LIST(value);
+
+    if (!isNumericList(list->values.values, list->values.count)) {
+        runtimeError(vm, "A non-number value passed to %s()", name);
+        return false;
+    }
+
+    *values = list->values.values;
+    *count = list->values.count;
+    return true;
+}
+
+// As getNumberList, but also accepts the numbers as separate arguments like sum() does
+static bool getNumberIterable(DictuVM *vm, const char *name, int argCount, Value *args, Value **values, int *count) {
+    if (argCount == 1 && IS_LIST(args[0])) {
+        return getNumberList(vm, name, args[0], values, count);
+    }
+
+    if (!isNumericList(args, argCount)) {
+        runtimeError(vm, "A non-number value passed to %s()", name);
+        return false;
+    }
+
+    *values = args;
+    *count = argCount;
+    return true;
+}
+
+static double *copyNumbers(DictuVM *vm, const Value *values, int count) {
+    double *numbers = ALLOCATE(vm, double, count);
+
+    for (int i = 0; i < count; ++i) {
+        numbers[i] = AS_NUMBER(values[i]);
+    }
+
+    return numbers;
+}
+
+/**
+ * Welford's algorithm, run as 4 interleaved streams which are merged at the
+ * end with Chan et al's pairwise update. Every stream has seen the same
+ * number of values within the main loop so they share the reciprocal.
+ */
+static double sumOfSquaredDeviations(const Value *values, int count) {
+    double mean[4] = {0, 0, 0, 0};
+    double m2[4] = {0, 0, 0, 0};
+    int blocks = count / 4;
+
+    for (int i = 0; i < blocks; ++i) {
+        double inverse = 1.0 / (i + 1);
+
+        for (int j = 0; j < 4; ++j) {
+            double x = AS_NUMBER(values[i * 4 + j]);
+            double delta = x - mean[j];
+            mean[j] += delta * inverse;
+            m2[j] += delta * (x - mean[j]);
+        }
+    }
+
+    double n = blocks;
+    double totalMean = mean[0];
+    double totalM2 = m2[0];
+
+    for (int j = 1; j < 4; ++j) {
+        double merged = n * j + n;
+        if (merged == 0) {
+            continue;
+        }
+
+        double delta = mean[j] - totalMean;
+        totalMean += delta * n / merged;
+        totalM2 += m2[j] + delta * delta * (n * j) * n / merged;
+    }
+
+    n *= 4;
+
+    for (int i = blocks * 4; i < count; ++i) {
+        double x = AS_NUMBER(values[i]);
+        n++;
+        double delta = x - totalMean;
+        totalMean += delta / n;
+        totalM2 += delta * (x - totalMean);
+    }
+
+    return totalM2;
+}
+
+static Value varianceOf(DictuVM *vm, const char *name, int argCount, Value *args, bool root) {
+    if (argCount != 1 && argCount != 2) {
+        runtimeError(vm, "%s() takes 1 or 2 arguments (%d given).", name, argCount);
+        return EMPTY_VAL;
+    }
+
+    Value *values;
+    int count;
+    if (!getNumberList(vm, name, args[0], &values, &count)) {
+        return EMPTY_VAL;
+    }
+
+    bool population = false;
+
+    if (argCount == 2) {
+        if (!IS_BOOL(args[1])) {
+            runtimeError(vm, "Optional argument passed to %s() must be a boolean.", name);
+            return EMPTY_VAL;
+        }
+
+        population = AS_BOOL(args[1]);
+    }
+
+    int required = population ? 1 : 2;
+
+    if (count < required) {
+        runtimeError(vm, "%s() requires at least %d values (%d given).", name, required, count);
+        return EMPTY_VAL;
+    }
+
+    double variance = sumOfSquaredDeviations(values, count) / (population ? count : count - 1);
+
+    return NUMBER_VAL(root ? sqrt(variance) : variance);
+}
+
+static Value varianceNative(DictuVM *vm, int argCount, Value *args) {
+    return varianceOf(vm, "variance", argCount, args, false);
+}
+
+static Value stddevNative(DictuVM *vm, int argCount, Value *args) {
+    return varianceOf(vm, "stddev", argCount, args, true);
+}
+
+static void swapNumbers(double *a, double *b) {
+    double tmp = *a;
+    *a = *b;
+    *b = tmp;
+}
+
+/**
+ * Rearranges numbers[low..high] so numbers[k] holds the value it would in
+ * sorted order, with nothing larger before it and nothing smaller after it.
+ * Quickselect with a median of three pivot, expected O(n).
+ */
+static void selectNth(double *numbers, int low, int high, int k) {
+    while (high > low) {
+        int middle = low + (high - low) / 2;
+
+        if (numbers[middle] < numbers[low]) swapNumbers(&numbers[middle], &numbers[low]);
+        if (numbers[high] < numbers[low]) swapNumbers(&numbers[high], &numbers[low]);
+        if (numbers[high] < numbers[middle]) swapNumbers(&numbers[high], &numbers[middle]);
+
+        double pivot = numbers[middle];
+        int i = low;
+        int j = high;
+
+        while (i <= j) {
+            while (numbers[i] < pivot) i++;
+            while (numbers[j] > pivot) j--;
+
+            if (i <= j) {
+                swapNumbers(&numbers[i], &numbers[j]);
+                i++;
+                j--;
+            }
+        }
+
+        if (k <= j) {
+            high = j;
+        } else if (k >= i) {
+            low = i;
+        } else {
+            return;
+        }
+    }
+}
+
+static int compareNumbers(const void *a, const void *b) {
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Percentiles of numbers (which get reordered), interpolating linearly
+ * between the closest ranks. The ranks are selected in ascending order so
+ * each selection only has to look at what's to the right of the last.
+ */
+static void percentilesOf(DictuVM *vm, double *numbers, int count, const double *percents, double *results, int resultCount) {
+    double *ranks = ALLOCATE(vm, double, resultCount * 2);
+
+    for (int i = 0; i < resultCount; ++i) {
+        ranks[i] = percents[i] / 100 * (count - 1);
+    }
+
+    memcpy(ranks + resultCount, ranks, sizeof(double) * resultCount);
+    qsort(ranks + resultCount, resultCount, sizeof(double), compareNumbers);
+
+    int low = 0;
+
+    for (int i = 0; i < resultCount; ++i) {
+        double sorted = ranks[resultCount + i];
+        int rank = floor(sorted);
+
+        if (rank >= low) {
+            selectNth(numbers, low, count - 1, rank);
+            low = rank;
+        }
+
+        // Interpolating needs the next rank up too, which is the smallest value to the right
+        if (sorted > rank && rank + 1 >= low) {
+            int smallest = rank + 1;
+
+            for (int j = rank + 2; j < count; ++j) {
+                if (numbers[j] < numbers[smallest]) {
+                    smallest = j;
+                }
+            }
+
+            swapNumbers(&numbers[rank + 1], &numbers[smallest]);
+            low = rank + 1;
+        }
+    }
+
+    for (int i = 0; i < resultCount; ++i) {
+        int rank = floor(ranks[i]);
+        double fraction = ranks[i] - rank;
+
+        results[i] = numbers[rank];
+        if (fraction > 0) {
+            results[i] += (numbers[rank + 1] - numbers[rank]) * fraction;
+        }
+    }
+
+    FREE_ARRAY(vm, double, ranks, resultCount * 2);
+}
+
+static Value medianNative(DictuVM *vm, int argCount, Value *args) {
+    Value *values;
+    int count;
+    if (!getNumberIterable(vm, "median", argCount, args, &values, &count)) {
+        return EMPTY_VAL;
+    }
+
+    if (count == 0) {
+        runtimeError(vm, "median() requires at least 1 value (0 given).");
+        return EMPTY_VAL;
+    }
+
+    double *numbers = copyNumbers(vm, values, count);
+    double percent = 50;
+    double median;
+    percentilesOf(vm, numbers, count, &percent, &median, 1);
+    FREE_ARRAY(vm, double, numbers, count);
+
+    return NUMBER_VAL(median);
+}
+
+static Value percentileNative(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 2) {
+        runtimeError(vm, "percentile() takes 2 arguments (%d given).", argCount);
+        return EMPTY_VAL;
+    }
+
+    Value *values;
+    int count;
+    if (!getNumberList(vm, "percentile", args[0], &values, &count)) {
+        return EMPTY_VAL;
+    }
+
+    if (count == 0) {
+        runtimeError(vm, "percentile() requires at least 1 value (0 given).");
+        return EMPTY_VAL;
+    }
+
+    Value *percentValues = &args[1];
+    int percentCount = 1;
+
+    if (IS_LIST(args[1])) {
+        percentValues = AS_LIST(args[1])->values.values;
+        percentCount = AS_LIST(args[1])->values.count;
+    }
+
+    for (int i = 0; i < percentCount; ++i) {
+        if (!IS_NUMBER(percentValues[i]) || AS_NUMBER(percentValues[i]) < 0 || AS_NUMBER(percentValues[i]) > 100) {
+            runtimeError(vm, "percentile() percentages must be numbers between 0 and 100");
+            return EMPTY_VAL;
+        }
+    }
+
+    double *numbers = copyNumbers(vm, values, count);
+    double *percents = copyNumbers(vm, percentValues, percentCount);
+    double *results = ALLOCATE(vm, double, percentCount);
+    percentilesOf(vm, numbers, count, percents, results, percentCount);
+
+    FREE_ARRAY(vm, double, numbers, count);
+    FREE_ARRAY(vm, double, percents, percentCount);
+
+    Value result;
+
+    if (IS_LIST(args[1])) {
+        ObjList *list = initList(vm);
+        push(vm, OBJ_VAL(list));
+
+        for (int i = 0; i < percentCount; ++i) {
+            writeValueArray(vm, &list->values, NUMBER_VAL(results[i]));
+        }
+
+        pop(vm);
+        result = OBJ_VAL(list);
+    } else {
+        result = NUMBER_VAL(results[0]);
+    }
+
+    FREE_ARRAY(vm, double, results, percentCount);
+    return result;
+}
+
+static Value histogramNative(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 2 && argCount != 4) {
+        runtimeError(vm, "histogram() takes 2 or 4 arguments (%d given).", argCount);
+        return EMPTY_VAL;
+    }
+
+    Value *values;
+    int count;
+    if (!getNumberList(vm, "histogram", args[0], &values, &count)) {
+        return EMPTY_VAL;
+    }
+
+    if (!IS_NUMBER(args[1]) || !(AS_NUMBER(args[1]) >= 1 && AS_NUMBER(args[1]) <= INT_MAX) ||
+        AS_NUMBER(args[1]) != floor(AS_NUMBER(args[1]))) {
+        runtimeError(vm, "histogram() bin count must be a positive integer");
+        return EMPTY_VAL;
+    }
+
+    int bins = AS_NUMBER(args[1]);
+    double low = INFINITY;
+    double high = -INFINITY;
+
+    if (argCount == 4) {
+        if (!IS_NUMBER(args[2]) || !IS_NUMBER(args[3]) || !isfinite(AS_NUMBER(args[2])) ||
+            !isfinite(AS_NUMBER(args[3])) || AS_NUMBER(args[2]) > AS_NUMBER(args[3])) {
+            runtimeError(vm, "histogram() range must be two finite numbers, lowest first");
+            return EMPTY_VAL;
+        }
+
+        low = AS_NUMBER(args[2]);
+        high = AS_NUMBER(args[3]);
+    } else {
+        for (int i = 0; i < count; ++i) {
+            double x = AS_NUMBER(values[i]);
+
+            if (!isfinite(x)) {
+                continue;
+            }
+
+            low = x < low ? x : low;
+            high = x > high ? x : high;
+        }
+    }
+
+    ObjList *list = initList(vm);
+    push(vm, OBJ_VAL(list));
+
+    list->values.values = GROW_ARRAY(vm, list->values.values, Value, list->values.capacity, bins);
+    list->values.capacity = bins;
+
+    int *counts = ALLOCATE(vm, int, bins);
+    memset(counts, 0, sizeof(int) * bins);
+
+    double span = high - low;
+
+    for (int i = 0; i < count; ++i) {
+        double x = AS_NUMBER(values[i]);
+
+        // NaN fails every comparison, so it has to be skipped explicitly
+        if (!isfinite(x) || x < low || x > high) {
+            continue;
+        }
+
+        // Divide before scaling so a tiny span can't overflow, and halve a span too wide to be finite
+        double position = 0;
+        if (high > low) {
+            double fraction = isinf(span) ? (x / 2 - low / 2) / (high / 2 - low / 2) : (x - low) / span;
+            position = floor(fraction * bins);
+        }
+
+        // Bins are half open except the last, which also takes the top of the range
+        int bin = position < 0 ? 0 : position > bins - 1 ? bins - 1 : position;
+        counts[bin]++;
+    }
+
+    for (int i = 0; i < bins; ++i) {
+        list->values.values[i] = NUMBER_VAL(counts[i]);
+    }
+
+    list->values.count = bins;
+    FREE_ARRAY(vm, int, counts, bins);
+    pop(vm);
+
+    return OBJ_VAL(list);
+}
+
+static Value cumsumNative(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 1) {
+        runtimeError(vm, "cumsum() takes 1 argument (%d given).", argCount);
+        return EMPTY_VAL;
+    }
+
+    Value *values;
+    int count;
+    if (!getNumberList(vm, "cumsum", args[0], &values, &count)) {
+        return EMPTY_VAL;
+    }
+
+    ObjList *list = initList(vm);
+    push(vm, OBJ_VAL(list));
+
+    list->values.values = GROW_ARRAY(vm, list->values.values, Value, list->values.capacity, count);
+    list->values.capacity = count;
+
+    double sum = 0;
+
+    for (int i = 0; i < count; ++i) {
+        sum += AS_NUMBER(values[i]);
+        list->values.values[i] = NUMBER_VAL(sum);
+    }
+
+    list->values.count = count;
+    pop(vm);
+
+    return OBJ_VAL(list);
+}
+
+static Value dotNative(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 2) {
+        runtimeError(vm, "dot() takes 2 arguments (%d given).", argCount);
+        return EMPTY_VAL;
+    }
+
+    Value *a, *b;
+    int countA, countB;
+    if (!getNumberList(vm, "dot", args[0], &a, &countA) || !getNumberList(vm, "dot", args[1], &b, &countB)) {
+        return EMPTY_VAL;
+    }
+
+    if (countA != countB) {
+        runtimeError(vm, "dot() lists must be the same length (%d and %d given).", countA, countB);
+        return EMPTY_VAL;
+    }
+
+    double sums[4] = {0, 0, 0, 0};
+    int i = 0;
+
+    for (; i + 4 <= countA; i += 4) {
+        for (int j = 0; j < 4; ++j) {
+            sums[j] += AS_NUMBER(a[i + j]) * AS_NUMBER(b[i + j]);
+        }
+    }
+
+    for (; i < countA; ++i) {
+        sums[0] += AS_NUMBER(a[i]) * AS_NUMBER(b[i]);
+    }
+
+    return NUMBER_VAL((sums[0] + sums[1]) + (sums[2] + sums[3]));
+}
+
+// Neumaier's improvement on Kahan summation, which also copes with terms larger than the running sum
+static void compensatedAdd(double *sum, double *compensation, double x) {
+    double t = *sum + x;
+
+    if (fabs(*sum) >= fabs(x)) {
+        *compensation += (*sum - t) + x;
+    } else {
+        *compensation += (x - t) + *sum;
+    }
+
+    *sum = t;
+}
+
+static Value kahanSumNative(DictuVM *vm, int argCount, Value *args) {
+    Value *values;
+    int count;
+    if (!getNumberIterable(vm, "kahanSum", argCount, args, &values, &count)) {
+        return EMPTY_VAL;
+    }
+
+    double sum = 0;
+    double compensation = 0;
+
+    for (int i = 0; i < count; ++i) {
+        compensatedAdd(&sum, &compensation, AS_NUMBER(values[i]));
+    }
+
+    return NUMBER_VAL(sum + compensation);
+}
+
+/**
+ * Matrix, a dense row-major matrix of numbers. The heavy lifting is in
+ * math/matrix.c, this is the Dictu side.
+ */
+typedef struct {
+    int rows;
+    int cols;
+    double *data;
+} Matrix;
+
+typedef enum {
+    MATRIX_ADD,
+    MATRIX_SUB,
+    MATRIX_MUL,
+    MATRIX_DIV
+} MatrixOp;
+
+typedef enum {
+    MATRIX_SUM,
+    MATRIX_MEAN,
+    MATRIX_MIN,
+    MATRIX_MAX
+} MatrixReduction;
+
+#define AS_MATRIX(v) ((Matrix *)AS_ABSTRACT(v)->data)
+
+static void freeMatrix(DictuVM *vm, ObjAbstract *abstract) {
+    Matrix *matrix = abstract->data;
+    FREE_ARRAY(vm, double, matrix->data, (size_t) matrix->rows * matrix->cols);
+    FREE(vm, Matrix, matrix);
+}
+
+static bool isMatrix(Value value) {
+    return IS_ABSTRACT(value) && AS_ABSTRACT(value)->func == freeMatrix;
+}
+
+static Value newMatrix(DictuVM *vm, const char *name, int rows, int cols);
+
+static Value matrixShape(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 0) {
+        runtimeError(vm, "shape() takes no arguments (%d given).", argCount);
+        return EMPTY_VAL;
+    }
+
+    Matrix *matrix = AS_MATRIX(args[0]);
+    ObjList *list = initList(vm);
+    push(vm, OBJ_VAL(list));
+    writeValueArray(vm, &list->values, NUMBER_VAL(matrix->rows));
+    writeValueArray(vm, &list->values, NUMBER_VAL(matrix->cols));
+    pop(vm);
+
+    return OBJ_VAL(list);
+}
+
+static bool getIndex(DictuVM *vm, const char *name, Matrix *matrix, Value *args, size_t *index) {
+    if (!IS_NUMBER(args[0]) || !IS_NUMBER(args[1])) {
+        runtimeError(vm, "%s() row and column must be numbers.", name);
+        return false;
+    }
+
+    double row = AS_NUMBER(args[0]);
+    double col = AS_NUMBER(args[1]);
+
+    // Bounds are checked on the doubles, out of range values don't convert to int safely
+    if (!(row >= 0 && row < matrix->rows && col >= 0 && col < matrix->cols)) {
+        runtimeError(vm, "%s() index [%g, %g] is out of bounds for a %dx%d matrix.", name, row, col, matrix->rows, matrix->cols);
+        return false;
+    }
+
+    if (row != (int) row || col != (int) col) {
+        runtimeError(vm, "%s() row and column must be integers.", name);
+        return false;
+    }
+
+    *index = (size_t) row * matrix->cols + (size_t) col;
+    return true;
+}
+
+static Value matrixGet(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 2) {
+        runtimeError(vm, "get() takes 2 arguments (%d given).", argCount);
+        return EMPTY_VAL;
+    }
+
+    Matrix *matrix = AS_MATRIX(args[0]);
+    size_t index;
+    if (!getIndex(vm, "get", matrix, args + 1, &index)) {
+        return EMPTY_VAL;
+    }
+
+    return NUMBER_VAL(matrix->data[index]);
+}
+
+static Value matrixSet(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 3) {
+        runtimeError(vm, "set() takes 3 arguments (%d given).", argCount);
+        return EMPTY_VAL;
+    }
+
+    Matrix *matrix = AS_MATRIX(args[0]);
+    size_t index;
+    if (!getIndex(vm, "set", matrix, args + 1, &index)) {
+        return EMPTY_VAL;
+    }
+
+    if (!IS_NUMBER(args[3])) {
+        runtimeError(vm, "set() value must be a number.");
+        return EMPTY_VAL;
+    }
+
+    matrix->data[index] = AS_NUMBER(args[3]);
+    return NIL_VAL;
+}
+
+static Value matrixToList(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 0) {
+        runtimeError(vm, "toList() takes no arguments (%d given).", argCount);
+        return EMPTY_VAL;
+    }
+
+    Matrix *matrix = AS_MATRIX(args[0]);
+    ObjList *list = initList(vm);
+    push(vm, OBJ_VAL(list));
+
+    for (int i = 0; i < matrix->rows; ++i) {
+        ObjList *row = initList(vm);
+        push(vm, OBJ_VAL(row));
+
+        row->values.values = GROW_ARRAY(vm, row->values.values, Value, row->values.capacity, matrix->cols);
+        row->values.capacity = matrix->cols;
+
+        for (int j = 0; j < matrix->cols; ++j) {
+            row->values.values[j] = NUMBER_VAL(matrix->data[(size_t) i * matrix->cols + j]);
+        }
+
+        row->values.count = matrix->cols;
+        writeValueArray(vm, &list->values, OBJ_VAL(row));
+        pop(vm);
+    }
+
+    pop(vm);
+    return OBJ_VAL(list);
+}
+
+static Value matrixTransposeNative(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 0) {
+        runtimeError(vm, "transpose() takes no arguments (%d given).", argCount);
+        return EMPTY_VAL;
+    }
+
+    Matrix *matrix = AS_MATRIX(args[0]);
+    Value result = newMatrix(vm, "transpose", matrix->cols, matrix->rows);
+    if (IS_EMPTY(result)) {
+        return EMPTY_VAL;
+    }
+
+    matrixTranspose(matrix->data, AS_MATRIX(result)->data, matrix->rows, matrix->cols);
+
+    return result;
+}
+
+static Value matrixMatmul(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 1 && argCount != 2) {
+        runtimeError(vm, "matmul() takes 1 or 2 arguments (%d given).", argCount);
+        return EMPTY_VAL;
+    }
+
+    if (!isMatrix(args[1])) {
+        runtimeError(vm, "matmul() argument must be a Matrix.");
+        return EMPTY_VAL;
+    }
+
+    int threads = 1;
+
+    if (argCount == 2) {
+        if (!IS_NUMBER(args[2]) || !(AS_NUMBER(args[2]) >= 1)) {
+            runtimeError(vm, "matmul() thread count must be a positive number.");
+            return EMPTY_VAL;
+        }
+
+        // Clamped as a double, a large count would otherwise wrap when converted
+        threads = AS_NUMBER(args[2]) < MATRIX_MAX_THREADS ? AS_NUMBER(args[2]) : MATRIX_MAX_THREADS;
+    }
+
+    Matrix *a = AS_MATRIX(args[0]);
+    Matrix *b = AS_MATRIX(args[1]);
+
+    if (a->cols != b->rows) {
+        runtimeError(vm, "matmul() cannot multiply a %dx%d matrix by a %dx%d matrix.", a->rows, a->cols, b->rows, b->cols);
+        return EMPTY_VAL;
+    }
+
+    Value result = newMatrix(vm, "matmul", a->rows, b->cols);
+    if (IS_EMPTY(result)) {
+        return EMPTY_VAL;
+    }
+
+    matrixMultiply(a->data, b->data, AS_MATRIX(result)->data, a->rows, b->cols, a->cols, threads);
+
+    return result;
+}
+
+static double applyOp(MatrixOp op, double a, double b) {
+    switch (op) {
+        case MATRIX_ADD: return a + b;
+        case MATRIX_SUB: return a - b;
+        case MATRIX_MUL: return a * b;
+        case MATRIX_DIV: return a / b;
+    }
+
+    return 0;
+}
+
+/**
+ * Elementwise arithmetic against a number, a matrix of the same shape, or a
+ * single row which is applied to every row.
+ */
+static Value matrixElementwise(DictuVM *vm, const char *name, int argCount, Value *args, MatrixOp op) {
+    if (argCount != 1) {
+        runtimeError(vm, "%s() takes 1 argument (%d given).", name, argCount);
+        return EMPTY_VAL;
+    }
+
+    Matrix *matrix = AS_MATRIX(args[0]);
+    size_t size = (size_t) matrix->rows * matrix->cols;
+
+    if (IS_NUMBER(args[1])) {
+        double scalar = AS_NUMBER(args[1]);
+        Value result = newMatrix(vm, name, matrix->rows, matrix->cols);
+        if (IS_EMPTY(result)) {
+            return EMPTY_VAL;
+        }
+
+        double *out = AS_MATRIX(result)->data;
+
+        for (size_t i = 0; i < size; ++i) {
+            out[i] = applyOp(op, matrix->data[i], scalar);
+        }
+
+        return result;
+    }
+
+    if (!isMatrix(args[1])) {
+        runtimeError(vm, "%s() argument must be a number or a Matrix.", name);
+        return EMPTY_VAL;
+    }
+
+    Matrix *other = AS_MATRIX(args[1]);
+    bool broadcast = other->rows == 1 && other->cols == matrix->cols;
+
+    if (!broadcast && (other->rows != matrix->rows || other->cols != matrix->cols)) {
+        runtimeError(vm, "%s() cannot combine a %dx%d matrix with a %dx%d matrix.", name, matrix->rows, matrix->cols, other->rows, other->cols);
+        return EMPTY_VAL;
+    }
+
+    Value result = newMatrix(vm, name, matrix->rows, matrix->cols);
+    if (IS_EMPTY(result)) {
+        return EMPTY_VAL;
+    }
+
+    double *out = AS_MATRIX(result)->data;
+
+    for (int i = 0; i < matrix->rows; ++i) {
+        size_t offset = (size_t) i * matrix->cols;
+        const double *otherRow = other->data + (broadcast ? 0 : offset);
+
+        for (int j = 0; j < matrix->cols; ++j) {
+            out[offset + j] = applyOp(op, matrix->data[offset + j], otherRow[j]);
+        }
+    }
+
+    return result;
+}
+
+static Value matrixAdd(DictuVM *vm, int argCount, Value *args) {
+    return matrixElementwise(vm, "add", argCount, args, MATRIX_ADD);
+}
+
+static Value matrixSub(DictuVM *vm, int argCount, Value *args) {
+    return matrixElementwise(vm, "sub", argCount, args, MATRIX_SUB);
+}
+
+static Value matrixMul(DictuVM *vm, int argCount, Value *args) {
+    return matrixElementwise(vm, "mul", argCount, args, MATRIX_MUL);
+}
+
+static Value matrixDiv(DictuVM *vm, int argCount, Value *args) {
+    return matrixElementwise(vm, "div", argCount, args, MATRIX_DIV);
+}
+
+static double reduceStart(MatrixReduction reduction) {
+    switch (reduction) {
+        case MATRIX_MIN: return INFINITY;
+        case MATRIX_MAX: return -INFINITY;
+        default: return 0;
+    }
+}
+
+static double reduceStep(MatrixReduction reduction, double total, double x) {
+    switch (reduction) {
+        case MATRIX_MIN: return x < total ? x : total;
+        case MATRIX_MAX: return x > total ? x : total;
+        default: return total + x;
+    }
+}
+
+/**
+ * Reduces the whole matrix to a number, or with an axis reduces down each
+ * column (axis 0) or along each row (axis 1) to a list.
+ */
+static Value matrixReduce(DictuVM *vm, const char *name, int argCount, Value *args, MatrixReduction reduction) {
+    if (argCount > 1) {
+        runtimeError(vm, "%s() takes 0 or 1 arguments (%d given).", name, argCount);
+        return EMPTY_VAL;
+    }
+
+    Matrix *matrix = AS_MATRIX(args[0]);
+    int axis = -1;
+
+    if (argCount == 1) {
+        if (!IS_NUMBER(args[1]) || (AS_NUMBER(args[1]) != 0 && AS_NUMBER(args[1]) != 1)) {
+            runtimeError(vm, "%s() axis must be 0 or 1.", name);
+            return EMPTY_VAL;
+        }
+
+        axis = AS_NUMBER(args[1]);
+    }
+
+    size_t length = axis == 0 ? (size_t) matrix->rows : axis == 1 ? (size_t) matrix->cols : (size_t) matrix->rows * matrix->cols;
+    bool extreme = reduction == MATRIX_MIN || reduction == MATRIX_MAX;
+
+    if (length == 0 && (extreme || reduction == MATRIX_MEAN)) {
+        runtimeError(vm, "%s() of an empty matrix.", name);
+        return EMPTY_VAL;
+    }
+
+    if (axis == -1) {
+        size_t size = (size_t) matrix->rows * matrix->cols;
+        double total = reduceStart(reduction);
+
+        for (size_t i = 0; i < size; ++i) {
+            total = reduceStep(reduction, total, matrix->data[i]);
+        }
+
+        return NUMBER_VAL(reduction == MATRIX_MEAN ? total / size : total);
+    }
+
+    int count = axis == 0 ? matrix->cols : matrix->rows;
+    double *totals = ALLOCATE(vm, double, count);
+
+    for (int i = 0; i < count; ++i) {
+        totals[i] = reduceStart(reduction);
+    }
+
+    // Both directions walk the matrix in memory order, down the columns means updating a row of totals at a time
+    for (int i = 0; i < matrix->rows; ++i) {
+        const double *row = matrix->data + (size_t) i * matrix->cols;
+
+        if (axis == 0) {
+            for (int j = 0; j < matrix->cols; ++j) {
+                totals[j] = reduceStep(reduction, totals[j], row[j]);
+            }
+        } else {
+            double total = totals[i];
+
+            for (int j = 0; j < matrix->cols; ++j) {
+                total = reduceStep(reduction, total, row[j]);
+            }
+
+            totals[i] = total;
+        }
+    }
+
+    ObjList *list = initList(vm);
+    push(vm, OBJ_VAL(list));
+
+    for (int i = 0; i < count; ++i) {
+        double total = reduction == MATRIX_MEAN ? totals[i] / length : totals[i];
+        writeValueArray(vm, &list->values, NUMBER_VAL(total));
+    }
+
+    pop(vm);
+    FREE_ARRAY(vm, double, totals, count);
+
+    return OBJ_VAL(list);
+}
+
+static Value matrixSum(DictuVM *vm, int argCount, Value *args) {
+    return matrixReduce(vm, "sum", argCount, args, MATRIX_SUM);
+}
+
+static Value matrixMean(DictuVM *vm, int argCount, Value *args) {
+    return matrixReduce(vm, "mean", argCount, args, MATRIX_MEAN);
+}
+
+static Value matrixMin(DictuVM *vm, int argCount, Value *args) {
+    return matrixReduce(vm, "min", argCount, args, MATRIX_MIN);
+}
+
+static Value matrixMax(DictuVM *vm, int argCount, Value *args) {
+    return matrixReduce(vm, "max", argCount, args, MATRIX_MAX);
+}
+
+static Value newMatrix(DictuVM *vm, const char *name, int rows, int cols) {
+    if (cols != 0 && (size_t) rows > SIZE_MAX / sizeof(double) / cols) {
+        runtimeError(vm, "%s() cannot allocate a %dx%d matrix.", name, rows, cols);
+        return EMPTY_VAL;
+    }
+
+    ObjAbstract *abstract = initAbstract(vm, freeMatrix);
+    push(vm, OBJ_VAL(abstract));
+
+    Matrix *matrix = ALLOCATE(vm, Matrix, 1);
+    matrix->rows = 0;
+    matrix->cols = 0;
+    matrix->data = NULL;
+    abstract->data = matrix;
+
+    size_t size = (size_t) rows * cols;
+    if (size > 0) {
+        matrix->data = ALLOCATE(vm, double, size);
+        if (matrix->data == NULL) {
+            pop(vm);
+            runtimeError(vm, "Memory error on %s()!", name);
+            return EMPTY_VAL;
+        }
+
+        memset(matrix->data, 0, sizeof(double) * size);
+    }
+    matrix->rows = rows;
+    matrix->cols = cols;
+
+    /**
+     * Setup Matrix object methods
+     */
+    defineNative(vm, &abstract->values, "shape", matrixShape);
+    defineNative(vm, &abstract->values, "get", matrixGet);
+    defineNative(vm, &abstract->values, "set", matrixSet);
+    defineNative(vm, &abstract->values, "toList", matrixToList);
+    defineNative(vm, &abstract->values, "transpose", matrixTransposeNative);
+    defineNative(vm, &abstract->values, "matmul", matrixMatmul);
+    defineNative(vm, &abstract->values, "add", matrixAdd);
+    defineNative(vm, &abstract->values, "sub", matrixSub);
+    defineNative(vm, &abstract->values, "mul", matrixMul);
+    defineNative(vm, &abstract->values, "div", matrixDiv);
+    defineNative(vm, &abstract->values, "sum", matrixSum);
+    defineNative(vm, &abstract->values, "mean", matrixMean);
+    defineNative(vm, &abstract->values, "min", matrixMin);
+    defineNative(vm, &abstract->values, "max", matrixMax);
+    pop(vm);
+
+    return OBJ_VAL(abstract);
+}
+
+static Value matrixFromList(DictuVM *vm, ObjList *list) {
+    int rows = list->values.count;
+    int cols = 0;
+
+    for (int i = 0; i < rows; ++i) {
+        Value row = list->values.values[i];
+
+        if (!IS_LIST(row) || !isNumericList(AS_LIST(row)->values.values, AS_LIST(row)->values.count)) {
+            runtimeError(vm, "Matrix() rows must be lists of numbers.");
+            return EMPTY_VAL;
+        }
+
+        if (i == 0) {
+            cols = AS_LIST(row)->values.count;
+        } else if (AS_LIST(row)->values.count != cols) {
+            runtimeError(vm, "Matrix() rows must all be the same length.");
+            return EMPTY_VAL;
+        }
+    }
+
+    Value result = newMatrix(vm, "Matrix", rows, cols);
+    if (IS_EMPTY(result)) {
+        return EMPTY_VAL;
+    }
+
+    double *data = AS_MATRIX(result)->data;
+
+    for (int i = 0; i < rows; ++i) {
+        Value *row = AS_LIST(list->values.values[i])->values.values;
+
+        for (int j = 0; j < cols; ++j) {
+            data[(size_t) i * cols + j] = AS_NUMBER(row[j]);
+        }
+    }
+
+    return result;
+}
+
+static Value matrixNative(DictuVM *vm, int argCount, Value *args) {
+    if (argCount == 1 && IS_LIST(args[0])) {
+        return matrixFromList(vm, AS_LIST(args[0]));
+    }
+
+    if (argCount != 2 && argCount != 3) {
+        runtimeError(vm, "Matrix() takes a list, or 2 or 3 arguments (%d given).", argCount);
+        return EMPTY_VAL;
+    }
+
+    if (!IS_NUMBER(args[0]) || !IS_NUMBER(args[1])) {
+        runtimeError(vm, "Matrix() rows and columns must be non-negative integers.");
+        return EMPTY_VAL;
+    }
+
+    double rows = AS_NUMBER(args[0]);
+    double cols = AS_NUMBER(args[1]);
+
+    // Range checked before converting, out of range or fractional sizes don't convert to int safely
+    if (!(rows >= 0 && rows <= INT_MAX && cols >= 0 && cols <= INT_MAX) || rows != (int) rows || cols != (int) cols) {
+        runtimeError(vm, "Matrix() rows and columns must be non-negative integers.");
+        return EMPTY_VAL;
+    }
+
+    if (argCount == 3 && !IS_NUMBER(args[2])) {
+        runtimeError(vm, "Matrix() fill value must be a number.");
+        return EMPTY_VAL;
+    }
+
+    Value result = newMatrix(vm, "Matrix", rows, cols);
+    if (IS_EMPTY(result)) {
+        return EMPTY_VAL;
+    }
+
+    if (argCount == 3) {
+        Matrix *matrix = AS_MATRIX(result);
+        size_t size = (size_t) matrix->rows * matrix->cols;
+        double fill = AS_NUMBER(args[2]);
+
+        for (size_t i = 0; i < size; ++i) {
+            matrix->data[i] = fill;
+        }
+    }
+
+    return result;
+}
+
 ObjModule *createMathsModule(DictuVM *vm) {
     ObjString *name = copyString(vm, "Math", 4);
     push(vm, OBJ_VAL(name));
@@ -243,6 +1304,15 @@ ObjModule *createMathsModule(DictuVM *vm) {
     defineNative(vm, &module->values, "sin", sinNative);
     defineNative(vm, &module->values, "cos", cosNative);
     defineNative(vm, &module->values, "tan", tanNative);
+    defineNative(vm, &module->values, "variance", varianceNative);
+    defineNative(vm, &module->values, "stddev", stddevNative);
+    defineNative(vm, &module->values, "median", medianNative);
+    defineNative(vm, &module->values, "percentile", percentileNative);
+    defineNative(vm, &module->values, "histogram", histogramNative);
+    defineNative(vm, &module->values, "cumsum", cumsumNative);
+    defineNative(vm, &module->values, "dot", dotNative);
+    defineNative(vm, &module->values, "kahanSum", kahanSumNative);
+    defineNative(vm, &module->values, "Matrix", matrixNative);
 
     /**
      * Define Math properties
@@ -4,6 +4,7 @@
 #include <string.h>
 
 #include "optionals.h"
+#include "math/matrix.h"
 #include "../vm/vm.h"
 
 ObjModule *createMathsModule(DictuVM *vm);
@@ -0,0 +1,310 @@
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#include "matrix.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define MATRIX_AVX2
+#include <immintrin.h>
+#endif
+
+// Depth of the slice of k worked on at once, so a packed panel of b stays in L1
+#define BLOCK_K 256
+// Width of the slice of b packed at once, sized to stay in L2
+#define BLOCK_N 512
+// Tile of c held in registers by the AVX2 kernel
+#define TILE_M 4
+#define TILE_N 8
+
+typedef void (*MultiplyFn)(const double *a, const double *b, double *c, int n, int k, int rowStart, int rowEnd);
+
+/**
+ * Plain blocked i-k-j loops. Each row of c is updated with a row of b at a
+ * time, which runs along memory and leaves the inner loop for the compiler
+ * to vectorise.
+ */
+static void multiplyRowsGeneric(const double *a, const double *b, double *c, int n, int k, int rowStart, int rowEnd) {
+    for (int kk = 0; kk < k; kk += BLOCK_K) {
+        int kEnd = kk + BLOCK_K < k ? kk + BLOCK_K : k;
+
+        for (int jj = 0; jj < n; jj += BLOCK_N) {
+            int jEnd = jj + BLOCK_N < n ? jj + BLOCK_N : n;
+
+            for (int i = rowStart; i < rowEnd; ++i) {
+                double *cRow = c + (size_t) i * n;
+
+                for (int p = kk; p < kEnd; ++p) {
+                    double scalar = a[(size_t) i * k + p];
+                    const double *bRow = b + (size_t) p * n;
+
+                    for (int j = jj; j < jEnd; ++j) {
+                        cRow[j] += scalar * bRow[j];
+                    }
+                }
+            }
+        }
+    }
+}
+
+#ifdef MATRIX_AVX2
+/**
+ * Packs a BLOCK_K x BLOCK_N slice of b into panels TILE_N columns wide, so
+ * the kernel reads each panel front to back. Columns past the edge of b are
+ * padded with zeros.
+ */
+static void packPanels(const double *b, double *packed, int n, int kk, int depth, int jj, int width) {
+    int panels = (width + TILE_N - 1) / TILE_N;
+
+    for (int panel = 0; panel < panels; ++panel) {
+        double *out = packed + (size_t) panel * depth * TILE_N;
+        int column = jj + panel * TILE_N;
+        int columns = n - column < TILE_N ? n - column : TILE_N;
+
+        for (int p = 0; p < depth; ++p) {
+            const double *bRow = b + (size_t) (kk + p) * n + column;
+
+            memcpy(out, bRow, sizeof(double) * columns);
+            for (int t = columns; t < TILE_N; ++t) {
+                out[t] = 0;
+            }
+
+            out += TILE_N;
+        }
+    }
+}
+
+/**
+ * Multiplies TILE_M rows of a against one packed panel, accumulating a
+ * TILE_M x TILE_N block of c in eight registers.
+ */
+__attribute__((target("avx2,fma")))
+static void multiplyTile(const double *aRows[TILE_M], const double *panel, int depth, double *tile) {
+    __m256d c00 = _mm256_setzero_pd(), c01 = _mm256_setzero_pd();
+    __m256d c10 = _mm256_setzero_pd(), c11 = _mm256_setzero_pd();
+    __m256d c20 = _mm256_setzero_pd(), c21 = _mm256_setzero_pd();
+    __m256d c30 = _mm256_setzero_pd(), c31 = _mm256_setzero_pd();
+
+    const double *a0 = aRows[0], *a1 = aRows[1], *a2 = aRows[2], *a3 = aRows[3];
+
+    for (int p = 0; p < depth; ++p) {
+        __m256d b0 = _mm256_loadu_pd(panel);
+        __m256d b1 = _mm256_loadu_pd(panel + 4);
+        panel += TILE_N;
+
+        __m256d scalar = _mm256_broadcast_sd(a0 + p);
+        c00 = _mm256_fmadd_pd(scalar, b0, c00);
+        c01 = _mm256_fmadd_pd(scalar, b1, c01);
+
+        scalar = _mm256_broadcast_sd(a1 + p);
+        c10 = _mm256_fmadd_pd(scalar, b0, c10);
+        c11 = _mm256_fmadd_pd(scalar, b1, c11);
+
+        scalar = _mm256_broadcast_sd(a2 + p);
+        c20 = _mm256_fmadd_pd(scalar, b0, c20);
+        c21 = _mm256_fmadd_pd(scalar, b1, c21);
+
+        scalar = _mm256_broadcast_sd(a3 + p);
+        c30 = _mm256_fmadd_pd(scalar, b0, c30);
+        c31 = _mm256_fmadd_pd(scalar, b1, c31);
+    }
+
+    _mm256_storeu_pd(tile, c00);
+    _mm256_storeu_pd(tile + 4, c01);
+    _mm256_storeu_pd(tile + 8, c10);
+    _mm256_storeu_pd(tile + 12, c11);
+    _mm256_storeu_pd(tile + 16, c20);
+    _mm256_storeu_pd(tile + 20, c21);
+    _mm256_storeu_pd(tile + 24, c30);
+    _mm256_storeu_pd(tile + 28, c31);
+}
+
+static void multiplyRowsAVX2(const double *a, const double *b, double *c, int n, int k, int rowStart, int rowEnd) {
+    int panelCount = (BLOCK_N + TILE_N - 1) / TILE_N;
+    double *packed = malloc(sizeof(double) * BLOCK_K * TILE_N * panelCount);
+    double *zeros = calloc(BLOCK_K, sizeof(double));
+
+    if (packed == NULL || zeros == NULL) {
+        free(packed);
+        free(zeros);
+        multiplyRowsGeneric(a, b, c, n, k, rowStart, rowEnd);
+        return;
+    }
+
+    double tile[TILE_M * TILE_N];
+
+    for (int kk = 0; kk < k; kk += BLOCK_K) {
+        int depth = k - kk < BLOCK_K ? k - kk : BLOCK_K;
+
+        for (int jj = 0; jj < n; jj += BLOCK_N) {
+            int width = n - jj < BLOCK_N ? n - jj : BLOCK_N;
+            packPanels(b, packed, n, kk, depth, jj, width);
+
+            for (int i = rowStart; i < rowEnd; i += TILE_M) {
+                int rows = rowEnd - i < TILE_M ? rowEnd - i : TILE_M;
+                const double *aRows[TILE_M];
+
+                // Rows past the end multiply a row of zeros, and their results are dropped
+                for (int r = 0; r < TILE_M; ++r) {
+                    aRows[r] = r < rows ? a + (size_t) (i + r) * k + kk : zeros;
+                }
+
+                for (int j = jj; j < jj + width; j += TILE_N) {
+                    int columns = jj + width - j < TILE_N ? jj + width - j : TILE_N;
+                    const double *panel = packed + (size_t) ((j - jj) / TILE_N) * depth * TILE_N;
+
+                    multiplyTile(aRows, panel, depth, tile);
+
+                    for (int r = 0; r < rows; ++r) {
+                        double *cRow = c + (size_t) (i + r) * n + j;
+
+                        for (int t = 0; t < columns; ++t) {
+                            cRow[t] += tile[r * TILE_N + t];
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    free(packed);
+    free(zeros);
+}
+#endif
+
+static MultiplyFn multiplyRows = NULL;
+
+static void selectKernel(void) {
+    multiplyRows = multiplyRowsGeneric;
+
+#ifdef MATRIX_AVX2
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        multiplyRows = multiplyRowsAVX2;
+    }
+#endif
+}
+
+typedef struct {
+    const double *a;
+    const double *b;
+    double *c;
+    int n;
+    int k;
+    int rowStart;
+    int rowEnd;
+} MultiplyJob;
+
+#ifdef _WIN32
+static DWORD WINAPI multiplyWorker(LPVOID arg) {
+#else
+static void *multiplyWorker(void *arg) {
+#endif
+    MultiplyJob *job = arg;
+    multiplyRows(job->a, job->b, job->c, job->n, job->k, job->rowStart, job->rowEnd);
+    return 0;
+}
+
+void matrixMultiply(const double *a, const double *b, double *c, int m, int n, int k, int threads) {
+    if (m == 0 || n == 0 || k == 0) {
+        return;
+    }
+
+    // Pick the kernel before starting any threads that would race to do it
+    if (multiplyRows == NULL) {
+        selectKernel();
+    }
+
+    // Threads take whole tiles of rows, and small products aren't worth splitting
+    int maxThreads = (m + TILE_M - 1) / TILE_M;
+    if ((double) m * n * k < 1e6) {
+        maxThreads = 1;
+    }
+
+    if (threads > maxThreads) {
+        threads = maxThreads;
+    }
+
+    if (threads > MATRIX_MAX_THREADS) {
+        threads = MATRIX_MAX_THREADS;
+    }
+
+    if (threads <= 1) {
+        multiplyRows(a, b, c, n, k, 0, m);
+        return;
+    }
+
+    MultiplyJob jobs[MATRIX_MAX_THREADS];
+#ifdef _WIN32
+    HANDLE handles[MATRIX_MAX_THREADS];
+#else
+    pthread_t handles[MATRIX_MAX_THREADS];
+#endif
+    int started[MATRIX_MAX_THREADS];
+
+    int tiles = (m + TILE_M - 1) / TILE_M;
+
+    for (int t = 0; t < threads; ++t) {
+        int rowStart = (int) ((long long) tiles * t / threads) * TILE_M;
+        int rowEnd = (int) ((long long) tiles * (t + 1) / threads) * TILE_M;
+
+        jobs[t] = (MultiplyJob) {a, b, c, n, k, rowStart, rowEnd < m ? rowEnd : m};
+        started[t] = 0;
+
+        // The calling thread works through the first share itself
+        if (t == 0) {
+            continue;
+        }
+
+#ifdef _WIN32
+        handles[t] = CreateThread(NULL, 0, multiplyWorker, &jobs[t], 0, NULL);
+        started[t] = handles[t] != NULL;
+#else
+        started[t] = pthread_create(&handles[t], NULL, multiplyWorker, &jobs[t]) == 0;
+#endif
+    }
+
+    for (int t = 0; t < threads; ++t) {
+        if (!started[t]) {
+            multiplyWorker(&jobs[t]);
+        }
+    }
+
+    for (int t = 1; t < threads; ++t) {
+        if (!started[t]) {
+            continue;
+        }
+
+#ifdef _WIN32
+        WaitForSingleObject(handles[t], INFINITE);
+        CloseHandle(handles[t]);
+#else
+        pthread_join(handles[t], NULL);
+#endif
+    }
+}
+
+// Transposes in square blocks so both the reads and the writes stay within a few cache lines
+#define TRANSPOSE_BLOCK 32
+
+void matrixTranspose(const double *a, double *out, int rows, int cols) {
+    for (int ii = 0; ii < rows; ii += TRANSPOSE_BLOCK) {
+        int iEnd = ii + TRANSPOSE_BLOCK < rows ? ii + TRANSPOSE_BLOCK : rows;
+
+        for (int jj = 0; jj < cols; jj += TRANSPOSE_BLOCK) {
+            int jEnd = jj + TRANSPOSE_BLOCK < cols ? jj + TRANSPOSE_BLOCK : cols;
+
+            for (int i = ii; i < iEnd; ++i) {
+                for (int j = jj; j < jEnd; ++j) {
+                    out[(size_t) j * rows + i] = a[(size_t) i * cols + j];
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,19 @@
+#ifndef dictu_matrix_h
+#define dictu_matrix_h
+
+#include <stddef.h>
+
+/**
+ * Kernels behind Math.Matrix. Matrices are dense, row-major and contiguous.
+ */
+
+// Upper bound on the threads matrixMultiply() will start
+#define MATRIX_MAX_THREADS 64
+
+// c (m x n) = a (m x k) * b (k x n), with c zeroed beforehand. Rows of c are split over up to threads threads.
+void matrixMultiply(const double *a, const double *b, double *c, int m, int n, int k, int threads);
+
+// out (cols x rows) = the transpose of a (rows x cols)
+void matrixTranspose(const double *a, double *out, int rows, int cols);
+
+#endif //dictu_matrix_h
@@ -11,6 +11,7 @@ BuiltinModules modules[] = {
         {"Base64", &createBase64Module},
         {"Hashlib", &createHashlibModule},
         {"Sqlite", &createSqliteModule},
+        {"Benchmark", &createBenchmarkModule},
 #ifndef DISABLE_HTTP
         {"HTTP", &createHTTPModule},
 #endif
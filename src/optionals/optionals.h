@@ -15,6 +15,7 @@
 #include "base64.h"
 #include "hashlib.h"
 #include "sqlite.h"
+#include "benchmark.h"
 
 #define GET_SELF_CLASS \
   AS_MODULE(args[-1])
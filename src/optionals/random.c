@@ -1,6 +1,134 @@
 #include "random.h"
 
-static Value randomRandom(DictuVM *vm, int argCount, Value *args)
+#include <limits.h>
+
+/**
+ * Each VM gets its own generator, stored on the Random module, so VMs never
+ * share or contend on state. The generator is xoshiro256** seeded through
+ * splitmix64, see https://prng.di.unimi.it/
+ */
+typedef struct
+{
+    uint64_t state[4];
+} Generator;
+
+// range() bounds beyond this aren't exact integers
+#define RANGE_LIMIT 9007199254740992.0
+
+#define AS_GENERATOR(v) ((Generator *)AS_ABSTRACT(v)->data)
+
+static uint64_t splitmix64(uint64_t *x)
+{
+    uint64_t z = (*x += 0x9E3779B97F4A7C15);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+    return z ^ (z >> 31);
+}
+
+static void seedGenerator(Generator *generator, uint64_t seed)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        generator->state[i] = splitmix64(&seed);
+    }
+}
+
+static inline uint64_t rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t nextRandom(Generator *generator)
+{
+    uint64_t *s = generator->state;
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+
+    return result;
+}
+
+// Advances the generator by 2^128 steps, so the skipped stretch can be handed to another stream
+static void jumpGenerator(Generator *generator)
+{
+    static const uint64_t jump[] = {0x180EC6D33CFD0ABA, 0xD5A61266F0C9392C, 0xA9582618E03FC9AA, 0x39ABDC4529B1661C};
+    uint64_t s[4] = {0, 0, 0, 0};
+
+    for (int i = 0; i < 4; ++i)
+    {
+        for (int b = 0; b < 64; ++b)
+        {
+            if (jump[i] & ((uint64_t)1 << b))
+            {
+                for (int j = 0; j < 4; ++j)
+                {
+                    s[j] ^= generator->state[j];
+                }
+            }
+
+            nextRandom(generator);
+        }
+    }
+
+    memcpy(generator->state, s, sizeof(s));
+}
+
+// Uniform double in [0, 1) from the top 53 bits
+static inline double nextDouble(Generator *generator)
+{
+    return (nextRandom(generator) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Uniform integer in [0, bound), rejecting the values that would bias a plain modulo
+static inline uint64_t nextBelow(Generator *generator, uint64_t bound)
+{
+    uint64_t threshold = (0 - bound) % bound;
+
+    for (;;)
+    {
+        uint64_t r = nextRandom(generator);
+        if (r >= threshold)
+        {
+            return r % bound;
+        }
+    }
+}
+
+static uint64_t seedFromNumber(double number)
+{
+    uint64_t seed;
+    memcpy(&seed, &number, sizeof(seed));
+    return seed;
+}
+
+static Value newGenerator(DictuVM *vm, uint64_t seed);
+
+static Generator *getDefaultGenerator(DictuVM *vm, ObjModule *module)
+{
+    Value generator;
+    tableGet(&module->values, copyString(vm, "__generator__", 13), &generator);
+    return AS_GENERATOR(generator);
+}
+
+static bool getList(DictuVM *vm, const char *name, Value value, ObjList **list)
+{
+    if (!IS_LIST(value))
+    {
+        runtimeError(vm, "%s() argument must be a list", name);
+        return false;
+    }
+
+    *list = AS_LIST(value);
+    return true;
+}
+
+static Value randomRandom(DictuVM *vm, Generator *generator, int argCount, Value *args)
 {
     UNUSED(args);
     if (argCount > 0)
@@ -9,13 +137,10 @@ static Value randomRandom(DictuVM *vm, int argCount, Value *args)
         return EMPTY_VAL;
     }
 
-    int high = 1;
-    int low = 0;
-    double random_double = ((double)rand() * (high - low)) / (double)RAND_MAX + low;
-    return NUMBER_VAL(random_double);
+    return NUMBER_VAL(nextDouble(generator));
 }
 
-static Value randomRange(DictuVM *vm, int argCount, Value *args)
+static Value randomRange(DictuVM *vm, Generator *generator, int argCount, Value *args)
 {
     if (argCount != 2)
     {
@@ -29,13 +154,30 @@ static Value randomRange(DictuVM *vm, int argCount, Value *args)
         return EMPTY_VAL;
     }
 
-    int upper = AS_NUMBER(args[1]);
-    int lower = AS_NUMBER(args[0]);
-    int random_val = (rand() % (upper - lower + 1)) + lower;
-    return NUMBER_VAL(random_val);
+    // Beyond 2^53 numbers aren't exact integers, and beyond 2^63 converting them is undefined
+    if (!(fabs(AS_NUMBER(args[0])) <= RANGE_LIMIT) || !(fabs(AS_NUMBER(args[1])) <= RANGE_LIMIT))
+    {
+        runtimeError(vm, "range() bounds must be between -2^53 and 2^53");
+        return EMPTY_VAL;
+    }
+
+    int64_t upper = AS_NUMBER(args[1]);
+    int64_t lower = AS_NUMBER(args[0]);
+
+    if (upper < lower)
+    {
+        runtimeError(vm, "range() lower bound must not be greater than the upper bound");
+        return EMPTY_VAL;
+    }
+
+    uint64_t span = (uint64_t)upper - (uint64_t)lower + 1;
+
+    // A span of every 64 bit integer wraps to 0, any draw is in range
+    uint64_t offset = span == 0 ? nextRandom(generator) : nextBelow(generator, span);
+    return NUMBER_VAL((double)(int64_t)((uint64_t)lower + offset));
 }
 
-static Value randomSelect(DictuVM *vm, int argCount, Value *args)
+static Value randomSelect(DictuVM *vm, Generator *generator, int argCount, Value *args)
 {
     if (argCount == 0)
     {
@@ -53,6 +195,12 @@ static Value randomSelect(DictuVM *vm, int argCount, Value *args)
     argCount = list->values.count;
     args = list->values.values;
 
+    if (argCount == 0)
+    {
+        runtimeError(vm, "select() argument must not be an empty list");
+        return EMPTY_VAL;
+    }
+
     for (int i = 0; i < argCount; ++i)
     {
         Value value = args[i];
@@ -63,10 +211,345 @@ static Value randomSelect(DictuVM *vm, int argCount, Value *args)
         }
     }
 
-    int index = rand() % argCount;
+    int index = nextBelow(generator, argCount);
     return args[index];
 }
 
+static Value randomSeed(DictuVM *vm, Generator *generator, int argCount, Value *args)
+{
+    if (argCount != 1)
+    {
+        runtimeError(vm, "seed() takes 1 argument (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    if (!IS_NUMBER(args[0]))
+    {
+        runtimeError(vm, "seed() argument must be a number");
+        return EMPTY_VAL;
+    }
+
+    seedGenerator(generator, seedFromNumber(AS_NUMBER(args[0])));
+    return NIL_VAL;
+}
+
+// Range checked as a double, out of range or fractional counts don't convert to int safely
+static bool getCount(DictuVM *vm, const char *name, const char *argument, Value value, int *count)
+{
+    if (!IS_NUMBER(value) || !(AS_NUMBER(value) >= 0 && AS_NUMBER(value) <= INT_MAX) ||
+        AS_NUMBER(value) != (int)AS_NUMBER(value))
+    {
+        runtimeError(vm, "%s() %s must be a non-negative integer", name, argument);
+        return false;
+    }
+
+    *count = AS_NUMBER(value);
+    return true;
+}
+
+static Value randomFill(DictuVM *vm, Generator *generator, int argCount, Value *args)
+{
+    if (argCount != 1)
+    {
+        runtimeError(vm, "fill() takes 1 argument (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    int count;
+    if (!getCount(vm, "fill", "argument", args[0], &count))
+    {
+        return EMPTY_VAL;
+    }
+
+    ObjList *list = initList(vm);
+    push(vm, OBJ_VAL(list));
+
+    // Size the list up front rather than growing it a value at a time
+    list->values.values = GROW_ARRAY(vm, list->values.values, Value, list->values.capacity, count);
+    list->values.capacity = count;
+
+    for (int i = 0; i < count; ++i)
+    {
+        list->values.values[i] = NUMBER_VAL(nextDouble(generator));
+    }
+
+    list->values.count = count;
+    pop(vm);
+
+    return OBJ_VAL(list);
+}
+
+static Value randomShuffle(DictuVM *vm, Generator *generator, int argCount, Value *args)
+{
+    if (argCount != 1)
+    {
+        runtimeError(vm, "shuffle() takes 1 argument (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    ObjList *list;
+    if (!getList(vm, "shuffle", args[0], &list))
+    {
+        return EMPTY_VAL;
+    }
+
+    Value *values = list->values.values;
+
+    // Fisher-Yates, in place
+    for (int i = list->values.count - 1; i > 0; --i)
+    {
+        int j = nextBelow(generator, i + 1);
+        Value tmp = values[i];
+        values[i] = values[j];
+        values[j] = tmp;
+    }
+
+    return NIL_VAL;
+}
+
+static Value randomSample(DictuVM *vm, Generator *generator, int argCount, Value *args)
+{
+    if (argCount != 2)
+    {
+        runtimeError(vm, "sample() takes 2 arguments (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    ObjList *list;
+    if (!getList(vm, "sample", args[0], &list))
+    {
+        return EMPTY_VAL;
+    }
+
+    int k;
+    if (!getCount(vm, "sample", "second argument", args[1], &k))
+    {
+        return EMPTY_VAL;
+    }
+
+    int count = list->values.count;
+
+    if (k > count)
+    {
+        runtimeError(vm, "sample() cannot take %d values from a list of %d", k, count);
+        return EMPTY_VAL;
+    }
+
+    ObjList *sample = initList(vm);
+    push(vm, OBJ_VAL(sample));
+
+    for (int i = 0; i < k; ++i)
+    {
+        writeValueArray(vm, &sample->values, list->values.values[i]);
+    }
+
+    // Reservoir sampling picks the set, shuffling it makes the order random too
+    Value *values = sample->values.values;
+
+    for (int i = k; i < count; ++i)
+    {
+        uint64_t j = nextBelow(generator, i + 1);
+        if (j < (uint64_t)k)
+        {
+            values[j] = list->values.values[i];
+        }
+    }
+
+    for (int i = k - 1; i > 0; --i)
+    {
+        int j = nextBelow(generator, i + 1);
+        Value tmp = values[i];
+        values[i] = values[j];
+        values[j] = tmp;
+    }
+
+    pop(vm);
+    return OBJ_VAL(sample);
+}
+
+static Value randomChoice(DictuVM *vm, Generator *generator, int argCount, Value *args)
+{
+    if (argCount != 1 && argCount != 2)
+    {
+        runtimeError(vm, "choice() takes 1 or 2 arguments (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    ObjList *list;
+    if (!getList(vm, "choice", args[0], &list))
+    {
+        return EMPTY_VAL;
+    }
+
+    int count = list->values.count;
+
+    if (count == 0)
+    {
+        runtimeError(vm, "choice() argument must not be an empty list");
+        return EMPTY_VAL;
+    }
+
+    if (argCount == 1)
+    {
+        return list->values.values[nextBelow(generator, count)];
+    }
+
+    if (!IS_LIST(args[1]) || AS_LIST(args[1])->values.count != count)
+    {
+        runtimeError(vm, "choice() weights must be a list the same length as the values");
+        return EMPTY_VAL;
+    }
+
+    Value *weights = AS_LIST(args[1])->values.values;
+    double total = 0;
+
+    for (int i = 0; i < count; ++i)
+    {
+        if (!IS_NUMBER(weights[i]) || AS_NUMBER(weights[i]) < 0)
+        {
+            runtimeError(vm, "choice() weights must be non-negative numbers");
+            return EMPTY_VAL;
+        }
+
+        total += AS_NUMBER(weights[i]);
+    }
+
+    if (total <= 0)
+    {
+        runtimeError(vm, "choice() weights must not all be zero");
+        return EMPTY_VAL;
+    }
+
+    double target = nextDouble(generator) * total;
+
+    for (int i = 0; i < count; ++i)
+    {
+        target -= AS_NUMBER(weights[i]);
+
+        if (target < 0)
+        {
+            return list->values.values[i];
+        }
+    }
+
+    // Rounding can leave target a hair above zero, fall back to the last weighted value
+    for (int i = count - 1; i >= 0; --i)
+    {
+        if (AS_NUMBER(weights[i]) > 0)
+        {
+            return list->values.values[i];
+        }
+    }
+
+    return list->values.values[count - 1];
+}
+
+static Value splitGenerator(DictuVM *vm, int argCount, Value *args)
+{
+    if (argCount != 0)
+    {
+        runtimeError(vm, "split() takes 0 arguments (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    Generator *generator = AS_GENERATOR(args[0]);
+    Value split = newGenerator(vm, 0);
+
+    // The new generator carries on from here and this one jumps past it, so their streams never overlap
+    *AS_GENERATOR(split) = *generator;
+    jumpGenerator(generator);
+
+    return split;
+}
+
+/**
+ * Each function is exposed both on the module, using the VM's default
+ * generator, and as a method on Generator objects.
+ */
+#define RANDOM_NATIVE(function)                                                        \
+    static Value function##Module(DictuVM *vm, int argCount, Value *args)              \
+    {                                                                                  \
+        return function(vm, getDefaultGenerator(vm, GET_SELF_CLASS), argCount, args); \
+    }                                                                                  \
+                                                                                       \
+    static Value function##Method(DictuVM *vm, int argCount, Value *args)              \
+    {                                                                                  \
+        return function(vm, AS_GENERATOR(args[0]), argCount, args + 1);                \
+    }
+
+RANDOM_NATIVE(randomRandom)
+RANDOM_NATIVE(randomRange)
+RANDOM_NATIVE(randomSelect)
+RANDOM_NATIVE(randomSeed)
+RANDOM_NATIVE(randomFill)
+RANDOM_NATIVE(randomShuffle)
+RANDOM_NATIVE(randomSample)
+RANDOM_NATIVE(randomChoice)
+
+#undef RANDOM_NATIVE
+
+static void freeGenerator(DictuVM *vm, ObjAbstract *abstract)
+{
+    FREE(vm, Generator, abstract->data);
+}
+
+static Value newGenerator(DictuVM *vm, uint64_t seed)
+{
+    ObjAbstract *abstract = initAbstract(vm, freeGenerator);
+    push(vm, OBJ_VAL(abstract));
+
+    Generator *generator = ALLOCATE(vm, Generator, 1);
+    seedGenerator(generator, seed);
+    abstract->data = generator;
+
+    /**
+     * Setup Generator object methods
+     */
+    defineNative(vm, &abstract->values, "random", randomRandomMethod);
+    defineNative(vm, &abstract->values, "range", randomRangeMethod);
+    defineNative(vm, &abstract->values, "select", randomSelectMethod);
+    defineNative(vm, &abstract->values, "seed", randomSeedMethod);
+    defineNative(vm, &abstract->values, "fill", randomFillMethod);
+    defineNative(vm, &abstract->values, "shuffle", randomShuffleMethod);
+    defineNative(vm, &abstract->values, "sample", randomSampleMethod);
+    defineNative(vm, &abstract->values, "choice", randomChoiceMethod);
+    defineNative(vm, &abstract->values, "split", splitGenerator);
+    pop(vm);
+
+    return OBJ_VAL(abstract);
+}
+
+// Seeds a generator from the clock and the address of the new state, so generators made together still differ
+static uint64_t entropySeed(DictuVM *vm)
+{
+    uint64_t seed = (uint64_t)time(NULL) ^ ((uint64_t)clock() << 32) ^ (uint64_t)(uintptr_t)vm;
+    static uint64_t counter = 0;
+    seed ^= ++counter * 0x9E3779B97F4A7C15;
+    return splitmix64(&seed);
+}
+
+static Value generatorNative(DictuVM *vm, int argCount, Value *args)
+{
+    if (argCount > 1)
+    {
+        runtimeError(vm, "Generator() takes 0 or 1 arguments (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    if (argCount == 1)
+    {
+        if (!IS_NUMBER(args[0]))
+        {
+            runtimeError(vm, "Generator() argument must be a number");
+            return EMPTY_VAL;
+        }
+
+        return newGenerator(vm, seedFromNumber(AS_NUMBER(args[0])));
+    }
+
+    return newGenerator(vm, entropySeed(vm));
+}
+
 ObjModule *createRandomModule(DictuVM *vm)
 {
     ObjString *name = copyString(vm, "Random", 6);
@@ -74,23 +557,28 @@ ObjModule *createRandomModule(DictuVM *vm)
     ObjModule *module = newModule(vm, name);
     push(vm, OBJ_VAL(module));
 
-    srand(time(NULL));
-
     /**
      * Define Random methods
      */
     defineNative(vm, &module->values, "strerror", strerrorNative);
-    defineNative(vm, &module->values, "random", randomRandom);
-    defineNative(vm, &module->values, "range", randomRange);
-    defineNative(vm, &module->values, "select", randomSelect);
+    defineNative(vm, &module->values, "random", randomRandomModule);
+    defineNative(vm, &module->values, "range", randomRangeModule);
+    defineNative(vm, &module->values, "select", randomSelectModule);
+    defineNative(vm, &module->values, "seed", randomSeedModule);
+    defineNative(vm, &module->values, "fill", randomFillModule);
+    defineNative(vm, &module->values, "shuffle", randomShuffleModule);
+    defineNative(vm, &module->values, "sample", randomSampleModule);
+    defineNative(vm, &module->values, "choice", randomChoiceModule);
+    defineNative(vm, &module->values, "Generator", generatorNative);
 
     /**
      * Define Random properties
      */
     defineNativeProperty(vm, &module->values, "errno", NUMBER_VAL(0));
+    defineNativeProperty(vm, &module->values, "__generator__", newGenerator(vm, entropySeed(vm)));
 
     pop(vm);
     pop(vm);
 
     return module;
-}
\ No newline at end of file
+}
@@ -1,5 +1,6 @@
 #include "socket.h"
 
+#include <errno.h>
 #include <stdio.h>
 
 #ifdef _WIN32
@@ -33,6 +34,13 @@ typedef struct {
 
 #define AS_SOCKET(v) ((SocketData*)AS_ABSTRACT(v)->data)
 
+// A peer that has gone away should fail the send rather than kill the process with SIGPIPE
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+
 ObjAbstract *newSocket(DictuVM *vm, int sock, int socketFamily, int socketType, int socketProtocol);
 
 static Value createSocket(DictuVM *vm, int argCount, Value *args) {
@@ -262,6 +270,31 @@ void freeSocket(DictuVM *vm, ObjAbstract *abstract) {
     FREE(vm, SocketData, abstract->data);
 }
 
+bool isSocket(Value value) {
+    return IS_ABSTRACT(value) && AS_ABSTRACT(value)->func == freeSocket;
+}
+
+bool sendAllSocket(Value socket, const char *buffer, size_t length) {
+    SocketData *sock = AS_SOCKET(socket);
+
+    while (length > 0) {
+        int sent = send(sock->socket, buffer, length, SEND_FLAGS);
+        if (sent == -1) {
+            // Interrupted by a signal, e.g. the profiler's SIGPROF, before anything was sent
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return false;
+        }
+
+        buffer += sent;
+        length -= sent;
+    }
+
+    return true;
+}
+
 ObjAbstract *newSocket(DictuVM *vm, int sock, int socketFamily, int socketType, int socketProtocol) {
     ObjAbstract *abstract = initAbstract(vm, freeSocket);
     push(vm, OBJ_VAL(abstract));
@@ -274,6 +307,11 @@ ObjAbstract *newSocket(DictuVM *vm, int sock, int socketFamily, int socketType,
 
     abstract->data = socket;
 
+#if !defined(MSG_NOSIGNAL) && defined(SO_NOSIGPIPE)
+    // Platforms without MSG_NOSIGNAL suppress SIGPIPE per socket instead
+    setsockopt(sock, SOL_SOCKET, SO_NOSIGPIPE, &(int){1}, sizeof(int));
+#endif
+
     /**
      * Setup Socket object methods
      */
@@ -12,4 +12,9 @@
 
 ObjModule *createSocketModule(DictuVM *vm);
 
+bool isSocket(Value value);
+
+// Writes the whole buffer to the socket, retrying on partial sends
+bool sendAllSocket(Value socket, const char *buffer, size_t length);
+
 #endif //dictu_socket_h
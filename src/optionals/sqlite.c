@@ -1,15 +1,38 @@
 #include "sqlite.h"
 
+#include <limits.h>
+
+// Number of prepared statements kept per connection
+#define STATEMENT_CACHE_SIZE 16
+
 typedef struct {
-    sqlite3 *db;
-} Database;
+    char *sql;
+    int length;
+    uint32_t hash;
+    sqlite3_stmt *stmt;
+    uint64_t lastUsed;
+} CachedStatement;
+
+typedef struct sStatement Statement;
 
 typedef struct {
     sqlite3 *db;
+    CachedStatement cache[STATEMENT_CACHE_SIZE];
+    int cacheCount;
+    uint64_t clock;
+    // Statements created with prepare(), finalized along with the connection
+    Statement *statements;
+} Database;
+
+struct sStatement {
+    Database *db;
     sqlite3_stmt *stmt;
-} Result;
+    Statement *prev;
+    Statement *next;
+};
 
 #define AS_SQLITE_DATABASE(v) ((Database*)AS_ABSTRACT(v)->data)
+#define AS_SQLITE_STATEMENT(v) ((Statement*)AS_ABSTRACT(v)->data)
 
 ObjAbstract *newSqlite(DictuVM *vm);
 
@@ -49,20 +72,101 @@ static void handleSqliteError(DictuVM *vm, sqlite3 *db) {
     defineNativeProperty(vm, &module->values, "__error__", OBJ_VAL(copyString(vm, err, strlen(err))));
 }
 
-static int countParameters(char *query) {
-    int length = strlen(query);
-    int count = 0;
+static bool isOpen(DictuVM *vm, Database *db, const char *name) {
+    if (db == NULL || db->db == NULL) {
+        runtimeError(vm, "%s() called on a closed database", name);
+        return false;
+    }
+
+    return true;
+}
 
-    for (int i = 0; i < length; ++i) {
-        if (query[i] == '?') count++;
+/**
+ * Returns a ready to bind statement for the query, reusing a previously prepared
+ * one where possible. When the cache is full the least recently used statement
+ * is finalized. Returns NULL if the query fails to prepare.
+ */
+static sqlite3_stmt *getStatement(DictuVM *vm, Database *db, ObjString *sql) {
+    db->clock++;
+
+    for (int i = 0; i < db->cacheCount; ++i) {
+        CachedStatement *entry = &db->cache[i];
+
+        if (entry->hash == sql->hash && entry->length == sql->length &&
+            memcmp(entry->sql, sql->chars, sql->length) == 0) {
+            entry->lastUsed = db->clock;
+            return entry->stmt;
+        }
     }
 
-    return count;
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db->db, sql->chars, sql->length, &stmt, NULL) != SQLITE_OK) {
+        return NULL;
+    }
+
+    CachedStatement *entry;
+
+    if (db->cacheCount < STATEMENT_CACHE_SIZE) {
+        entry = &db->cache[db->cacheCount++];
+    } else {
+        entry = &db->cache[0];
+
+        for (int i = 1; i < db->cacheCount; ++i) {
+            if (db->cache[i].lastUsed < entry->lastUsed) {
+                entry = &db->cache[i];
+            }
+        }
+
+        sqlite3_finalize(entry->stmt);
+        FREE_ARRAY(vm, char, entry->sql, entry->length);
+    }
+
+    entry->sql = ALLOCATE(vm, char, sql->length);
+    memcpy(entry->sql, sql->chars, sql->length);
+    entry->length = sql->length;
+    entry->hash = sql->hash;
+    entry->stmt = stmt;
+    entry->lastUsed = db->clock;
+
+    return stmt;
+}
+
+/**
+ * Finalizes every cached and prepared statement, which sqlite requires before
+ * the connection can be closed.
+ */
+static void closeDatabase(DictuVM *vm, Database *db) {
+    for (int i = 0; i < db->cacheCount; ++i) {
+        sqlite3_finalize(db->cache[i].stmt);
+        FREE_ARRAY(vm, char, db->cache[i].sql, db->cache[i].length);
+    }
+
+    db->cacheCount = 0;
+
+    for (Statement *statement = db->statements; statement != NULL; statement = statement->next) {
+        sqlite3_finalize(statement->stmt);
+        statement->stmt = NULL;
+        statement->db = NULL;
+    }
+
+    db->statements = NULL;
+
+    sqlite3_close(db->db);
+    db->db = NULL;
 }
 
 void bindValue(sqlite3_stmt *stmt, int index, Value value) {
     if (IS_NUMBER(value)) {
-        sqlite3_bind_double(stmt, index, AS_NUMBER(value));
+        double number = AS_NUMBER(value);
+
+        // Whole numbers are stored as integers so they keep INTEGER affinity and compare exactly
+        if (number >= -9223372036854775808.0 && number < 9223372036854775808.0 &&
+            (double) (int64_t) number == number) {
+            sqlite3_bind_int64(stmt, index, (int64_t) number);
+        } else {
+            sqlite3_bind_double(stmt, index, number);
+        }
+
         return;
     }
 
@@ -77,6 +181,101 @@ void bindValue(sqlite3_stmt *stmt, int index, Value value) {
     }
 }
 
+// Builds a list from the columns of the row the statement is currently on
+static ObjList *readRow(DictuVM *vm, sqlite3_stmt *stmt, int columnCount) {
+    ObjList *rowList = initList(vm);
+    push(vm, OBJ_VAL(rowList));
+
+    for (int i = 0; i < columnCount; i++) {
+        switch (sqlite3_column_type(stmt, i)) {
+            case SQLITE_NULL: {
+                writeValueArray(vm, &rowList->values, NIL_VAL);
+                break;
+            }
+
+            case SQLITE_INTEGER:
+            case SQLITE_FLOAT: {
+                writeValueArray(vm, &rowList->values, NUMBER_VAL(sqlite3_column_double(stmt, i)));
+                break;
+            }
+
+            case SQLITE_TEXT: {
+                char *s = (char *)sqlite3_column_text(stmt, i);
+                ObjString *string = copyString(vm, s, sqlite3_column_bytes(stmt, i));
+                push(vm, OBJ_VAL(string));
+                writeValueArray(vm, &rowList->values, OBJ_VAL(string));
+                pop(vm);
+                break;
+            }
+        }
+    }
+
+    pop(vm);
+    return rowList;
+}
+
+static bool bindParameters(DictuVM *vm, sqlite3_stmt *stmt, ObjList *list, const char *name) {
+    int parameterCount = sqlite3_bind_parameter_count(stmt);
+    int argumentCount = list == NULL ? 0 : list->values.count;
+
+    if (parameterCount != argumentCount) {
+        runtimeError(vm, "%s() has %d parameters but %d were given", name, parameterCount, argumentCount);
+        return false;
+    }
+
+    for (int i = 0; i < parameterCount; ++i) {
+        bindValue(stmt, i + 1, list->values.values[i]);
+    }
+
+    return true;
+}
+
+/**
+ * Binds the parameters, steps the statement to completion and resets it so it
+ * can be reused. Statements that return columns give back a list of rows,
+ * others return true. Returns nil on error.
+ */
+static Value runStatement(DictuVM *vm, Database *db, sqlite3_stmt *stmt, ObjList *list, const char *name) {
+    if (!bindParameters(vm, stmt, list, name)) {
+        sqlite3_clear_bindings(stmt);
+        return EMPTY_VAL;
+    }
+
+    int columnCount = sqlite3_column_count(stmt);
+    ObjList *finalList = initList(vm);
+    push(vm, OBJ_VAL(finalList));
+
+    for (;;) {
+        int err = sqlite3_step(stmt);
+        if (err != SQLITE_ROW) {
+            if (err == SQLITE_DONE) {
+                break;
+            }
+
+            handleSqliteError(vm, db->db);
+            sqlite3_reset(stmt);
+            sqlite3_clear_bindings(stmt);
+            pop(vm);
+            return NIL_VAL;
+        }
+
+        ObjList *rowList = readRow(vm, stmt, columnCount);
+        push(vm, OBJ_VAL(rowList));
+        writeValueArray(vm, &finalList->values, OBJ_VAL(rowList));
+        pop(vm);
+    }
+
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    pop(vm);
+
+    if (columnCount > 0) {
+        return OBJ_VAL(finalList);
+    }
+
+    return TRUE_VAL;
+}
+
 static Value execute(DictuVM *vm, int argCount, Value *args) {
     if (argCount != 1 && argCount != 2) {
         runtimeError(vm, "execute() takes 1 or 2 arguments (%d given)", argCount);
@@ -89,10 +288,7 @@ static Value execute(DictuVM *vm, int argCount, Value *args) {
     }
 
     Database *db = AS_SQLITE_DATABASE(args[0]);
-    char *sql = AS_CSTRING(args[1]);
     ObjList *list = NULL;
-    int parameterCount = countParameters(sql);;
-    int argumentCount = 0;
 
     if (argCount == 2) {
         if (!IS_LIST(args[2])) {
@@ -101,92 +297,599 @@ static Value execute(DictuVM *vm, int argCount, Value *args) {
         }
 
         list = AS_LIST(args[2]);
-        argumentCount = list->values.count;
     }
 
-    if (parameterCount != argumentCount) {
-        runtimeError(vm, "execute() has %d parameters but %d were given", parameterCount, argumentCount);
+    if (!isOpen(vm, db, "execute")) {
         return EMPTY_VAL;
     }
 
-    Result result;
-
-    int err = sqlite3_prepare_v2(db->db, sql, -1, &result.stmt, NULL);
-    if (err != SQLITE_OK) {
+    sqlite3_stmt *stmt = getStatement(vm, db, AS_STRING(args[1]));
+    if (stmt == NULL) {
         handleSqliteError(vm, db->db);
         return NIL_VAL;
     }
 
-    if (parameterCount != 0 && list != NULL) {
-        for (int i = 0; i < parameterCount; ++i) {
-            bindValue(result.stmt, i + 1, list->values.values[i]);
-        }
-    }
+    return runStatement(vm, db, stmt, list, "execute");
+}
 
-    ObjList *finalList = initList(vm);
-    push(vm, OBJ_VAL(finalList));
-    bool returnValue = false;
+/**
+ * Steps the statement to completion, appending each value to a list per column
+ * rather than allocating a list per row. Returns a dict of column name to list.
+ */
+static Value runColumnar(DictuVM *vm, Database *db, sqlite3_stmt *stmt) {
+    int columnCount = sqlite3_column_count(stmt);
+    ObjList *columns = initList(vm);
+    push(vm, OBJ_VAL(columns));
+
+    for (int i = 0; i < columnCount; ++i) {
+        ObjList *column = initList(vm);
+        push(vm, OBJ_VAL(column));
+        writeValueArray(vm, &columns->values, OBJ_VAL(column));
+        pop(vm);
+    }
 
     for (;;) {
-        err = sqlite3_step(result.stmt);
+        int err = sqlite3_step(stmt);
         if (err != SQLITE_ROW) {
             if (err == SQLITE_DONE) {
-                if (sql[0] == 'S' || sql[0] == 's') {
-                    // If a select statement returns no results SQLITE_ROW is not used.
-                    returnValue = true;
-                }
-
                 break;
             }
 
             handleSqliteError(vm, db->db);
-            sqlite3_finalize(result.stmt);
+            sqlite3_reset(stmt);
+            sqlite3_clear_bindings(stmt);
+            pop(vm);
             return NIL_VAL;
         }
 
-        returnValue = true;
+        for (int i = 0; i < columnCount; ++i) {
+            ValueArray *values = &AS_LIST(columns->values.values[i])->values;
 
-        ObjList *rowList = initList(vm);
-        push(vm, OBJ_VAL(rowList));
-
-        for (int i = 0; i < sqlite3_column_count(result.stmt); i++) {
-            switch (sqlite3_column_type(result.stmt, i)) {
-                case SQLITE_NULL: {
-                    writeValueArray(vm, &rowList->values, NIL_VAL);
+            switch (sqlite3_column_type(stmt, i)) {
+                case SQLITE_INTEGER: {
+                    writeValueArray(vm, values, NUMBER_VAL((double) sqlite3_column_int64(stmt, i)));
                     break;
                 }
 
-                case SQLITE_INTEGER:
                 case SQLITE_FLOAT: {
-                    writeValueArray(vm, &rowList->values, NUMBER_VAL(sqlite3_column_double(result.stmt, i)));
+                    writeValueArray(vm, values, NUMBER_VAL(sqlite3_column_double(stmt, i)));
                     break;
                 }
 
                 case SQLITE_TEXT: {
-                    char *s = (char *)sqlite3_column_text(result.stmt, i);
-                    ObjString *string = copyString(vm, s, strlen(s));
+                    char *s = (char *)sqlite3_column_text(stmt, i);
+                    ObjString *string = copyString(vm, s, sqlite3_column_bytes(stmt, i));
                     push(vm, OBJ_VAL(string));
-                    writeValueArray(vm, &rowList->values, OBJ_VAL(string));
+                    writeValueArray(vm, values, OBJ_VAL(string));
                     pop(vm);
                     break;
                 }
+
+                // Keep the columns aligned for types that have no Dictu value
+                default: {
+                    writeValueArray(vm, values, NIL_VAL);
+                    break;
+                }
             }
         }
+    }
 
-        writeValueArray(vm, &finalList->values, OBJ_VAL(rowList));
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+
+    ObjDict *dict = initDict(vm);
+    push(vm, OBJ_VAL(dict));
+    dictReserve(vm, dict, columnCount);
+
+    for (int i = 0; i < columnCount; ++i) {
+        const char *name = sqlite3_column_name(stmt, i);
+        ObjString *key = copyString(vm, name, strlen(name));
+        push(vm, OBJ_VAL(key));
+        dictSet(vm, dict, OBJ_VAL(key), columns->values.values[i]);
         pop(vm);
     }
 
-    sqlite3_finalize(result.stmt);
+    pop(vm);
     pop(vm);
 
-    if (returnValue) {
-        return OBJ_VAL(finalList);
+    return OBJ_VAL(dict);
+}
+
+static Value query(DictuVM *vm, int argCount, Value *args) {
+    if (argCount < 1 || argCount > 3) {
+        runtimeError(vm, "query() takes between 1 and 3 arguments (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    if (!IS_STRING(args[1])) {
+        runtimeError(vm, "query() first argument must be a string.");
+        return EMPTY_VAL;
+    }
+
+    ObjList *list = NULL;
+    bool columnar = false;
+
+    if (argCount >= 2) {
+        if (!IS_LIST(args[2])) {
+            runtimeError(vm, "query() second argument must be a list.");
+            return EMPTY_VAL;
+        }
+
+        list = AS_LIST(args[2]);
+    }
+
+    if (argCount == 3) {
+        if (!IS_DICT(args[3])) {
+            runtimeError(vm, "query() third argument must be a dictionary.");
+            return EMPTY_VAL;
+        }
+
+        Value option;
+        if (dictGet(AS_DICT(args[3]), OBJ_VAL(copyString(vm, "columnar", 8)), &option)) {
+            if (!IS_BOOL(option)) {
+                runtimeError(vm, "query() columnar option must be a boolean.");
+                return EMPTY_VAL;
+            }
+
+            columnar = AS_BOOL(option);
+        }
+    }
+
+    Database *db = AS_SQLITE_DATABASE(args[0]);
+
+    if (!isOpen(vm, db, "query")) {
+        return EMPTY_VAL;
+    }
+
+    sqlite3_stmt *stmt = getStatement(vm, db, AS_STRING(args[1]));
+    if (stmt == NULL) {
+        handleSqliteError(vm, db->db);
+        return NIL_VAL;
+    }
+
+    if (!columnar || sqlite3_column_count(stmt) == 0) {
+        return runStatement(vm, db, stmt, list, "query");
+    }
+
+    if (!bindParameters(vm, stmt, list, "query")) {
+        sqlite3_clear_bindings(stmt);
+        return EMPTY_VAL;
+    }
+
+    return runColumnar(vm, db, stmt);
+}
+
+/**
+ * Runs the statement once for each list of parameters. Unless disabled, the rows
+ * are written inside a single transaction, which is rolled back on error.
+ */
+static Value executeMany(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 2 && argCount != 3) {
+        runtimeError(vm, "executeMany() takes 2 or 3 arguments (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    if (!IS_STRING(args[1])) {
+        runtimeError(vm, "executeMany() first argument must be a string.");
+        return EMPTY_VAL;
+    }
+
+    if (!IS_LIST(args[2])) {
+        runtimeError(vm, "executeMany() second argument must be a list.");
+        return EMPTY_VAL;
+    }
+
+    bool useTransaction = true;
+
+    if (argCount == 3) {
+        if (!IS_BOOL(args[3])) {
+            runtimeError(vm, "executeMany() third argument must be a boolean.");
+            return EMPTY_VAL;
+        }
+
+        useTransaction = AS_BOOL(args[3]);
+    }
+
+    Database *db = AS_SQLITE_DATABASE(args[0]);
+
+    if (!isOpen(vm, db, "executeMany")) {
+        return EMPTY_VAL;
+    }
+
+    sqlite3_stmt *stmt = getStatement(vm, db, AS_STRING(args[1]));
+    if (stmt == NULL) {
+        handleSqliteError(vm, db->db);
+        return NIL_VAL;
+    }
+
+    ObjList *rows = AS_LIST(args[2]);
+    int parameterCount = sqlite3_bind_parameter_count(stmt);
+
+    // Check every row up front so a runtime error never leaves a transaction open
+    for (int i = 0; i < rows->values.count; ++i) {
+        Value row = rows->values.values[i];
+
+        if (!IS_LIST(row)) {
+            runtimeError(vm, "executeMany() second argument must be a list of lists.");
+            return EMPTY_VAL;
+        }
+
+        if (AS_LIST(row)->values.count != parameterCount) {
+            runtimeError(vm, "executeMany() has %d parameters but %d were given", parameterCount,
+                         AS_LIST(row)->values.count);
+            return EMPTY_VAL;
+        }
+    }
+
+    // Joining a transaction the caller already opened is left to them to commit
+    useTransaction = useTransaction && sqlite3_get_autocommit(db->db);
+
+    if (useTransaction && sqlite3_exec(db->db, "BEGIN", NULL, NULL, NULL) != SQLITE_OK) {
+        handleSqliteError(vm, db->db);
+        return NIL_VAL;
+    }
+
+    for (int i = 0; i < rows->values.count; ++i) {
+        ObjList *row = AS_LIST(rows->values.values[i]);
+
+        for (int j = 0; j < parameterCount; ++j) {
+            bindValue(stmt, j + 1, row->values.values[j]);
+        }
+
+        int err = sqlite3_step(stmt);
+        while (err == SQLITE_ROW) {
+            err = sqlite3_step(stmt);
+        }
+
+        if (err != SQLITE_DONE) {
+            handleSqliteError(vm, db->db);
+            sqlite3_reset(stmt);
+            sqlite3_clear_bindings(stmt);
+
+            if (useTransaction) {
+                sqlite3_exec(db->db, "ROLLBACK", NULL, NULL, NULL);
+            }
+
+            return NIL_VAL;
+        }
+
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+    }
+
+    if (useTransaction && sqlite3_exec(db->db, "COMMIT", NULL, NULL, NULL) != SQLITE_OK) {
+        handleSqliteError(vm, db->db);
+        sqlite3_exec(db->db, "ROLLBACK", NULL, NULL, NULL);
+        return NIL_VAL;
     }
 
     return TRUE_VAL;
 }
 
+static Value executeStatement(DictuVM *vm, int argCount, Value *args) {
+    if (argCount > 1) {
+        runtimeError(vm, "execute() takes 0 or 1 arguments (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    ObjList *list = NULL;
+
+    if (argCount == 1) {
+        if (!IS_LIST(args[1])) {
+            runtimeError(vm, "execute() argument must be a list.");
+            return EMPTY_VAL;
+        }
+
+        list = AS_LIST(args[1]);
+    }
+
+    Statement *statement = AS_SQLITE_STATEMENT(args[0]);
+
+    if (!isOpen(vm, statement->db, "execute")) {
+        return EMPTY_VAL;
+    }
+
+    return runStatement(vm, statement->db, statement->stmt, list, "execute");
+}
+
+static void linkStatement(Database *db, Statement *statement, sqlite3_stmt *stmt) {
+    statement->db = db;
+    statement->stmt = stmt;
+    statement->prev = NULL;
+    statement->next = db->statements;
+
+    if (db->statements != NULL) {
+        db->statements->prev = statement;
+    }
+
+    db->statements = statement;
+}
+
+static void finalizeStatement(Statement *statement) {
+    // The connection finalizes its statements if it is closed first
+    if (statement->db == NULL) {
+        return;
+    }
+
+    if (statement->prev != NULL) {
+        statement->prev->next = statement->next;
+    } else {
+        statement->db->statements = statement->next;
+    }
+
+    if (statement->next != NULL) {
+        statement->next->prev = statement->prev;
+    }
+
+    sqlite3_finalize(statement->stmt);
+    statement->stmt = NULL;
+    statement->db = NULL;
+}
+
+static void freeStatement(DictuVM *vm, ObjAbstract *abstract) {
+    finalizeStatement(abstract->data);
+    FREE(vm, Statement, abstract->data);
+}
+
+static Value prepare(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 1) {
+        runtimeError(vm, "prepare() takes 1 argument (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    if (!IS_STRING(args[1])) {
+        runtimeError(vm, "prepare() argument must be a string.");
+        return EMPTY_VAL;
+    }
+
+    Database *db = AS_SQLITE_DATABASE(args[0]);
+
+    if (!isOpen(vm, db, "prepare")) {
+        return EMPTY_VAL;
+    }
+
+    ObjString *sql = AS_STRING(args[1]);
+    sqlite3_stmt *stmt;
+
+    if (sqlite3_prepare_v2(db->db, sql->chars, sql->length, &stmt, NULL) != SQLITE_OK) {
+        handleSqliteError(vm, db->db);
+        return NIL_VAL;
+    }
+
+    ObjAbstract *abstract = initAbstract(vm, freeStatement);
+    push(vm, OBJ_VAL(abstract));
+
+    Statement *statement = ALLOCATE(vm, Statement, 1);
+    linkStatement(db, statement, stmt);
+    abstract->data = statement;
+
+    /**
+     * Setup Statement object methods
+     */
+    defineNative(vm, &abstract->values, "execute", executeStatement);
+    // Keeps the connection alive for as long as the statement is reachable
+    defineNativeProperty(vm, &abstract->values, "__connection__", args[0]);
+    pop(vm);
+
+    return OBJ_VAL(abstract);
+}
+
+typedef struct {
+    // Must be first so the cursor can be finalized as a statement
+    Statement statement;
+    int columnCount;
+    // Set when a row has been stepped to but not yet returned
+    bool pending;
+    bool done;
+} Cursor;
+
+#define AS_SQLITE_CURSOR(v) ((Cursor*)AS_ABSTRACT(v)->data)
+
+/**
+ * Moves the cursor onto the next row unless one is already pending. Once the
+ * results are exhausted the statement is reset so it no longer holds a read
+ * transaction open.
+ */
+static int stepCursor(DictuVM *vm, Cursor *cursor) {
+    if (cursor->pending) {
+        return SQLITE_ROW;
+    }
+
+    if (cursor->done) {
+        return SQLITE_DONE;
+    }
+
+    int err = sqlite3_step(cursor->statement.stmt);
+
+    if (err == SQLITE_ROW) {
+        cursor->pending = true;
+        return err;
+    }
+
+    if (err != SQLITE_DONE) {
+        handleSqliteError(vm, cursor->statement.db->db);
+    }
+
+    cursor->done = true;
+    sqlite3_reset(cursor->statement.stmt);
+
+    return err;
+}
+
+static Value fetchRow(DictuVM *vm, Cursor *cursor) {
+    if (stepCursor(vm, cursor) != SQLITE_ROW) {
+        return NIL_VAL;
+    }
+
+    cursor->pending = false;
+    return OBJ_VAL(readRow(vm, cursor->statement.stmt, cursor->columnCount));
+}
+
+static Value fetchOneCursor(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 0) {
+        runtimeError(vm, "fetchOne() takes no arguments (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    Cursor *cursor = AS_SQLITE_CURSOR(args[0]);
+
+    if (!isOpen(vm, cursor->statement.db, "fetchOne")) {
+        return EMPTY_VAL;
+    }
+
+    return fetchRow(vm, cursor);
+}
+
+static Value fetchManyCursor(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 1) {
+        runtimeError(vm, "fetchMany() takes 1 argument (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    if (!IS_NUMBER(args[1])) {
+        runtimeError(vm, "fetchMany() argument must be a number");
+        return EMPTY_VAL;
+    }
+
+    // Range check before converting, out of range doubles don't convert to int safely
+    double size = AS_NUMBER(args[1]);
+    if (!(size >= 0 && size <= INT_MAX) || size != (int) size) {
+        runtimeError(vm, "fetchMany() argument must be a non-negative integer");
+        return EMPTY_VAL;
+    }
+
+    Cursor *cursor = AS_SQLITE_CURSOR(args[0]);
+
+    if (!isOpen(vm, cursor->statement.db, "fetchMany")) {
+        return EMPTY_VAL;
+    }
+
+    int count = size;
+    ObjList *list = initList(vm);
+    push(vm, OBJ_VAL(list));
+
+    for (int i = 0; i < count; ++i) {
+        int err = stepCursor(vm, cursor);
+
+        if (err != SQLITE_ROW) {
+            if (err != SQLITE_DONE) {
+                pop(vm);
+                return NIL_VAL;
+            }
+
+            break;
+        }
+
+        Value row = fetchRow(vm, cursor);
+        push(vm, row);
+        writeValueArray(vm, &list->values, row);
+        pop(vm);
+    }
+
+    pop(vm);
+    return OBJ_VAL(list);
+}
+
+static Value hasNextCursor(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 0) {
+        runtimeError(vm, "hasNext() takes no arguments (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    Cursor *cursor = AS_SQLITE_CURSOR(args[0]);
+
+    if (!isOpen(vm, cursor->statement.db, "hasNext")) {
+        return EMPTY_VAL;
+    }
+
+    return BOOL_VAL(stepCursor(vm, cursor) == SQLITE_ROW);
+}
+
+static Value nextCursor(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 0) {
+        runtimeError(vm, "next() takes no arguments (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    Cursor *cursor = AS_SQLITE_CURSOR(args[0]);
+
+    if (!isOpen(vm, cursor->statement.db, "next")) {
+        return EMPTY_VAL;
+    }
+
+    return fetchRow(vm, cursor);
+}
+
+static void freeCursor(DictuVM *vm, ObjAbstract *abstract) {
+    finalizeStatement(abstract->data);
+    FREE(vm, Cursor, abstract->data);
+}
+
+static Value openCursor(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 1 && argCount != 2) {
+        runtimeError(vm, "cursor() takes 1 or 2 arguments (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    if (!IS_STRING(args[1])) {
+        runtimeError(vm, "cursor() first argument must be a string.");
+        return EMPTY_VAL;
+    }
+
+    ObjList *list = NULL;
+
+    if (argCount == 2) {
+        if (!IS_LIST(args[2])) {
+            runtimeError(vm, "cursor() second argument must be a list.");
+            return EMPTY_VAL;
+        }
+
+        list = AS_LIST(args[2]);
+    }
+
+    Database *db = AS_SQLITE_DATABASE(args[0]);
+
+    if (!isOpen(vm, db, "cursor")) {
+        return EMPTY_VAL;
+    }
+
+    // Cursors step their own statement so they are unaffected by other queries
+    ObjString *sql = AS_STRING(args[1]);
+    sqlite3_stmt *stmt;
+
+    if (sqlite3_prepare_v2(db->db, sql->chars, sql->length, &stmt, NULL) != SQLITE_OK) {
+        handleSqliteError(vm, db->db);
+        return NIL_VAL;
+    }
+
+    if (!bindParameters(vm, stmt, list, "cursor")) {
+        sqlite3_finalize(stmt);
+        return EMPTY_VAL;
+    }
+
+    ObjAbstract *abstract = initAbstract(vm, freeCursor);
+    push(vm, OBJ_VAL(abstract));
+
+    Cursor *cursor = ALLOCATE(vm, Cursor, 1);
+    linkStatement(db, &cursor->statement, stmt);
+    cursor->columnCount = sqlite3_column_count(stmt);
+    cursor->pending = false;
+    cursor->done = false;
+    abstract->data = cursor;
+
+    /**
+     * Setup Cursor object methods
+     */
+    defineNative(vm, &abstract->values, "fetchOne", fetchOneCursor);
+    defineNative(vm, &abstract->values, "fetchMany", fetchManyCursor);
+    defineNative(vm, &abstract->values, "hasNext", hasNextCursor);
+    defineNative(vm, &abstract->values, "next", nextCursor);
+    defineNativeProperty(vm, &abstract->values, "__connection__", args[0]);
+    pop(vm);
+
+    return OBJ_VAL(abstract);
+}
+
 static Value closeConnection(DictuVM *vm, int argCount, Value *args) {
     if (argCount != 0) {
         runtimeError(vm, "close() takes no arguments (%d given)", argCount);
@@ -194,7 +897,7 @@ static Value closeConnection(DictuVM *vm, int argCount, Value *args) {
     }
 
     Database *db = AS_SQLITE_DATABASE(args[0]);
-    sqlite3_close(db->db);
+    closeDatabase(vm, db);
 
     return NIL_VAL;
 }
@@ -227,7 +930,7 @@ static Value connectSqlite(DictuVM *vm, int argCount, Value *args) {
 
 void freeSqlite(DictuVM *vm, ObjAbstract *abstract) {
     Database *db = (Database*)abstract->data;
-    sqlite3_close(db->db);
+    closeDatabase(vm, db);
     FREE(vm, Database, abstract->data);
 }
 
@@ -236,11 +939,19 @@ ObjAbstract *newSqlite(DictuVM *vm) {
     push(vm, OBJ_VAL(abstract));
 
     Database *db = ALLOCATE(vm, Database, 1);
+    db->db = NULL;
+    db->cacheCount = 0;
+    db->clock = 0;
+    db->statements = NULL;
 
     /**
      * Setup Sqlite object methods
      */
     defineNative(vm, &abstract->values, "execute", execute);
+    defineNative(vm, &abstract->values, "executeMany", executeMany);
+    defineNative(vm, &abstract->values, "query", query);
+    defineNative(vm, &abstract->values, "prepare", prepare);
+    defineNative(vm, &abstract->values, "cursor", openCursor);
     defineNative(vm, &abstract->values, "close", closeConnection);
 
     abstract->data = db;
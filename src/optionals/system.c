@@ -232,6 +232,347 @@ static Value clockNative(DictuVM *vm, int argCount, Value *args) {
     return NUMBER_VAL((double) clock() / CLOCKS_PER_SEC);
 }
 
+uint64_t monotonicNs(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+
+    QueryPerformanceCounter(&counter);
+
+    return (uint64_t) (counter.QuadPart / frequency.QuadPart) * 1000000000 +
+           (uint64_t) (counter.QuadPart % frequency.QuadPart) * 1000000000 / frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+static Value monotonicNsNative(DictuVM *vm, int argCount, Value *args) {
+    UNUSED(args);
+
+    if (argCount != 0) {
+        runtimeError(vm, "monotonicNs() doesn't take any argument (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    return NUMBER_VAL((double) monotonicNs());
+}
+
+#ifndef _WIN32
+static Value profileStartNative(DictuVM *vm, int argCount, Value *args) {
+    if (argCount > 1) {
+        runtimeError(vm, "start() takes 0 or 1 arguments (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    int hz = PROFILE_DEFAULT_HZ;
+
+    if (argCount == 1) {
+        if (!IS_NUMBER(args[1]) || AS_NUMBER(args[1]) < 1 || AS_NUMBER(args[1]) > 100000) {
+            runtimeError(vm, "start() sample rate must be a number between 1 and 100000");
+            return EMPTY_VAL;
+        }
+
+        hz = AS_NUMBER(args[1]);
+    }
+
+    if (!startProfiler(vm, hz)) {
+        runtimeError(vm, "start() a profile is already running");
+        return EMPTY_VAL;
+    }
+
+    return NIL_VAL;
+}
+
+static Value profileStopNative(DictuVM *vm, int argCount, Value *args) {
+    if (argCount > 1) {
+        runtimeError(vm, "stop() takes 0 or 1 arguments (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    if (argCount == 1 && !IS_STRING(args[1])) {
+        runtimeError(vm, "stop() argument must be a string");
+        return EMPTY_VAL;
+    }
+
+    if (!profilerRunning(vm)) {
+        runtimeError(vm, "stop() no profile is running");
+        return EMPTY_VAL;
+    }
+
+    if (argCount == 1) {
+        return BOOL_VAL(dictuProfileStop(vm, AS_CSTRING(args[1])));
+    }
+
+    size_t length;
+    char *stacks = stopProfiler(vm, &length);
+
+    if (stacks == NULL) {
+        runtimeError(vm, "Memory error on stop()!");
+        return EMPTY_VAL;
+    }
+
+    ObjString *string = copyString(vm, stacks, length);
+    free(stacks);
+
+    return OBJ_VAL(string);
+}
+
+static void freeProfile(DictuVM *vm, ObjAbstract *abstract) {
+    UNUSED(vm); UNUSED(abstract);
+}
+
+static Value newProfile(DictuVM *vm) {
+    ObjAbstract *abstract = initAbstract(vm, freeProfile);
+    push(vm, OBJ_VAL(abstract));
+
+    /**
+     * Setup Profile object methods
+     */
+    defineNative(vm, &abstract->values, "start", profileStartNative);
+    defineNative(vm, &abstract->values, "stop", profileStopNative);
+    pop(vm);
+
+    return OBJ_VAL(abstract);
+}
+#endif
+
+#ifdef DEBUG_OPCODE_STATS
+static Value opcodeStatsNative(DictuVM *vm, int argCount, Value *args) {
+    UNUSED(args);
+
+    if (argCount != 0) {
+        runtimeError(vm, "opcodeStats() takes no arguments (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    return opcodeStatsToDict(vm);
+}
+#endif
+
+static Value allocationsStartNative(DictuVM *vm, int argCount, Value *args) {
+    if (argCount > 1) {
+        runtimeError(vm, "start() takes 0 or 1 arguments (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    size_t sampleBytes = 0;
+
+    if (argCount == 1) {
+        if (!IS_NUMBER(args[1]) || AS_NUMBER(args[1]) < 0) {
+            runtimeError(vm, "start() sample interval must be a positive number");
+            return EMPTY_VAL;
+        }
+
+        sampleBytes = AS_NUMBER(args[1]);
+    }
+
+    if (vm->allocationProfile != NULL) {
+        runtimeError(vm, "start() an allocation profile is already running");
+        return EMPTY_VAL;
+    }
+
+    if (!startAllocationProfile(vm, sampleBytes)) {
+        runtimeError(vm, "Memory error on start()!");
+        return EMPTY_VAL;
+    }
+
+    return NIL_VAL;
+}
+
+static Value allocationsReportNative(DictuVM *vm, int argCount, Value *args) {
+    UNUSED(args);
+
+    if (argCount != 0) {
+        runtimeError(vm, "report() takes no arguments (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    if (vm->allocationProfile == NULL) {
+        runtimeError(vm, "report() no allocation profile is running");
+        return EMPTY_VAL;
+    }
+
+    return allocationProfileToList(vm);
+}
+
+static Value allocationsStopNative(DictuVM *vm, int argCount, Value *args) {
+    if (argCount > 1) {
+        runtimeError(vm, "stop() takes 0 or 1 arguments (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    if (argCount == 1 && !IS_STRING(args[1])) {
+        runtimeError(vm, "stop() argument must be a string");
+        return EMPTY_VAL;
+    }
+
+    if (vm->allocationProfile == NULL) {
+        runtimeError(vm, "stop() no allocation profile is running");
+        return EMPTY_VAL;
+    }
+
+    // Collect first so the live counts are what survives a collection
+    collectGarbage(vm);
+
+    Value result;
+
+    if (argCount == 1) {
+        FILE *file = fopen(AS_CSTRING(args[1]), "w");
+        bool written = file != NULL && writeAllocationProfile(vm, file);
+
+        if (file != NULL) {
+            written = fclose(file) == 0 && written;
+        }
+
+        result = BOOL_VAL(written);
+    } else {
+        result = allocationProfileToList(vm);
+    }
+
+    stopAllocationProfile(vm);
+
+    return result;
+}
+
+static void freeAllocations(DictuVM *vm, ObjAbstract *abstract) {
+    UNUSED(vm); UNUSED(abstract);
+}
+
+static Value newAllocations(DictuVM *vm) {
+    ObjAbstract *abstract = initAbstract(vm, freeAllocations);
+    push(vm, OBJ_VAL(abstract));
+
+    /**
+     * Setup Allocations object methods
+     */
+    defineNative(vm, &abstract->values, "start", allocationsStartNative);
+    defineNative(vm, &abstract->values, "report", allocationsReportNative);
+    defineNative(vm, &abstract->values, "stop", allocationsStopNative);
+    pop(vm);
+
+    return OBJ_VAL(abstract);
+}
+
+static Value callsStartNative(DictuVM *vm, int argCount, Value *args) {
+    UNUSED(args);
+
+    if (argCount != 0) {
+        runtimeError(vm, "start() takes no arguments (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    if (vm->callProfile != NULL) {
+        runtimeError(vm, "start() a call profile is already running");
+        return EMPTY_VAL;
+    }
+
+    if (!startCallProfile(vm)) {
+        runtimeError(vm, "Memory error on start()!");
+        return EMPTY_VAL;
+    }
+
+    return NIL_VAL;
+}
+
+static Value callsReportNative(DictuVM *vm, int argCount, Value *args) {
+    UNUSED(args);
+
+    if (argCount != 0) {
+        runtimeError(vm, "report() takes no arguments (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    if (vm->callProfile == NULL) {
+        runtimeError(vm, "report() no call profile is running");
+        return EMPTY_VAL;
+    }
+
+    return callProfileToList(vm);
+}
+
+static Value callsStopNative(DictuVM *vm, int argCount, Value *args) {
+    if (argCount > 1) {
+        runtimeError(vm, "stop() takes 0 or 1 arguments (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    if (argCount == 1 && !IS_STRING(args[1])) {
+        runtimeError(vm, "stop() argument must be a string");
+        return EMPTY_VAL;
+    }
+
+    if (vm->callProfile == NULL) {
+        runtimeError(vm, "stop() no call profile is running");
+        return EMPTY_VAL;
+    }
+
+    Value result = argCount == 1 ? BOOL_VAL(saveCallProfile(vm, AS_CSTRING(args[1]))) : callProfileToList(vm);
+    stopCallProfile(vm);
+
+    return result;
+}
+
+static void freeCalls(DictuVM *vm, ObjAbstract *abstract) {
+    UNUSED(vm); UNUSED(abstract);
+}
+
+static Value newCalls(DictuVM *vm) {
+    ObjAbstract *abstract = initAbstract(vm, freeCalls);
+    push(vm, OBJ_VAL(abstract));
+
+    /**
+     * Setup Calls object methods
+     */
+    defineNative(vm, &abstract->values, "start", callsStartNative);
+    defineNative(vm, &abstract->values, "report", callsReportNative);
+    defineNative(vm, &abstract->values, "stop", callsStopNative);
+    pop(vm);
+
+    return OBJ_VAL(abstract);
+}
+
+static Value heapSnapshotNative(DictuVM *vm, int argCount, Value *args) {
+    if (argCount != 1) {
+        runtimeError(vm, "heapSnapshot() takes 1 argument (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    if (!IS_STRING(args[0])) {
+        runtimeError(vm, "heapSnapshot() argument must be a string");
+        return EMPTY_VAL;
+    }
+
+    FILE *file = fopen(AS_CSTRING(args[0]), "w");
+
+    if (file == NULL) {
+        SET_ERRNO(GET_SELF_CLASS);
+        return BOOL_VAL(false);
+    }
+
+    bool written = writeHeapSnapshot(vm, file);
+    written = fclose(file) == 0 && written;
+
+    return BOOL_VAL(written);
+}
+
+static Value heapCensusNative(DictuVM *vm, int argCount, Value *args) {
+    UNUSED(args);
+
+    if (argCount != 0) {
+        runtimeError(vm, "heapCensus() takes no arguments (%d given)", argCount);
+        return EMPTY_VAL;
+    }
+
+    return heapCensus(vm);
+}
+
 static Value collectNative(DictuVM *vm, int argCount, Value *args) {
     UNUSED(argCount); UNUSED(args);
 
@@ -335,7 +676,13 @@ void createSystemModule(DictuVM *vm, int argc, char *argv[]) {
     defineNative(vm, &module->values, "getCWD", getCWDNative);
     defineNative(vm, &module->values, "time", timeNative);
     defineNative(vm, &module->values, "clock", clockNative);
+    defineNative(vm, &module->values, "monotonicNs", monotonicNsNative);
     defineNative(vm, &module->values, "collect", collectNative);
+    defineNative(vm, &module->values, "heapSnapshot", heapSnapshotNative);
+    defineNative(vm, &module->values, "heapCensus", heapCensusNative);
+#ifdef DEBUG_OPCODE_STATS
+    defineNative(vm, &module->values, "opcodeStats", opcodeStatsNative);
+#endif
     defineNative(vm, &module->values, "sleep", sleepNative);
     defineNative(vm, &module->values, "exit", exitNative);
 
@@ -350,6 +697,11 @@ void createSystemModule(DictuVM *vm, int argc, char *argv[]) {
     initPlatform(vm, &module->values);
 
     defineNativeProperty(vm, &module->values, "errno", NUMBER_VAL(0));
+#ifndef _WIN32
+    defineNativeProperty(vm, &module->values, "profile", newProfile(vm));
+#endif
+    defineNativeProperty(vm, &module->values, "allocations", newAllocations(vm));
+    defineNativeProperty(vm, &module->values, "calls", newCalls(vm));
 
     defineNativeProperty(vm, &module->values, "S_IRWXU", NUMBER_VAL(448));
     defineNativeProperty(vm, &module->values, "S_IRUSR", NUMBER_VAL(256));
@@ -2,6 +2,7 @@
 #define dictu_system_h
 
 #include <time.h>
+#include <stdint.h>
 #include <limits.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -23,7 +24,13 @@
 #include "optionals.h"
 #include "../vm/vm.h"
 #include "../vm/memory.h"
+#include "../vm/profiler.h"
+#include "../vm/heap.h"
+#include "../include/dictu_include.h"
 
 void createSystemModule(DictuVM *vm, int argc, char *argv[]);
 
+// Nanoseconds from an arbitrary fixed point, unaffected by changes to the wall clock
+uint64_t monotonicNs(void);
+
 #endif //dictu_system_h
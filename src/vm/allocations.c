@@ -0,0 +1,329 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "allocations.h"
+#include "util.h"
+#include "vm.h"
+
+// Kept under the same index as the site's (function, line, type) key
+typedef struct {
+    ObjType type;
+    const char *label;
+    double count;
+    double bytes;
+    double liveCount;
+    double liveBytes;
+} AllocationSite;
+
+typedef struct {
+    Obj *object;
+    int site;
+    double count;
+    double bytes;
+} SampledObject;
+
+struct AllocationProfile {
+    size_t sampleBytes;
+    double untilSample;
+    uint64_t random;
+    ProfileIndex index;
+    AllocationSite *sites;
+    int siteCapacity;
+    // Open addressing on the object's address
+    SampledObject *objects;
+    size_t objectCount;
+    size_t objectCapacity;
+};
+
+// Distance to the next sample, exponentially distributed with a mean of sampleBytes
+static double nextSample(AllocationProfile *profile) {
+    profile->random ^= profile->random << 13;
+    profile->random ^= profile->random >> 7;
+    profile->random ^= profile->random << 17;
+
+    double uniform = ((profile->random >> 11) + 0.5) / 9007199254740992.0;
+    return -log(uniform) * profile->sampleBytes;
+}
+
+bool startAllocationProfile(DictuVM *vm, size_t sampleBytes) {
+    if (vm->allocationProfile != NULL) {
+        return false;
+    }
+
+    AllocationProfile *profile = calloc(1, sizeof(AllocationProfile));
+    if (profile == NULL) {
+        return false;
+    }
+
+    profile->sampleBytes = sampleBytes;
+    profile->random = ((uint64_t) time(NULL) << 1 | 1) ^ (uint64_t) (uintptr_t) profile;
+
+    if (sampleBytes > 0) {
+        profile->untilSample = nextSample(profile);
+    }
+
+    vm->allocationProfile = profile;
+    return true;
+}
+
+// Returns the site's index, or -1 if it can't be created
+static int findSite(AllocationProfile *profile, ObjFunction *function, int line, ObjType type) {
+    // Room is made first so a new site always has counts to go with its key
+    if (profile->index.count == profile->siteCapacity) {
+        int capacity = profile->siteCapacity < 64 ? 64 : profile->siteCapacity * 2;
+        AllocationSite *sites = realloc(profile->sites, sizeof(AllocationSite) * capacity);
+
+        if (sites == NULL) {
+            return -1;
+        }
+
+        profile->sites = sites;
+        profile->siteCapacity = capacity;
+    }
+
+    int count = profile->index.count;
+    int index = findProfileKey(&profile->index, function, line, type);
+
+    if (index == count) {
+        profile->sites[index] = (AllocationSite) {type, profile->index.keys[index].label, 0, 0, 0, 0};
+    }
+
+    return index;
+}
+
+static bool trackObject(AllocationProfile *profile, SampledObject sample) {
+    if ((profile->objectCount + 1) * 2 > profile->objectCapacity) {
+        size_t capacity = profile->objectCapacity < 256 ? 256 : profile->objectCapacity * 2;
+        SampledObject *objects = calloc(capacity, sizeof(SampledObject));
+
+        if (objects == NULL) {
+            return false;
+        }
+
+        for (size_t i = 0; i < profile->objectCapacity; ++i) {
+            if (profile->objects[i].object == NULL) {
+                continue;
+            }
+
+            size_t slot = hashPointer(profile->objects[i].object) & (capacity - 1);
+            while (objects[slot].object != NULL) {
+                slot = (slot + 1) & (capacity - 1);
+            }
+
+            objects[slot] = profile->objects[i];
+        }
+
+        free(profile->objects);
+        profile->objects = objects;
+        profile->objectCapacity = capacity;
+    }
+
+    size_t slot = hashPointer(sample.object) & (profile->objectCapacity - 1);
+    while (profile->objects[slot].object != NULL) {
+        slot = (slot + 1) & (profile->objectCapacity - 1);
+    }
+
+    profile->objects[slot] = sample;
+    profile->objectCount++;
+
+    return true;
+}
+
+void recordAllocation(DictuVM *vm, Obj *object, size_t size) {
+    AllocationProfile *profile = vm->allocationProfile;
+    double weight = 1;
+
+    if (profile->sampleBytes > 0) {
+        profile->untilSample -= size;
+
+        if (profile->untilSample > 0) {
+            return;
+        }
+
+        profile->untilSample = nextSample(profile);
+        // Larger objects are more likely to be picked, weight each by how unlikely it was
+        weight = 1 / -expm1(-(double) size / profile->sampleBytes);
+    }
+
+    ObjFunction *function = NULL;
+    int line = 0;
+
+    if (vm->frameCount > 0) {
+        CallFrame *frame = &vm->frames[vm->frameCount - 1];
+        function = frame->closure->function;
+
+        // The frame's ip is past the instruction that was executing when it was last stored
+        int offset = (int) (frame->ip - function->chunk.code) - 1;
+        line = function->chunk.count == 0 ? 0 : function->chunk.lines[offset < 0 ? 0 : offset];
+    }
+
+    int index = findSite(profile, function, line, object->type);
+    if (index < 0) {
+        return;
+    }
+
+    SampledObject sample = {object, index, weight, weight * size};
+    if (!trackObject(profile, sample)) {
+        return;
+    }
+
+    AllocationSite *site = &profile->sites[index];
+    site->count += sample.count;
+    site->bytes += sample.bytes;
+    site->liveCount += sample.count;
+    site->liveBytes += sample.bytes;
+    object->isSampled = true;
+}
+
+void forgetAllocation(DictuVM *vm, Obj *object) {
+    AllocationProfile *profile = vm->allocationProfile;
+    object->isSampled = false;
+
+    if (profile == NULL || profile->objectCapacity == 0) {
+        return;
+    }
+
+    size_t mask = profile->objectCapacity - 1;
+    size_t slot = hashPointer(object) & mask;
+
+    while (profile->objects[slot].object != object) {
+        if (profile->objects[slot].object == NULL) {
+            return;
+        }
+
+        slot = (slot + 1) & mask;
+    }
+
+    SampledObject *sample = &profile->objects[slot];
+    AllocationSite *site = &profile->sites[sample->site];
+    site->liveCount -= sample->count;
+    site->liveBytes -= sample->bytes;
+
+    // Backward shift deletion keeps the probe sequences of later entries intact
+    size_t hole = slot;
+    for (size_t next = (hole + 1) & mask; profile->objects[next].object != NULL; next = (next + 1) & mask) {
+        size_t home = hashPointer(profile->objects[next].object) & mask;
+
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            profile->objects[hole] = profile->objects[next];
+            hole = next;
+        }
+    }
+
+    profile->objects[hole].object = NULL;
+    profile->objectCount--;
+}
+
+void retireAllocationSites(DictuVM *vm) {
+    retireProfileKeys(&vm->allocationProfile->index);
+}
+
+static int compareSites(const void *a, const void *b) {
+    double left = ((const AllocationSite *) a)->bytes;
+    double right = ((const AllocationSite *) b)->bytes;
+
+    return (left < right) - (left > right);
+}
+
+/**
+ * Returns a copy of the sites sorted by bytes allocated, which the caller frees.
+ * Reporting allocates and can add sites, so the report works from the copy.
+ */
+static AllocationSite *sortedSites(AllocationProfile *profile, int *count) {
+    AllocationSite *sites = malloc(sizeof(AllocationSite) * (profile->index.count + 1));
+
+    if (sites == NULL) {
+        return NULL;
+    }
+
+    *count = profile->index.count;
+    memcpy(sites, profile->sites, sizeof(AllocationSite) * profile->index.count);
+
+    // Sampled weights are fractional, a site whose objects were all freed can be left a rounding error below zero
+    for (int i = 0; i < *count; ++i) {
+        sites[i].count = round(sites[i].count);
+        sites[i].bytes = round(sites[i].bytes);
+        sites[i].liveCount = sites[i].liveCount < 0.5 ? 0 : round(sites[i].liveCount);
+        sites[i].liveBytes = sites[i].liveBytes < 0.5 ? 0 : round(sites[i].liveBytes);
+    }
+    qsort(sites, *count, sizeof(AllocationSite), compareSites);
+
+    return sites;
+}
+
+Value allocationProfileToList(DictuVM *vm) {
+    AllocationProfile *profile = vm->allocationProfile;
+    int siteCount;
+    AllocationSite *sites = profile == NULL ? NULL : sortedSites(profile, &siteCount);
+
+    if (sites == NULL) {
+        return NIL_VAL;
+    }
+
+    ObjList *list = initList(vm);
+    push(vm, OBJ_VAL(list));
+
+    for (int i = 0; i < siteCount; ++i) {
+        AllocationSite *site = &sites[i];
+        const char *type = objectTypeName(site->type);
+        ObjDict *dict = initDict(vm);
+        push(vm, OBJ_VAL(dict));
+
+        setDictField(vm, dict, "site", OBJ_VAL(copyString(vm, site->label, strlen(site->label))));
+        setDictField(vm, dict, "type", OBJ_VAL(copyString(vm, type, strlen(type))));
+        setDictField(vm, dict, "count", NUMBER_VAL(site->count));
+        setDictField(vm, dict, "bytes", NUMBER_VAL(site->bytes));
+        setDictField(vm, dict, "liveCount", NUMBER_VAL(site->liveCount));
+        setDictField(vm, dict, "liveBytes", NUMBER_VAL(site->liveBytes));
+
+        writeValueArray(vm, &list->values, OBJ_VAL(dict));
+        pop(vm);
+    }
+
+    free(sites);
+    pop(vm);
+
+    return OBJ_VAL(list);
+}
+
+bool writeAllocationProfile(DictuVM *vm, FILE *file) {
+    AllocationProfile *profile = vm->allocationProfile;
+    int siteCount;
+    AllocationSite *sites = profile == NULL ? NULL : sortedSites(profile, &siteCount);
+
+    if (sites == NULL) {
+        return false;
+    }
+
+    fprintf(file, "%14s %10s %14s %10s  %-12s %s\n", "bytes", "count", "live bytes", "live", "type", "site");
+
+    for (int i = 0; i < siteCount; ++i) {
+        fprintf(file, "%14.0f %10.0f %14.0f %10.0f  %-12s %s\n", sites[i].bytes, sites[i].count,
+                sites[i].liveBytes, sites[i].liveCount, objectTypeName(sites[i].type), sites[i].label);
+    }
+
+    free(sites);
+    return true;
+}
+
+void stopAllocationProfile(DictuVM *vm) {
+    AllocationProfile *profile = vm->allocationProfile;
+
+    if (profile == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < profile->objectCapacity; ++i) {
+        if (profile->objects[i].object != NULL) {
+            profile->objects[i].object->isSampled = false;
+        }
+    }
+
+    freeProfileIndex(&profile->index);
+    free(profile->sites);
+    free(profile->objects);
+    free(profile);
+    vm->allocationProfile = NULL;
+}
@@ -0,0 +1,40 @@
+#ifndef dictu_allocations_h
+#define dictu_allocations_h
+
+#include "object.h"
+
+/**
+ * Allocation-site profiler. While running, objects created by allocateObject are
+ * attributed to the function and line executing when they were allocated. Each
+ * site keeps the objects allocated there and those still alive, which the GC
+ * updates as it frees them.
+ *
+ * Allocations can be sampled so that on average one is recorded every sampleBytes
+ * bytes, each sample weighted by the inverse of its chance of being picked so the
+ * totals remain estimates of the real ones.
+ */
+
+typedef struct AllocationProfile AllocationProfile;
+
+// Returns false if a profile is already running or the profile can't be allocated
+bool startAllocationProfile(DictuVM *vm, size_t sampleBytes);
+
+// Called by allocateObject for every object while a profile is running
+void recordAllocation(DictuVM *vm, Obj *object, size_t size);
+
+// Called by freeObject for objects that were sampled
+void forgetAllocation(DictuVM *vm, Obj *object);
+
+// Detaches sites from functions the GC is about to free, must run after marking
+void retireAllocationSites(DictuVM *vm);
+
+// Returns a list of {site, type, count, bytes, liveCount, liveBytes} sorted by bytes, or nil if none is running
+Value allocationProfileToList(DictuVM *vm);
+
+// Writes the same as a plain text table
+bool writeAllocationProfile(DictuVM *vm, FILE *file);
+
+// Stops the profile and frees its state, objects it sampled are no longer tracked
+void stopAllocationProfile(DictuVM *vm);
+
+#endif //dictu_allocations_h
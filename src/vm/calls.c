@@ -0,0 +1,305 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "calls.h"
+#include "util.h"
+#include "vm.h"
+#include "../optionals/system.h"
+
+// Kept under the same index as the function's key
+typedef struct {
+    const char *label;
+    uint64_t calls;
+    uint64_t inclusive;
+    uint64_t exclusive;
+    // Calls to the function still on the stack, inclusive time is taken when the outermost returns
+    int active;
+} FunctionCalls;
+
+typedef struct {
+    int frame;
+    int function;
+    uint64_t start;
+    // Time spent in the functions it called, taken out of its exclusive time
+    uint64_t children;
+} ProfiledFrame;
+
+struct CallProfile {
+    ProfileIndex index;
+    FunctionCalls *functions;
+    int functionCapacity;
+    // The frames entered since the profile started, frames from before it are not timed
+    ProfiledFrame *frames;
+    int frameCount;
+    int frameCapacity;
+};
+
+bool startCallProfile(DictuVM *vm) {
+    if (vm->callProfile != NULL) {
+        return false;
+    }
+
+    vm->callProfile = calloc(1, sizeof(CallProfile));
+    return vm->callProfile != NULL;
+}
+
+// Returns the function's index, or -1 if it can't be created
+static int findFunction(CallProfile *profile, ObjFunction *function) {
+    // Room is made first so a new function always has counts to go with its key
+    if (profile->index.count == profile->functionCapacity) {
+        int capacity = profile->functionCapacity < 64 ? 64 : profile->functionCapacity * 2;
+        FunctionCalls *functions = realloc(profile->functions, sizeof(FunctionCalls) * capacity);
+
+        if (functions == NULL) {
+            return -1;
+        }
+
+        profile->functions = functions;
+        profile->functionCapacity = capacity;
+    }
+
+    int count = profile->index.count;
+    int index = findProfileKey(&profile->index, function, 0, 0);
+
+    if (index == count) {
+        profile->functions[index] = (FunctionCalls) {profile->index.keys[index].label, 0, 0, 0, 0};
+    }
+
+    return index;
+}
+
+/**
+ * Drops frames at or above the given index without timing them. They were
+ * unwound by a runtime error rather than returned from.
+ */
+static void unwindFrames(CallProfile *profile, int frame) {
+    while (profile->frameCount > 0 && profile->frames[profile->frameCount - 1].frame >= frame) {
+        profile->functions[profile->frames[--profile->frameCount].function].active--;
+    }
+}
+
+void enterFunction(DictuVM *vm, ObjFunction *function, int frame) {
+    CallProfile *profile = vm->callProfile;
+
+    unwindFrames(profile, frame);
+
+    if (profile->frameCount == profile->frameCapacity) {
+        int capacity = profile->frameCapacity < 64 ? 64 : profile->frameCapacity * 2;
+        ProfiledFrame *frames = realloc(profile->frames, sizeof(ProfiledFrame) * capacity);
+
+        if (frames == NULL) {
+            return;
+        }
+
+        profile->frames = frames;
+        profile->frameCapacity = capacity;
+    }
+
+    int index = findFunction(profile, function);
+    if (index < 0) {
+        return;
+    }
+
+    profile->functions[index].calls++;
+    profile->functions[index].active++;
+    profile->frames[profile->frameCount++] = (ProfiledFrame) {frame, index, 0, 0};
+
+    // Read last so the profiler's own bookkeeping isn't part of the call
+    profile->frames[profile->frameCount - 1].start = monotonicNs();
+}
+
+void exitFunction(DictuVM *vm, int frame) {
+    uint64_t now = monotonicNs();
+    CallProfile *profile = vm->callProfile;
+
+    unwindFrames(profile, frame + 1);
+
+    // Frames entered before the profile started aren't timed
+    if (profile->frameCount == 0 || profile->frames[profile->frameCount - 1].frame != frame) {
+        return;
+    }
+
+    ProfiledFrame *profiled = &profile->frames[--profile->frameCount];
+    FunctionCalls *calls = &profile->functions[profiled->function];
+    uint64_t elapsed = now - profiled->start;
+
+    calls->exclusive += elapsed > profiled->children ? elapsed - profiled->children : 0;
+
+    if (--calls->active == 0) {
+        calls->inclusive += elapsed;
+    }
+
+    if (profile->frameCount > 0) {
+        profile->frames[profile->frameCount - 1].children += elapsed;
+    }
+}
+
+void retireCallProfile(DictuVM *vm) {
+    retireProfileKeys(&vm->callProfile->index);
+}
+
+static int compareFunctions(const void *a, const void *b) {
+    const FunctionCalls *left = a;
+    const FunctionCalls *right = b;
+
+    if (left->exclusive != right->exclusive) {
+        return (left->exclusive < right->exclusive) - (left->exclusive > right->exclusive);
+    }
+
+    return (left->calls < right->calls) - (left->calls > right->calls);
+}
+
+/**
+ * Returns a copy of the functions sorted by exclusive time, which the caller frees.
+ * Sorting them in place would break the function index of a profile still running.
+ */
+static FunctionCalls *sortedFunctions(CallProfile *profile, int *count) {
+    FunctionCalls *functions = malloc(sizeof(FunctionCalls) * (profile->index.count + 1));
+
+    if (functions == NULL) {
+        return NULL;
+    }
+
+    *count = profile->index.count;
+    memcpy(functions, profile->functions, sizeof(FunctionCalls) * profile->index.count);
+    qsort(functions, *count, sizeof(FunctionCalls), compareFunctions);
+
+    return functions;
+}
+
+Value callProfileToList(DictuVM *vm) {
+    CallProfile *profile = vm->callProfile;
+    int functionCount;
+    FunctionCalls *functions = profile == NULL ? NULL : sortedFunctions(profile, &functionCount);
+
+    if (functions == NULL) {
+        return NIL_VAL;
+    }
+
+    ObjList *list = initList(vm);
+    push(vm, OBJ_VAL(list));
+
+    for (int i = 0; i < functionCount; ++i) {
+        FunctionCalls *calls = &functions[i];
+        ObjDict *dict = initDict(vm);
+        push(vm, OBJ_VAL(dict));
+
+        setDictField(vm, dict, "function", OBJ_VAL(copyString(vm, calls->label, strlen(calls->label))));
+        setDictField(vm, dict, "calls", NUMBER_VAL((double) calls->calls));
+        setDictField(vm, dict, "inclusiveNs", NUMBER_VAL((double) calls->inclusive));
+        setDictField(vm, dict, "exclusiveNs", NUMBER_VAL((double) calls->exclusive));
+
+        writeValueArray(vm, &list->values, OBJ_VAL(dict));
+        pop(vm);
+    }
+
+    free(functions);
+    pop(vm);
+
+    return OBJ_VAL(list);
+}
+
+bool writeCallProfile(DictuVM *vm, FILE *file) {
+    CallProfile *profile = vm->callProfile;
+    int functionCount;
+    FunctionCalls *functions = profile == NULL ? NULL : sortedFunctions(profile, &functionCount);
+
+    if (functions == NULL) {
+        return false;
+    }
+
+    uint64_t total = 0;
+    for (int i = 0; i < functionCount; ++i) {
+        total += functions[i].exclusive;
+    }
+
+    // Per call time is exclusive, inclusive time only counts the outermost of recursive calls
+    fprintf(file, "%12s %14s %14s %7s %13s  %s\n", "calls", "inclusive ms", "exclusive ms", "excl %", "excl ns/call", "function");
+
+    for (int i = 0; i < functionCount; ++i) {
+        FunctionCalls *calls = &functions[i];
+
+        fprintf(file, "%12llu %14.3f %14.3f %6.2f%% %13.0f  %s\n", (unsigned long long) calls->calls,
+                calls->inclusive / 1e6, calls->exclusive / 1e6, total == 0 ? 0 : 100.0 * calls->exclusive / total,
+                calls->calls == 0 ? 0 : (double) calls->exclusive / calls->calls, calls->label);
+    }
+
+    free(functions);
+    return true;
+}
+
+static void writeJsonString(FILE *file, const char *string) {
+    fputc('"', file);
+
+    for (const unsigned char *c = (const unsigned char *) string; *c != '\0'; ++c) {
+        if (*c == '"' || *c == '\\') {
+            fprintf(file, "\\%c", *c);
+        } else if (*c < 0x20) {
+            fprintf(file, "\\u%04x", *c);
+        } else {
+            fputc(*c, file);
+        }
+    }
+
+    fputc('"', file);
+}
+
+bool writeCallProfileJson(DictuVM *vm, FILE *file) {
+    CallProfile *profile = vm->callProfile;
+    int functionCount;
+    FunctionCalls *functions = profile == NULL ? NULL : sortedFunctions(profile, &functionCount);
+
+    if (functions == NULL) {
+        return false;
+    }
+
+    fprintf(file, "[");
+
+    for (int i = 0; i < functionCount; ++i) {
+        FunctionCalls *calls = &functions[i];
+
+        fprintf(file, "%s\n  {\"function\": ", i > 0 ? "," : "");
+        writeJsonString(file, calls->label);
+        fprintf(file, ", \"calls\": %llu, \"inclusiveNs\": %llu, \"exclusiveNs\": %llu}",
+                (unsigned long long) calls->calls, (unsigned long long) calls->inclusive,
+                (unsigned long long) calls->exclusive);
+    }
+
+    fprintf(file, "\n]\n");
+
+    free(functions);
+    return true;
+}
+
+bool saveCallProfile(DictuVM *vm, const char *path) {
+    // Checked before opening so an existing file isn't truncated
+    if (vm->callProfile == NULL) {
+        return false;
+    }
+
+    size_t length = strlen(path);
+    bool json = length >= 5 && strcmp(path + length - 5, ".json") == 0;
+
+    FILE *file = fopen(path, "w");
+    bool written = file != NULL && (json ? writeCallProfileJson(vm, file) : writeCallProfile(vm, file));
+
+    if (file != NULL) {
+        written = fclose(file) == 0 && written;
+    }
+
+    return written;
+}
+
+void stopCallProfile(DictuVM *vm) {
+    CallProfile *profile = vm->callProfile;
+
+    if (profile == NULL) {
+        return;
+    }
+
+    freeProfileIndex(&profile->index);
+    free(profile->functions);
+    free(profile->frames);
+    free(profile);
+    vm->callProfile = NULL;
+}
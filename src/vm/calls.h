@@ -0,0 +1,42 @@
+#ifndef dictu_calls_h
+#define dictu_calls_h
+
+#include "object.h"
+
+/**
+ * Deterministic function profiler. While running, call() and OP_RETURN time every
+ * Dictu function, counting its calls along with its inclusive time (including the
+ * functions it calls) and exclusive time (its own). Time spent in natives is the
+ * exclusive time of the function that called them. A recursive function's inclusive
+ * time is only taken from its outermost call so it isn't counted more than once.
+ */
+
+typedef struct CallProfile CallProfile;
+
+// Returns false if a profile is already running or the profile can't be allocated
+bool startCallProfile(DictuVM *vm);
+
+// Called by call() while a profile is running, frame is the index of the frame being pushed
+void enterFunction(DictuVM *vm, ObjFunction *function, int frame);
+
+// Called by OP_RETURN while a profile is running, frame is the index of the frame being popped
+void exitFunction(DictuVM *vm, int frame);
+
+// Detaches functions the GC is about to free, must run after marking
+void retireCallProfile(DictuVM *vm);
+
+// Returns a list of {function, calls, inclusiveNs, exclusiveNs} sorted by exclusive time, or nil if none is running
+Value callProfileToList(DictuVM *vm);
+
+// Writes the same as a plain text table
+bool writeCallProfile(DictuVM *vm, FILE *file);
+
+// Writes the same as a JSON array
+bool writeCallProfileJson(DictuVM *vm, FILE *file);
+
+// Writes the profile to path, as JSON if the path ends in ".json" and as a table otherwise
+bool saveCallProfile(DictuVM *vm, const char *path);
+
+void stopCallProfile(DictuVM *vm);
+
+#endif //dictu_calls_h
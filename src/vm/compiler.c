@@ -2277,12 +2277,12 @@ ObjFunction *compile(DictuVM *vm, ObjModule *module, const char *source) {
     return parser.hadError ? NULL : function;
 }
 
-void grayCompilerRoots(DictuVM *vm) {
+void visitCompilerRoots(DictuVM *vm, VisitFn visit, void *context) {
     Compiler *compiler = vm->compiler;
 
     while (compiler != NULL) {
-        grayObject(vm, (Obj *) compiler->function);
-        grayTable(vm, &compiler->stringConstants);
+        visitObject((Obj *) compiler->function, visit, context);
+        visitTable(&compiler->stringConstants, visit, context);
         compiler = compiler->enclosing;
     }
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include <math.h>
 
+#include "memory.h"
 #include "object.h"
 #include "scanner.h"
 
@@ -109,6 +110,6 @@ typedef struct {
 
 ObjFunction *compile(DictuVM *vm, ObjModule *module, const char *source);
 
-void grayCompilerRoots(DictuVM *vm);
+void visitCompilerRoots(DictuVM *vm, VisitFn visit, void *context);
 
 #endif
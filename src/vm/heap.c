@@ -0,0 +1,519 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "heap.h"
+#include "memory.h"
+#include "util.h"
+#include "vm.h"
+
+// Strings longer than this are cut short in a snapshot's names
+#define SNAPSHOT_NAME_MAX 64
+
+static size_t tableSize(Table *table) {
+    return table->entries == NULL ? 0 : sizeof(Entry) * (table->capacityMask + 1);
+}
+
+size_t objectSize(Obj *object) {
+    switch (object->type) {
+        case OBJ_MODULE:
+            return sizeof(ObjModule) + tableSize(&((ObjModule *) object)->values);
+
+        case OBJ_BOUND_METHOD:
+            return sizeof(ObjBoundMethod);
+
+        case OBJ_CLASS: {
+            ObjClass *klass = (ObjClass *) object;
+            return sizeof(ObjClass) + tableSize(&klass->methods) + tableSize(&klass->abstractMethods) +
+                   tableSize(&klass->properties);
+        }
+
+        case OBJ_CLOSURE:
+            return sizeof(ObjClosure) + sizeof(ObjUpvalue *) * ((ObjClosure *) object)->upvalueCount;
+
+        case OBJ_FUNCTION: {
+            ObjFunction *function = (ObjFunction *) object;
+            size_t size = sizeof(ObjFunction) + (sizeof(uint8_t) + sizeof(int)) * function->chunk.capacity +
+                          sizeof(Value) * function->chunk.constants.capacity;
+
+            if (function->type == TYPE_INITIALIZER) {
+                size += sizeof(int) * 2 * function->propertyCount;
+            }
+
+            return size;
+        }
+
+        case OBJ_INSTANCE:
+            return sizeof(ObjInstance) + tableSize(&((ObjInstance *) object)->fields);
+
+        case OBJ_NATIVE:
+            return sizeof(ObjNative);
+
+        case OBJ_STRING:
+            return sizeof(ObjString) + ((ObjString *) object)->length + 1;
+
+        case OBJ_LIST:
+            return sizeof(ObjList) + sizeof(Value) * ((ObjList *) object)->values.capacity;
+
+        case OBJ_DICT: {
+            ObjDict *dict = (ObjDict *) object;
+            return sizeof(ObjDict) + (dict->entries == NULL ? 0 : sizeof(DictItem) * (dict->capacityMask + 1));
+        }
+
+        case OBJ_SET: {
+            ObjSet *set = (ObjSet *) object;
+            return sizeof(ObjSet) + (set->entries == NULL ? 0 : sizeof(SetItem) * (set->capacityMask + 1));
+        }
+
+        case OBJ_FILE:
+            return sizeof(ObjFile);
+
+        case OBJ_ABSTRACT:
+            return sizeof(ObjAbstract) + tableSize(&((ObjAbstract *) object)->values);
+
+        case OBJ_UPVALUE:
+            return sizeof(ObjUpvalue);
+    }
+
+    return 0;
+}
+
+static void visitArray(ValueArray *array, VisitFn visit, void *context) {
+    for (int i = 0; i < array->count; i++) {
+        visitValue(array->values[i], visit, context);
+    }
+}
+
+// The references blackenObject follows
+static void visitReferences(Obj *object, VisitFn visit, void *context) {
+    switch (object->type) {
+        case OBJ_MODULE: {
+            ObjModule *module = (ObjModule *) object;
+            visitObject((Obj *) module->name, visit, context);
+            visitObject((Obj *) module->path, visit, context);
+            visitTable(&module->values, visit, context);
+            break;
+        }
+
+        case OBJ_BOUND_METHOD: {
+            ObjBoundMethod *bound = (ObjBoundMethod *) object;
+            visitValue(bound->receiver, visit, context);
+            visitObject((Obj *) bound->method, visit, context);
+            break;
+        }
+
+        case OBJ_CLASS: {
+            ObjClass *klass = (ObjClass *) object;
+            visitObject((Obj *) klass->name, visit, context);
+            visitObject((Obj *) klass->superclass, visit, context);
+            visitTable(&klass->methods, visit, context);
+            visitTable(&klass->abstractMethods, visit, context);
+            visitTable(&klass->properties, visit, context);
+            break;
+        }
+
+        case OBJ_CLOSURE: {
+            ObjClosure *closure = (ObjClosure *) object;
+            visitObject((Obj *) closure->function, visit, context);
+            for (int i = 0; i < closure->upvalueCount; i++) {
+                visitObject((Obj *) closure->upvalues[i], visit, context);
+            }
+            break;
+        }
+
+        case OBJ_FUNCTION: {
+            ObjFunction *function = (ObjFunction *) object;
+            visitObject((Obj *) function->name, visit, context);
+            visitArray(&function->chunk.constants, visit, context);
+            break;
+        }
+
+        case OBJ_INSTANCE: {
+            ObjInstance *instance = (ObjInstance *) object;
+            visitObject((Obj *) instance->klass, visit, context);
+            visitTable(&instance->fields, visit, context);
+            break;
+        }
+
+        case OBJ_UPVALUE:
+            visitValue(((ObjUpvalue *) object)->closed, visit, context);
+            break;
+
+        case OBJ_LIST:
+            visitArray(&((ObjList *) object)->values, visit, context);
+            break;
+
+        case OBJ_DICT: {
+            ObjDict *dict = (ObjDict *) object;
+            for (int i = 0; i <= dict->capacityMask; i++) {
+                visitValue(dict->entries[i].key, visit, context);
+                visitValue(dict->entries[i].value, visit, context);
+            }
+            break;
+        }
+
+        case OBJ_SET: {
+            ObjSet *set = (ObjSet *) object;
+            for (int i = 0; i <= set->capacityMask; i++) {
+                visitValue(set->entries[i].value, visit, context);
+            }
+            break;
+        }
+
+        case OBJ_ABSTRACT:
+            visitTable(&((ObjAbstract *) object)->values, visit, context);
+            break;
+
+        case OBJ_NATIVE:
+        case OBJ_STRING:
+        case OBJ_FILE:
+            break;
+    }
+}
+
+typedef struct {
+    // Objects in the order they were found, node n is nodes[n - 1]
+    Obj **nodes;
+    size_t nodeCount;
+    size_t nodeCapacity;
+    // Open addressing from an object to its node number
+    Obj **keys;
+    size_t *ids;
+    size_t slotCount;
+    // Edges of the node being written
+    size_t *edges;
+    size_t edgeCount;
+    size_t edgeCapacity;
+    bool failed;
+} Snapshot;
+
+static bool growSlots(Snapshot *snapshot) {
+    size_t slotCount = snapshot->slotCount < 1024 ? 1024 : snapshot->slotCount * 2;
+    Obj **keys = calloc(slotCount, sizeof(Obj *));
+    size_t *ids = malloc(sizeof(size_t) * slotCount);
+
+    if (keys == NULL || ids == NULL) {
+        free(keys);
+        free(ids);
+        return false;
+    }
+
+    for (size_t i = 0; i < snapshot->slotCount; ++i) {
+        if (snapshot->keys[i] == NULL) {
+            continue;
+        }
+
+        size_t slot = hashPointer(snapshot->keys[i]) & (slotCount - 1);
+        while (keys[slot] != NULL) {
+            slot = (slot + 1) & (slotCount - 1);
+        }
+
+        keys[slot] = snapshot->keys[i];
+        ids[slot] = snapshot->ids[i];
+    }
+
+    free(snapshot->keys);
+    free(snapshot->ids);
+    snapshot->keys = keys;
+    snapshot->ids = ids;
+    snapshot->slotCount = slotCount;
+
+    return true;
+}
+
+// Returns the object's node number, numbering and queueing it the first time it is seen
+static size_t nodeId(Snapshot *snapshot, Obj *object) {
+    if ((snapshot->nodeCount + 1) * 2 > snapshot->slotCount && !growSlots(snapshot)) {
+        snapshot->failed = true;
+        return 0;
+    }
+
+    size_t slot = hashPointer(object) & (snapshot->slotCount - 1);
+
+    while (snapshot->keys[slot] != NULL) {
+        if (snapshot->keys[slot] == object) {
+            return snapshot->ids[slot];
+        }
+
+        slot = (slot + 1) & (snapshot->slotCount - 1);
+    }
+
+    if (snapshot->nodeCount == snapshot->nodeCapacity) {
+        size_t capacity = snapshot->nodeCapacity < 1024 ? 1024 : snapshot->nodeCapacity * 2;
+        Obj **nodes = realloc(snapshot->nodes, sizeof(Obj *) * capacity);
+
+        if (nodes == NULL) {
+            snapshot->failed = true;
+            return 0;
+        }
+
+        snapshot->nodes = nodes;
+        snapshot->nodeCapacity = capacity;
+    }
+
+    snapshot->nodes[snapshot->nodeCount++] = object;
+    snapshot->keys[slot] = object;
+    snapshot->ids[slot] = snapshot->nodeCount;
+
+    return snapshot->nodeCount;
+}
+
+static void addEdge(void *context, Obj *object) {
+    Snapshot *snapshot = context;
+    size_t id = nodeId(snapshot, object);
+
+    if (snapshot->failed) {
+        return;
+    }
+
+    if (snapshot->edgeCount == snapshot->edgeCapacity) {
+        size_t capacity = snapshot->edgeCapacity < 64 ? 64 : snapshot->edgeCapacity * 2;
+        size_t *edges = realloc(snapshot->edges, sizeof(size_t) * capacity);
+
+        if (edges == NULL) {
+            snapshot->failed = true;
+            return;
+        }
+
+        snapshot->edges = edges;
+        snapshot->edgeCapacity = capacity;
+    }
+
+    snapshot->edges[snapshot->edgeCount++] = id;
+}
+
+static void writeEscaped(FILE *file, const char *chars, int length) {
+    for (int i = 0; i < length && i < SNAPSHOT_NAME_MAX; ++i) {
+        switch (chars[i]) {
+            case '\t': fputs("\\t", file); break;
+            case '\n': fputs("\\n", file); break;
+            case '\r': fputs("\\r", file); break;
+            case '\\': fputs("\\\\", file); break;
+            default: fputc(chars[i], file);
+        }
+    }
+
+    if (length > SNAPSHOT_NAME_MAX) {
+        fputs("...", file);
+    }
+}
+
+static void writeName(FILE *file, Obj *object) {
+    ObjString *name = NULL;
+
+    switch (object->type) {
+        case OBJ_STRING: {
+            ObjString *string = (ObjString *) object;
+            writeEscaped(file, string->chars, string->length);
+            return;
+        }
+
+        case OBJ_MODULE:
+            name = ((ObjModule *) object)->name;
+            break;
+
+        case OBJ_CLASS:
+            name = ((ObjClass *) object)->name;
+            break;
+
+        case OBJ_INSTANCE:
+            name = ((ObjInstance *) object)->klass->name;
+            break;
+
+        case OBJ_FUNCTION:
+            name = ((ObjFunction *) object)->name;
+            break;
+
+        case OBJ_CLOSURE:
+            name = ((ObjClosure *) object)->function->name;
+            break;
+
+        case OBJ_BOUND_METHOD:
+            name = ((ObjBoundMethod *) object)->method->function->name;
+            break;
+
+        default:
+            return;
+    }
+
+    if (name == NULL) {
+        fputs(object->type == OBJ_FUNCTION || object->type == OBJ_CLOSURE ? "<script>" : "", file);
+    } else {
+        writeEscaped(file, name->chars, name->length);
+    }
+}
+
+static void writeEdges(Snapshot *snapshot, FILE *file) {
+    for (size_t i = 0; i < snapshot->edgeCount; ++i) {
+        fprintf(file, i == 0 ? "%zu" : " %zu", snapshot->edges[i]);
+    }
+
+    fputc('\n', file);
+}
+
+bool writeHeapSnapshot(DictuVM *vm, FILE *file) {
+    Snapshot snapshot;
+    memset(&snapshot, 0, sizeof(snapshot));
+
+    fprintf(file, "dictu-heap-snapshot 1\n");
+
+    visitRoots(vm, addEdge, &snapshot);
+    fprintf(file, "roots\t0\t\t");
+    writeEdges(&snapshot, file);
+
+    // Nodes are numbered as they are found so writing them in order is a breadth first walk
+    for (size_t i = 0; i < snapshot.nodeCount && !snapshot.failed; ++i) {
+        Obj *object = snapshot.nodes[i];
+
+        snapshot.edgeCount = 0;
+        visitReferences(object, addEdge, &snapshot);
+
+        fprintf(file, "%s\t%zu\t", objectTypeName(object->type), objectSize(object));
+        writeName(file, object);
+        fputc('\t', file);
+        writeEdges(&snapshot, file);
+    }
+
+    free(snapshot.nodes);
+    free(snapshot.keys);
+    free(snapshot.ids);
+    free(snapshot.edges);
+
+    return !snapshot.failed && !ferror(file);
+}
+
+typedef struct {
+    ObjClass *klass;
+    size_t count;
+    size_t bytes;
+} ClassCount;
+
+static ObjDict *newCount(DictuVM *vm, size_t count, size_t bytes) {
+    ObjDict *dict = initDict(vm);
+    push(vm, OBJ_VAL(dict));
+    setDictField(vm, dict, "count", NUMBER_VAL(count));
+    setDictField(vm, dict, "bytes", NUMBER_VAL(bytes));
+    pop(vm);
+    return dict;
+}
+
+// Adds to the counts under key, classes from different modules can share a name
+static void addCount(DictuVM *vm, ObjDict *dict, Value key, size_t count, size_t bytes) {
+    push(vm, key);
+
+    Value existing;
+    if (dictGet(dict, key, &existing)) {
+        Value value;
+
+        dictGet(AS_DICT(existing), OBJ_VAL(copyString(vm, "count", 5)), &value);
+        count += AS_NUMBER(value);
+        dictGet(AS_DICT(existing), OBJ_VAL(copyString(vm, "bytes", 5)), &value);
+        bytes += AS_NUMBER(value);
+    }
+
+    ObjDict *counts = newCount(vm, count, bytes);
+    push(vm, OBJ_VAL(counts));
+    dictSet(vm, dict, key, OBJ_VAL(counts));
+    pop(vm);
+    pop(vm);
+}
+
+Value heapCensus(DictuVM *vm) {
+    collectGarbage(vm);
+
+    size_t typeCounts[OBJ_UPVALUE + 1] = {0};
+    size_t typeBytes[OBJ_UPVALUE + 1] = {0};
+    size_t classSlots = 64;
+    size_t classCount = 0;
+    ClassCount *classes = calloc(classSlots, sizeof(ClassCount));
+
+    for (Obj *object = vm->objects; object != NULL; object = object->next) {
+        size_t size = objectSize(object);
+        typeCounts[object->type]++;
+        typeBytes[object->type] += size;
+
+        if (object->type != OBJ_INSTANCE || classes == NULL) {
+            continue;
+        }
+
+        if ((classCount + 1) * 2 > classSlots) {
+            ClassCount *grown = calloc(classSlots * 2, sizeof(ClassCount));
+
+            if (grown == NULL) {
+                free(classes);
+                classes = NULL;
+                continue;
+            }
+
+            for (size_t i = 0; i < classSlots; ++i) {
+                if (classes[i].klass == NULL) {
+                    continue;
+                }
+
+                size_t slot = hashPointer(classes[i].klass) & (classSlots * 2 - 1);
+                while (grown[slot].klass != NULL) {
+                    slot = (slot + 1) & (classSlots * 2 - 1);
+                }
+
+                grown[slot] = classes[i];
+            }
+
+            free(classes);
+            classes = grown;
+            classSlots *= 2;
+        }
+
+        ObjClass *klass = ((ObjInstance *) object)->klass;
+        size_t slot = hashPointer(klass) & (classSlots - 1);
+
+        while (classes[slot].klass != NULL && classes[slot].klass != klass) {
+            slot = (slot + 1) & (classSlots - 1);
+        }
+
+        if (classes[slot].klass == NULL) {
+            classes[slot].klass = klass;
+            classCount++;
+        }
+
+        classes[slot].count++;
+        classes[slot].bytes += size;
+    }
+
+    ObjDict *result = initDict(vm);
+    push(vm, OBJ_VAL(result));
+
+    ObjDict *types = initDict(vm);
+    push(vm, OBJ_VAL(types));
+
+    for (int type = 0; type <= OBJ_UPVALUE; ++type) {
+        if (typeCounts[type] > 0) {
+            const char *name = objectTypeName(type);
+            addCount(vm, types, OBJ_VAL(copyString(vm, name, strlen(name))), typeCounts[type], typeBytes[type]);
+        }
+    }
+
+    ObjDict *classNames = initDict(vm);
+    push(vm, OBJ_VAL(classNames));
+
+    for (size_t i = 0; classes != NULL && i < classSlots; ++i) {
+        if (classes[i].klass != NULL) {
+            addCount(vm, classNames, OBJ_VAL(classes[i].klass->name), classes[i].count, classes[i].bytes);
+        }
+    }
+
+    free(classes);
+
+    Value key = OBJ_VAL(copyString(vm, "classes", 7));
+    push(vm, key);
+    dictSet(vm, result, key, OBJ_VAL(classNames));
+    pop(vm);
+    pop(vm);
+
+    key = OBJ_VAL(copyString(vm, "types", 5));
+    push(vm, key);
+    dictSet(vm, result, key, OBJ_VAL(types));
+    pop(vm);
+    pop(vm);
+
+    pop(vm);
+    return OBJ_VAL(result);
+}
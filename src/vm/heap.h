@@ -0,0 +1,27 @@
+#ifndef dictu_heap_h
+#define dictu_heap_h
+
+#include "object.h"
+
+/**
+ * Heap introspection. A snapshot is a tab separated text file whose first line is
+ * "dictu-heap-snapshot 1". Every following line is a node, numbered from 0 in file
+ * order, written as
+ *
+ *     type <TAB> size <TAB> name <TAB> edges
+ *
+ * where edges are the space separated numbers of the nodes it references and name
+ * has tabs, newlines and backslashes escaped. Node 0 is the synthetic "roots" node
+ * referencing everything the garbage collector treats as a root, every other node
+ * is an object reachable from it. `dictu --heap` reads these files.
+ */
+
+// Bytes owned by the object, its struct plus any arrays and tables it holds
+size_t objectSize(Obj *object);
+
+bool writeHeapSnapshot(DictuVM *vm, FILE *file);
+
+// Returns {"types": {type: {"count", "bytes"}}, "classes": {name: {"count", "bytes"}}} for objects that survive a collection
+Value heapCensus(DictuVM *vm);
+
+#endif //dictu_heap_h
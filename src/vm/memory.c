@@ -4,6 +4,7 @@
 #include "compiler.h"
 #include "memory.h"
 #include "vm.h"
+#include "profiler.h"
 
 #ifdef DEBUG_TRACE_GC
 #include <stdio.h>
@@ -170,6 +171,10 @@ void freeObject(DictuVM *vm, Obj *object) {
     printf("%p free type %d\n", (void*)object, object->type);
 #endif
 
+    if (object->isSampled) {
+        forgetAllocation(vm, object);
+    }
+
     switch (object->type) {
         case OBJ_MODULE: {
             ObjModule *module = (ObjModule *) object;
@@ -270,45 +275,73 @@ void freeObject(DictuVM *vm, Obj *object) {
     }
 }
 
-void collectGarbage(DictuVM *vm) {
-#ifdef DEBUG_TRACE_GC
-    printf("-- gc begin\n");
-    size_t before = vm->bytesAllocated;
-#endif
+void visitValue(Value value, VisitFn visit, void *context) {
+    if (IS_OBJ(value)) {
+        visit(context, AS_OBJ(value));
+    }
+}
 
-    // Mark the stack roots.
+void visitObject(Obj *object, VisitFn visit, void *context) {
+    if (object != NULL) {
+        visit(context, object);
+    }
+}
+
+void visitTable(Table *table, VisitFn visit, void *context) {
+    for (int i = 0; i <= table->capacityMask; i++) {
+        visitObject((Obj *) table->entries[i].key, visit, context);
+        visitValue(table->entries[i].value, visit, context);
+    }
+}
+
+void visitRoots(DictuVM *vm, VisitFn visit, void *context) {
+    // The stack roots.
     for (Value *slot = vm->stack; slot < vm->stackTop; slot++) {
-        grayValue(vm, *slot);
+        visitValue(*slot, visit, context);
     }
 
     for (int i = 0; i < vm->frameCount; i++) {
-        grayObject(vm, (Obj *) vm->frames[i].closure);
+        visitObject((Obj *) vm->frames[i].closure, visit, context);
+    }
+
+    // The open upvalues.
+    for (ObjUpvalue *upvalue = vm->openUpvalues; upvalue != NULL; upvalue = upvalue->next) {
+        visitObject((Obj *) upvalue, visit, context);
     }
 
-    // Mark the open upvalues.
-    for (ObjUpvalue *upvalue = vm->openUpvalues;
-         upvalue != NULL;
-         upvalue = upvalue->next) {
-        grayObject(vm, (Obj *) upvalue);
+    // The global roots.
+    Table *tables[] = {
+        &vm->modules, &vm->globals, &vm->numberMethods, &vm->boolMethods, &vm->nilMethods,
+        &vm->stringMethods, &vm->listMethods, &vm->dictMethods, &vm->setMethods, &vm->fileMethods,
+        &vm->classMethods, &vm->instanceMethods, &vm->socketMethods
+    };
+
+    for (size_t i = 0; i < sizeof(tables) / sizeof(tables[0]); i++) {
+        visitTable(tables[i], visit, context);
     }
 
-    // Mark the global roots.
-    grayTable(vm, &vm->modules);
-    grayTable(vm, &vm->globals);
-    grayTable(vm, &vm->numberMethods);
-    grayTable(vm, &vm->boolMethods);
-    grayTable(vm, &vm->nilMethods);
-    grayTable(vm, &vm->stringMethods);
-    grayTable(vm, &vm->listMethods);
-    grayTable(vm, &vm->dictMethods);
-    grayTable(vm, &vm->setMethods);
-    grayTable(vm, &vm->fileMethods);
-    grayTable(vm, &vm->classMethods);
-    grayTable(vm, &vm->instanceMethods);
-    grayTable(vm, &vm->socketMethods);
-    grayCompilerRoots(vm);
-    grayObject(vm, (Obj *) vm->initString);
-    grayObject(vm, (Obj *) vm->replVar);
+    visitCompilerRoots(vm, visit, context);
+    visitObject((Obj *) vm->initString, visit, context);
+    visitObject((Obj *) vm->replVar, visit, context);
+}
+
+static void grayRoot(void *context, Obj *object) {
+    grayObject((DictuVM *) context, object);
+}
+
+void collectGarbage(DictuVM *vm) {
+    vm->gcCount++;
+
+    // Samples refer to functions by pointer, resolve them while they are all still alive
+    drainProfiler(vm);
+
+#ifdef DEBUG_TRACE_GC
+    printf("-- gc begin\n");
+    size_t before = vm->bytesAllocated;
+#endif
+
+    // Mark the roots.
+    visitRoots(vm, grayRoot, vm);
 
     // Traverse the references.
     while (vm->grayCount > 0) {
@@ -317,6 +350,19 @@ void collectGarbage(DictuVM *vm) {
         blackenObject(vm, object);
     }
 
+#ifdef DEBUG_OPCODE_STATS
+    // Function names and modules may be swept first, label the counts while they are intact
+    foldOpcodeStats(vm);
+#endif
+
+    if (vm->allocationProfile != NULL) {
+        retireAllocationSites(vm);
+    }
+
+    if (vm->callProfile != NULL) {
+        retireCallProfile(vm);
+    }
+
     // Delete unused interned strings.
     tableRemoveWhite(vm, &vm->strings);
 
@@ -33,6 +33,18 @@ void grayObject(DictuVM *vm, Obj *object);
 
 void grayValue(DictuVM *vm, Value value);
 
+// Called with each object a walk of the heap reaches
+typedef void (*VisitFn)(void *context, Obj *object);
+
+void visitValue(Value value, VisitFn visit, void *context);
+
+void visitObject(Obj *object, VisitFn visit, void *context);
+
+void visitTable(Table *table, VisitFn visit, void *context);
+
+// Visits the roots, which the GC marks from and heap snapshots start at
+void visitRoots(DictuVM *vm, VisitFn visit, void *context);
+
 void collectGarbage(DictuVM *vm);
 
 void freeObjects(DictuVM *vm);
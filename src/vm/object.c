@@ -16,9 +16,14 @@ static Obj *allocateObject(DictuVM *vm, size_t size, ObjType type) {
     object = (Obj *) reallocate(vm, NULL, 0, size);
     object->type = type;
     object->isDark = false;
+    object->isSampled = false;
     object->next = vm->objects;
     vm->objects = object;
 
+    if (vm->allocationProfile != NULL) {
+        recordAllocation(vm, object, size);
+    }
+
 #ifdef DEBUG_TRACE_GC
     printf("%p allocate %zd for %d\n", (void *)object, size, type);
 #endif
@@ -94,6 +99,9 @@ ObjFunction *newFunction(DictuVM *vm, ObjModule *module, FunctionType type) {
     function->name = NULL;
     function->type = type;
     function->module = module;
+#ifdef DEBUG_OPCODE_STATS
+    function->instructionCount = 0;
+#endif
     initChunk(vm, &function->chunk);
 
     return function;
@@ -147,7 +155,9 @@ ObjSet *initSet(DictuVM *vm) {
 }
 
 ObjFile *initFile(DictuVM *vm) {
-    return ALLOCATE_OBJ(vm, ObjFile, OBJ_FILE);
+    ObjFile *file = ALLOCATE_OBJ(vm, ObjFile, OBJ_FILE);
+    file->isOpen = false;
+    return file;
 }
 
 ObjAbstract *initAbstract(DictuVM *vm, AbstractFreeFn func) {
@@ -205,6 +215,27 @@ ObjUpvalue *newUpvalue(DictuVM *vm, Value *slot) {
     return upvalue;
 }
 
+const char *objectTypeName(ObjType type) {
+    static const char *names[] = {
+        [OBJ_MODULE] = "module",
+        [OBJ_BOUND_METHOD] = "bound method",
+        [OBJ_CLASS] = "class",
+        [OBJ_CLOSURE] = "closure",
+        [OBJ_FUNCTION] = "function",
+        [OBJ_INSTANCE] = "instance",
+        [OBJ_NATIVE] = "native",
+        [OBJ_STRING] = "string",
+        [OBJ_LIST] = "list",
+        [OBJ_DICT] = "dict",
+        [OBJ_SET] = "set",
+        [OBJ_FILE] = "file",
+        [OBJ_ABSTRACT] = "abstract",
+        [OBJ_UPVALUE] = "upvalue",
+    };
+
+    return names[type];
+}
+
 char *listToString(Value value) {
     int size = 50;
     ObjList *list = AS_LIST(value);
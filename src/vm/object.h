@@ -79,6 +79,8 @@ typedef enum {
 struct sObj {
     ObjType type;
     bool isDark;
+    // Tracked by the allocation profiler
+    bool isSampled;
     struct sObj *next;
 };
 
@@ -101,6 +103,9 @@ typedef struct {
     int propertyCount;
     int *propertyNames;
     int *propertyIndexes;
+#ifdef DEBUG_OPCODE_STATS
+    uint64_t instructionCount;
+#endif
 } ObjFunction;
 
 typedef Value (*NativeFn)(DictuVM *vm, int argCount, Value *args);
@@ -152,6 +157,8 @@ struct sObjFile {
     FILE *file;
     char *path;
     char *openType;
+    // Cleared when the with block closes the file
+    bool isOpen;
 };
 
 typedef void (*AbstractFreeFn)(DictuVM *vm, ObjAbstract *abstract);
@@ -239,6 +246,9 @@ ObjAbstract *initAbstract(DictuVM *vm, AbstractFreeFn func);
 
 ObjUpvalue *newUpvalue(DictuVM *vm, Value *slot);
 
+// Lowercase name of the object type, as used in profiles and heap snapshots
+const char *objectTypeName(ObjType type);
+
 char *setToString(Value value);
 char *dictToString(Value value);
 char *listToString(Value value);
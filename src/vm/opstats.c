@@ -0,0 +1,258 @@
+#include "opstats.h"
+
+#ifdef DEBUG_OPCODE_STATS
+#include <stdlib.h>
+#include <string.h>
+
+#include "util.h"
+#include "vm.h"
+
+// Pairs beyond this are left out of the text report, the dictionary has them all
+#define REPORT_MAX_PAIRS 50
+
+static const char *opcodeNames[] = {
+    #define OPCODE(name) #name,
+    #include "opcodes.h"
+    #undef OPCODE
+};
+
+OpcodeStats *newOpcodeStats(void) {
+    return calloc(1, sizeof(OpcodeStats));
+}
+
+void freeOpcodeStats(OpcodeStats *stats) {
+    if (stats == NULL) {
+        return;
+    }
+
+    for (int i = 0; i < stats->functionCount; ++i) {
+        free(stats->functions[i].label);
+    }
+
+    free(stats->functions);
+    free(stats);
+}
+
+static void appendFunction(FunctionCount **functions, int *count, int *capacity, char *label, uint64_t instructions) {
+    if (label == NULL) {
+        return;
+    }
+
+    if (*count == *capacity) {
+        int newCapacity = *capacity < 8 ? 8 : *capacity * 2;
+        FunctionCount *grown = realloc(*functions, sizeof(FunctionCount) * newCapacity);
+
+        if (grown == NULL) {
+            free(label);
+            return;
+        }
+
+        *functions = grown;
+        *capacity = newCapacity;
+    }
+
+    (*functions)[(*count)++] = (FunctionCount) {label, instructions};
+}
+
+void foldOpcodeStats(DictuVM *vm) {
+    OpcodeStats *stats = vm->opcodeStats;
+
+    for (Obj *object = vm->objects; object != NULL; object = object->next) {
+        if (object->isDark || object->type != OBJ_FUNCTION) {
+            continue;
+        }
+
+        ObjFunction *function = (ObjFunction *) object;
+        if (function->instructionCount > 0) {
+            appendFunction(&stats->functions, &stats->functionCount, &stats->functionCapacity,
+                           functionLabel(function, 0), function->instructionCount);
+        }
+    }
+}
+
+static int compareLabels(const void *a, const void *b) {
+    return strcmp(((const FunctionCount *) a)->label, ((const FunctionCount *) b)->label);
+}
+
+static int compareCounts(const void *a, const void *b) {
+    uint64_t left = ((const FunctionCount *) a)->count;
+    uint64_t right = ((const FunctionCount *) b)->count;
+
+    return (left < right) - (left > right);
+}
+
+/**
+ * Freed and live functions sharing a label (a module compiled twice, say) are
+ * merged. Returns the merged counts, most executed first, which the caller frees
+ * with freeFunctionCounts.
+ */
+static FunctionCount *collectFunctions(DictuVM *vm, int *count) {
+    OpcodeStats *stats = vm->opcodeStats;
+    FunctionCount *functions = NULL;
+    int capacity = 0;
+    *count = 0;
+
+    for (int i = 0; i < stats->functionCount; ++i) {
+        appendFunction(&functions, count, &capacity, strdup(stats->functions[i].label), stats->functions[i].count);
+    }
+
+    for (Obj *object = vm->objects; object != NULL; object = object->next) {
+        if (object->type != OBJ_FUNCTION) {
+            continue;
+        }
+
+        ObjFunction *function = (ObjFunction *) object;
+        if (function->instructionCount > 0) {
+            appendFunction(&functions, count, &capacity, functionLabel(function, 0), function->instructionCount);
+        }
+    }
+
+    if (*count == 0) {
+        return functions;
+    }
+
+    qsort(functions, *count, sizeof(FunctionCount), compareLabels);
+
+    int merged = 0;
+    for (int i = 1; i < *count; ++i) {
+        if (strcmp(functions[merged].label, functions[i].label) == 0) {
+            functions[merged].count += functions[i].count;
+            free(functions[i].label);
+        } else {
+            functions[++merged] = functions[i];
+        }
+    }
+
+    *count = merged + 1;
+    qsort(functions, *count, sizeof(FunctionCount), compareCounts);
+
+    return functions;
+}
+
+static void freeFunctionCounts(FunctionCount *functions, int count) {
+    for (int i = 0; i < count; ++i) {
+        free(functions[i].label);
+    }
+
+    free(functions);
+}
+
+typedef struct {
+    uint8_t previous;
+    uint8_t current;
+    uint64_t count;
+} PairCount;
+
+static int comparePairs(const void *a, const void *b) {
+    uint64_t left = ((const PairCount *) a)->count;
+    uint64_t right = ((const PairCount *) b)->count;
+
+    return (left < right) - (left > right);
+}
+
+void writeOpcodeStats(DictuVM *vm, FILE *file) {
+    OpcodeStats *stats = vm->opcodeStats;
+    uint64_t total = 0;
+
+    // Sorted as pairs of an opcode with itself to share comparePairs
+    PairCount opcodes[OPCODE_COUNT];
+    for (int i = 0; i < OPCODE_COUNT; ++i) {
+        opcodes[i] = (PairCount) {i, i, stats->opcodes[i]};
+        total += stats->opcodes[i];
+    }
+
+    qsort(opcodes, OPCODE_COUNT, sizeof(PairCount), comparePairs);
+
+    fprintf(file, "Opcodes (%llu instructions)\n", (unsigned long long) total);
+    for (int i = 0; i < OPCODE_COUNT && opcodes[i].count > 0; ++i) {
+        fprintf(file, "%16llu %6.2f%%  %s\n", (unsigned long long) opcodes[i].count,
+                100.0 * opcodes[i].count / total, opcodeNames[opcodes[i].current]);
+    }
+
+    PairCount *pairs = malloc(sizeof(PairCount) * OPCODE_COUNT * OPCODE_COUNT);
+    if (pairs != NULL) {
+        int pairCount = 0;
+
+        for (int previous = 0; previous < OPCODE_COUNT; ++previous) {
+            for (int current = 0; current < OPCODE_COUNT; ++current) {
+                if (stats->pairs[previous][current] > 0) {
+                    pairs[pairCount++] = (PairCount) {previous, current, stats->pairs[previous][current]};
+                }
+            }
+        }
+
+        qsort(pairs, pairCount, sizeof(PairCount), comparePairs);
+
+        fprintf(file, "\nOpcode pairs (top %d of %d)\n", pairCount < REPORT_MAX_PAIRS ? pairCount : REPORT_MAX_PAIRS,
+                pairCount);
+        for (int i = 0; i < pairCount && i < REPORT_MAX_PAIRS; ++i) {
+            fprintf(file, "%16llu %6.2f%%  %s -> %s\n", (unsigned long long) pairs[i].count,
+                    100.0 * pairs[i].count / total, opcodeNames[pairs[i].previous], opcodeNames[pairs[i].current]);
+        }
+
+        free(pairs);
+    }
+
+    int functionCount;
+    FunctionCount *functions = collectFunctions(vm, &functionCount);
+
+    fprintf(file, "\nFunctions\n");
+    for (int i = 0; i < functionCount; ++i) {
+        fprintf(file, "%16llu %6.2f%%  %s\n", (unsigned long long) functions[i].count,
+                100.0 * functions[i].count / total, functions[i].label);
+    }
+
+    freeFunctionCounts(functions, functionCount);
+}
+
+Value opcodeStatsToDict(DictuVM *vm) {
+    OpcodeStats *stats = vm->opcodeStats;
+
+    ObjDict *result = initDict(vm);
+    push(vm, OBJ_VAL(result));
+
+    ObjDict *opcodes = initDict(vm);
+    push(vm, OBJ_VAL(opcodes));
+    setDictField(vm, result, "opcodes", OBJ_VAL(opcodes));
+    pop(vm);
+
+    ObjDict *pairs = initDict(vm);
+    push(vm, OBJ_VAL(pairs));
+    setDictField(vm, result, "pairs", OBJ_VAL(pairs));
+    pop(vm);
+
+    ObjDict *functions = initDict(vm);
+    push(vm, OBJ_VAL(functions));
+    setDictField(vm, result, "functions", OBJ_VAL(functions));
+    pop(vm);
+
+    for (int i = 0; i < OPCODE_COUNT; ++i) {
+        if (stats->opcodes[i] > 0) {
+            setDictField(vm, opcodes, opcodeNames[i], NUMBER_VAL((double) stats->opcodes[i]));
+        }
+    }
+
+    char pair[64];
+    for (int previous = 0; previous < OPCODE_COUNT; ++previous) {
+        for (int current = 0; current < OPCODE_COUNT; ++current) {
+            if (stats->pairs[previous][current] > 0) {
+                snprintf(pair, sizeof(pair), "%s -> %s", opcodeNames[previous], opcodeNames[current]);
+                setDictField(vm, pairs, pair, NUMBER_VAL((double) stats->pairs[previous][current]));
+            }
+        }
+    }
+
+    // Collected up front, a collection while the dictionary grows moves freed functions into the stats
+    int functionCount;
+    FunctionCount *counts = collectFunctions(vm, &functionCount);
+
+    for (int i = 0; i < functionCount; ++i) {
+        setDictField(vm, functions, counts[i].label, NUMBER_VAL((double) counts[i].count));
+    }
+
+    freeFunctionCounts(counts, functionCount);
+    pop(vm);
+
+    return OBJ_VAL(result);
+}
+#endif
@@ -0,0 +1,58 @@
+#ifndef dictu_opstats_h
+#define dictu_opstats_h
+
+#include "object.h"
+
+/**
+ * Instruction counters, compiled in with DEBUG_OPCODE_STATS (cmake -DDEBUG_OPCODE_STATS=ON).
+ * Every dispatched instruction is counted per opcode, per pair of consecutive opcodes
+ * and against the function executing it. Without the option none of this exists.
+ */
+#ifdef DEBUG_OPCODE_STATS
+
+enum {
+    #define OPCODE(name) OPCODE_INDEX_##name,
+    #include "opcodes.h"
+    #undef OPCODE
+    OPCODE_COUNT
+};
+
+typedef struct {
+    char *label;
+    uint64_t count;
+} FunctionCount;
+
+typedef struct {
+    uint64_t opcodes[OPCODE_COUNT];
+    // Indexed [previous][current]
+    uint64_t pairs[OPCODE_COUNT][OPCODE_COUNT];
+    uint8_t previous;
+    // Counts of functions the GC has freed, live functions hold their own
+    FunctionCount *functions;
+    int functionCount;
+    int functionCapacity;
+} OpcodeStats;
+
+static inline void countInstruction(OpcodeStats *stats, ObjFunction *function, uint8_t instruction) {
+    stats->opcodes[instruction]++;
+    stats->pairs[stats->previous][instruction]++;
+    stats->previous = instruction;
+    function->instructionCount++;
+}
+
+OpcodeStats *newOpcodeStats(void);
+
+void freeOpcodeStats(OpcodeStats *stats);
+
+// Keeps the counts of functions the GC is about to free, must run after marking
+void foldOpcodeStats(DictuVM *vm);
+
+// Writes a plain text report, most executed first
+void writeOpcodeStats(DictuVM *vm, FILE *file);
+
+// Returns {"opcodes": {...}, "pairs": {...}, "functions": {...}} leaving out anything never executed
+Value opcodeStatsToDict(DictuVM *vm);
+
+#endif
+
+#endif //dictu_opstats_h
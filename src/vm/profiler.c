@@ -0,0 +1,372 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "profiler.h"
+#include "util.h"
+
+#ifdef _WIN32
+bool startProfiler(DictuVM *vm, int hz) {
+    UNUSED(vm); UNUSED(hz);
+    return false;
+}
+
+bool profilerRunning(DictuVM *vm) {
+    UNUSED(vm);
+    return false;
+}
+
+void drainProfiler(DictuVM *vm) {
+    UNUSED(vm);
+}
+
+char *stopProfiler(DictuVM *vm, size_t *length) {
+    UNUSED(vm); UNUSED(length);
+    return NULL;
+}
+#else
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <sys/time.h>
+
+// Ring buffer slots, a power of two. Each sample takes its depth plus one.
+#define PROFILE_RING_SIZE (1 << 20)
+#define PROFILE_RING_MASK (PROFILE_RING_SIZE - 1)
+// Deeper stacks keep their innermost frames
+#define PROFILE_MAX_DEPTH 256
+
+/**
+ * A sample is a header slot, whose function is NULL and which holds the
+ * depth, followed by that many frames from outermost to innermost. A frame's
+ * line is the line of the call it's making, or 0 for the innermost frame.
+ */
+typedef struct {
+    ObjFunction *function;
+    int depth;
+    int line;
+    bool truncated;
+} ProfileSlot;
+
+typedef struct {
+    char *stack;
+    size_t count;
+} FoldedStack;
+
+typedef struct {
+    FoldedStack *entries;
+    size_t count;
+    size_t capacity;
+} FoldedTable;
+
+typedef struct {
+    DictuVM *vm;
+    pthread_t thread;
+    ProfileSlot *ring;
+    // Written by the signal handler only
+    atomic_size_t head;
+    // Written by the VM thread only
+    atomic_size_t tail;
+    volatile sig_atomic_t active;
+    volatile sig_atomic_t dropped;
+    FoldedTable folded;
+    struct sigaction previousAction;
+} Profiler;
+
+static Profiler profiler;
+
+static void recordSample(int signal) {
+    UNUSED(signal);
+
+    // SIGPROF goes to whichever thread is running, only the VM's thread can walk its frames
+    if (!profiler.active || !pthread_equal(pthread_self(), profiler.thread)) {
+        return;
+    }
+
+    DictuVM *vm = profiler.vm;
+    int frameCount = *(volatile int *) &vm->frameCount;
+    CallFrame *frames = *(CallFrame *volatile *) &vm->frames;
+    atomic_signal_fence(memory_order_acquire);
+
+    if (frameCount == 0) {
+        return;
+    }
+
+    int depth = frameCount < PROFILE_MAX_DEPTH ? frameCount : PROFILE_MAX_DEPTH;
+    size_t head = atomic_load_explicit(&profiler.head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&profiler.tail, memory_order_acquire);
+
+    if (PROFILE_RING_SIZE - (head - tail) < (size_t) depth + 1) {
+        profiler.dropped++;
+        return;
+    }
+
+    profiler.ring[head & PROFILE_RING_MASK] = (ProfileSlot) {NULL, depth, 0, frameCount > depth};
+
+    for (int i = 0; i < depth; ++i) {
+        ProfileSlot *slot = &profiler.ring[(head + 1 + i) & PROFILE_RING_MASK];
+        CallFrame *frame = &frames[frameCount - depth + i];
+        ObjFunction *function = frame->closure->function;
+
+        slot->function = function;
+        slot->line = 0;
+
+        // Callers stored their ip before making the call, so it points just past the call instruction
+        if (i < depth - 1) {
+            int offset = (int) (frame->ip - function->chunk.code) - 1;
+
+            if (offset >= 0 && offset < function->chunk.count) {
+                slot->line = function->chunk.lines[offset];
+            }
+        }
+    }
+
+    atomic_store_explicit(&profiler.head, head + depth + 1, memory_order_release);
+}
+
+static uint32_t hashStack(const char *stack, size_t length) {
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= (uint8_t) stack[i];
+        hash *= 16777619;
+    }
+
+    return hash;
+}
+
+static FoldedStack *findStack(FoldedTable *table, const char *stack, size_t length) {
+    if (table->count + 1 > table->capacity / 2) {
+        size_t capacity = table->capacity < 64 ? 64 : table->capacity * 2;
+        FoldedStack *entries = calloc(capacity, sizeof(FoldedStack));
+
+        if (entries == NULL) {
+            return NULL;
+        }
+
+        for (size_t i = 0; i < table->capacity; ++i) {
+            FoldedStack *entry = &table->entries[i];
+
+            if (entry->stack == NULL) {
+                continue;
+            }
+
+            size_t index = hashStack(entry->stack, strlen(entry->stack)) & (capacity - 1);
+            while (entries[index].stack != NULL) {
+                index = (index + 1) & (capacity - 1);
+            }
+
+            entries[index] = *entry;
+        }
+
+        free(table->entries);
+        table->entries = entries;
+        table->capacity = capacity;
+    }
+
+    size_t index = hashStack(stack, length) & (table->capacity - 1);
+
+    for (;;) {
+        FoldedStack *entry = &table->entries[index];
+
+        if (entry->stack == NULL) {
+            entry->stack = malloc(length + 1);
+
+            if (entry->stack == NULL) {
+                return NULL;
+            }
+
+            memcpy(entry->stack, stack, length);
+            entry->stack[length] = '\0';
+            table->count++;
+
+            return entry;
+        }
+
+        if (strncmp(entry->stack, stack, length) == 0 && entry->stack[length] == '\0') {
+            return entry;
+        }
+
+        index = (index + 1) & (table->capacity - 1);
+    }
+}
+
+/**
+ * Appends the frame's label. Callers are labelled with the line of their call,
+ * so the same function reached through different call sites stays apart. The
+ * innermost frame's ip is only held in a register by run(), so it has no line
+ * and takes the first line of the function's body.
+ */
+static size_t appendFrame(char **buffer, size_t *capacity, size_t length, ProfileSlot *slot) {
+    size_t separator = length > 0 ? 1 : 0;
+
+    for (;;) {
+        // The terminator always fits, so there is room for the separator
+        int written = formatFunctionLabel(*buffer + length + separator, *capacity - length - separator,
+                                          slot->function, slot->line);
+
+        if (written >= 0 && (size_t) written < *capacity - length - separator) {
+            if (separator > 0) {
+                (*buffer)[length] = ';';
+            }
+
+            return length + separator + written;
+        }
+
+        *capacity *= 2;
+        *buffer = realloc(*buffer, *capacity);
+
+        if (*buffer == NULL) {
+            return 0;
+        }
+    }
+}
+
+void drainProfiler(DictuVM *vm) {
+    if (!profiler.active || profiler.vm != vm) {
+        return;
+    }
+
+    size_t head = atomic_load_explicit(&profiler.head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&profiler.tail, memory_order_relaxed);
+
+    size_t capacity = 256;
+    char *buffer = malloc(capacity);
+
+    while (buffer != NULL && tail != head) {
+        ProfileSlot *header = &profiler.ring[tail & PROFILE_RING_MASK];
+        size_t length = 0;
+
+        if (header->truncated) {
+            length = snprintf(buffer, capacity, "[truncated]");
+        }
+
+        for (int i = 0; i < header->depth && buffer != NULL; ++i) {
+            length = appendFrame(&buffer, &capacity, length, &profiler.ring[(tail + 1 + i) & PROFILE_RING_MASK]);
+        }
+
+        if (buffer == NULL) {
+            break;
+        }
+
+        FoldedStack *entry = findStack(&profiler.folded, buffer, length);
+        if (entry != NULL) {
+            entry->count++;
+        }
+
+        tail += header->depth + 1;
+    }
+
+    free(buffer);
+    atomic_store_explicit(&profiler.tail, head, memory_order_release);
+}
+
+bool startProfiler(DictuVM *vm, int hz) {
+    if (profiler.active || hz <= 0) {
+        return false;
+    }
+
+    profiler.ring = malloc(sizeof(ProfileSlot) * PROFILE_RING_SIZE);
+    if (profiler.ring == NULL) {
+        return false;
+    }
+
+    profiler.vm = vm;
+    profiler.thread = pthread_self();
+    atomic_store(&profiler.head, 0);
+    atomic_store(&profiler.tail, 0);
+    profiler.dropped = 0;
+    profiler.folded = (FoldedTable) {NULL, 0, 0};
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = recordSample;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+
+    if (sigaction(SIGPROF, &action, &profiler.previousAction) != 0) {
+        free(profiler.ring);
+        return false;
+    }
+
+    profiler.active = true;
+
+    long interval = 1000000 / hz;
+    struct itimerval timer;
+    timer.it_interval.tv_sec = interval / 1000000;
+    timer.it_interval.tv_usec = interval % 1000000;
+    timer.it_value = timer.it_interval;
+
+    if (setitimer(ITIMER_PROF, &timer, NULL) != 0) {
+        profiler.active = false;
+        sigaction(SIGPROF, &profiler.previousAction, NULL);
+        free(profiler.ring);
+        return false;
+    }
+
+    return true;
+}
+
+bool profilerRunning(DictuVM *vm) {
+    return profiler.active && profiler.vm == vm;
+}
+
+static int compareStacks(const void *a, const void *b) {
+    return strcmp(((const FoldedStack *) a)->stack, ((const FoldedStack *) b)->stack);
+}
+
+char *stopProfiler(DictuVM *vm, size_t *length) {
+    if (!profilerRunning(vm)) {
+        return NULL;
+    }
+
+    struct itimerval timer;
+    memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_PROF, &timer, NULL);
+
+    drainProfiler(vm);
+    profiler.active = false;
+    sigaction(SIGPROF, &profiler.previousAction, NULL);
+
+    FoldedTable *table = &profiler.folded;
+    FoldedStack *stacks = malloc(sizeof(FoldedStack) * (table->count + 1));
+    size_t count = 0;
+    size_t size = 1;
+
+    for (size_t i = 0; stacks != NULL && i < table->capacity; ++i) {
+        if (table->entries[i].stack != NULL) {
+            stacks[count++] = table->entries[i];
+            size += strlen(table->entries[i].stack) + 24;
+        }
+    }
+
+    char *output = stacks == NULL ? NULL : malloc(size);
+    *length = 0;
+
+    if (output != NULL) {
+        qsort(stacks, count, sizeof(FoldedStack), compareStacks);
+        output[0] = '\0';
+
+        for (size_t i = 0; i < count; ++i) {
+            *length += snprintf(output + *length, size - *length, "%s %zu\n", stacks[i].stack, stacks[i].count);
+        }
+    }
+
+    if (profiler.dropped > 0) {
+        fprintf(stderr, "Profiler dropped %d samples, the ring buffer filled between collections.\n",
+                (int) profiler.dropped);
+    }
+
+    for (size_t i = 0; i < table->capacity; ++i) {
+        free(table->entries[i].stack);
+    }
+
+    free(table->entries);
+    free(stacks);
+    free(profiler.ring);
+    profiler.ring = NULL;
+    profiler.vm = NULL;
+
+    return output;
+}
+#endif
@@ -0,0 +1,39 @@
+#ifndef dictu_profiler_h
+#define dictu_profiler_h
+
+#include "vm.h"
+
+/**
+ * Sampling profiler. A SIGPROF timer records the functions on the VM's call
+ * stack into a ring buffer, which the VM thread folds into collapsed stacks
+ * (the format flamegraph.pl and speedscope read) at each garbage collection
+ * and when the profile is stopped.
+ */
+
+/**
+ * The profiler's signal handler can interrupt the VM anywhere, so frames have
+ * to be complete before they are counted. This keeps the compiler from
+ * reordering those stores.
+ */
+#ifdef _WIN32
+#define PROFILER_FENCE()
+#else
+#include <stdatomic.h>
+#define PROFILER_FENCE() atomic_signal_fence(memory_order_release)
+#endif
+
+// Default sampling rate, in samples per second of CPU time
+#define PROFILE_DEFAULT_HZ 1000
+
+// Returns false if profiling is unsupported or a profile is already running
+bool startProfiler(DictuVM *vm, int hz);
+
+bool profilerRunning(DictuVM *vm);
+
+// Folds any pending samples, must run before the GC can free functions
+void drainProfiler(DictuVM *vm);
+
+// Stops the profile and returns the collapsed stacks, which the caller frees, or NULL if none was running
+char *stopProfiler(DictuVM *vm, size_t *length);
+
+#endif //dictu_profiler_h
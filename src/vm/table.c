@@ -206,7 +206,8 @@ ObjString *tableFindString(Table *table, const char *chars, int length,
 void tableRemoveWhite(DictuVM *vm, Table *table) {
     for (int i = 0; i <= table->capacityMask; i++) {
         Entry *entry = &table->entries[i];
-        if (entry->key != NULL && !entry->key->obj.isDark) {
+        // Deleting shifts the following entries back, so recheck this slot
+        while (entry->key != NULL && !entry->key->obj.isDark) {
             tableDelete(vm, table, entry->key);
         }
     }
@@ -4,6 +4,7 @@
 
 #include "vm.h"
 #include "memory.h"
+#include "util.h"
 
 char *readFile(DictuVM *vm, const char *path) {
     FILE *file = fopen(path, "rb");
@@ -133,4 +134,142 @@ Value boolNative(DictuVM *vm, int argCount, Value *args) {
     }
 
     return BOOL_VAL(!isFalsey(args[0]));
-}
\ No newline at end of file
+}
+void setDictField(DictuVM *vm, ObjDict *dict, const char *key, Value value) {
+    push(vm, value);
+    Value keyValue = OBJ_VAL(copyString(vm, key, strlen(key)));
+    push(vm, keyValue);
+    dictSet(vm, dict, keyValue, value);
+    pop(vm);
+    pop(vm);
+}
+
+size_t hashPointer(const void *pointer) {
+    uint64_t hash = (uint64_t) (uintptr_t) pointer;
+
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+
+    return (size_t) hash;
+}
+
+int formatFunctionLabel(char *buffer, size_t size, ObjFunction *function, int line) {
+    if (function == NULL) {
+        return snprintf(buffer, size, "<vm>");
+    }
+
+    const char *name = function->name == NULL ? "<script>" : function->name->chars;
+    const char *module = function->module->name->chars;
+
+    if (line == 0 && function->name != NULL && function->chunk.count > 0) {
+        line = function->chunk.lines[0];
+    }
+
+    if (line == 0) {
+        return snprintf(buffer, size, "%s (%s)", name, module);
+    }
+
+    return snprintf(buffer, size, "%s (%s:%d)", name, module, line);
+}
+
+char *functionLabel(ObjFunction *function, int line) {
+    int length = formatFunctionLabel(NULL, 0, function, line);
+    char *label = length < 0 ? NULL : malloc(length + 1);
+
+    if (label != NULL) {
+        formatFunctionLabel(label, length + 1, function, line);
+    }
+
+    return label;
+}
+
+static size_t hashProfileKey(ObjFunction *function, int line, int kind) {
+    return hashPointer(function) ^ ((size_t) line * 31 + kind) * 0x9e3779b97f4a7c15ULL;
+}
+
+static bool growProfileSlots(ProfileIndex *index) {
+    int capacity = index->slotCapacity < 64 ? 64 : index->slotCapacity * 2;
+    int *slots = calloc(capacity, sizeof(int));
+
+    if (slots == NULL) {
+        return false;
+    }
+
+    for (int i = 0; i < index->count; ++i) {
+        ProfileKey *key = &index->keys[i];
+        size_t slot = hashProfileKey(key->function, key->line, key->kind) & (capacity - 1);
+
+        while (slots[slot] != 0) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+
+        slots[slot] = i + 1;
+    }
+
+    free(index->slots);
+    index->slots = slots;
+    index->slotCapacity = capacity;
+
+    return true;
+}
+
+int findProfileKey(ProfileIndex *index, ObjFunction *function, int line, int kind) {
+    if ((index->count + 1) * 2 > index->slotCapacity && !growProfileSlots(index)) {
+        return -1;
+    }
+
+    size_t slot = hashProfileKey(function, line, kind) & (index->slotCapacity - 1);
+
+    while (index->slots[slot] != 0) {
+        ProfileKey *key = &index->keys[index->slots[slot] - 1];
+
+        if (!key->retired && key->function == function && key->line == line && key->kind == kind) {
+            return index->slots[slot] - 1;
+        }
+
+        slot = (slot + 1) & (index->slotCapacity - 1);
+    }
+
+    if (index->count == index->capacity) {
+        int capacity = index->capacity < 64 ? 64 : index->capacity * 2;
+        ProfileKey *keys = realloc(index->keys, sizeof(ProfileKey) * capacity);
+
+        if (keys == NULL) {
+            return -1;
+        }
+
+        index->keys = keys;
+        index->capacity = capacity;
+    }
+
+    char *label = functionLabel(function, line);
+    if (label == NULL) {
+        return -1;
+    }
+
+    index->keys[index->count] = (ProfileKey) {function, line, kind, false, label};
+    index->slots[slot] = ++index->count;
+
+    return index->count - 1;
+}
+
+void retireProfileKeys(ProfileIndex *index) {
+    for (int i = 0; i < index->count; ++i) {
+        ProfileKey *key = &index->keys[i];
+
+        // Retired keys may point at a function freed by an earlier collection
+        if (!key->retired && key->function != NULL && !key->function->obj.isDark) {
+            key->retired = true;
+        }
+    }
+}
+
+void freeProfileIndex(ProfileIndex *index) {
+    for (int i = 0; i < index->count; ++i) {
+        free(index->keys[i].label);
+    }
+
+    free(index->keys);
+    free(index->slots);
+}
@@ -19,4 +19,50 @@ ObjString *dirname(DictuVM *vm, char *path, int len);
 
 bool resolvePath(char *directory, char *path, char *ret);
 
+// Sets a string key of a dictionary, the value is kept reachable while the key is allocated
+void setDictField(DictuVM *vm, ObjDict *dict, const char *key, Value value);
+
+// Mixes an address into a hash for open addressing tables keyed on pointers
+size_t hashPointer(const void *pointer);
+
+/**
+ * Writes "name (module:line)" in the manner of snprintf, returning the length needed.
+ * With a line of 0 functions take the first line of their body and the script has
+ * none. A NULL function, work done outside of any function, is labelled "<vm>".
+ */
+int formatFunctionLabel(char *buffer, size_t size, ObjFunction *function, int line);
+
+// The same label in a string the caller frees, or NULL if it can't be allocated
+char *functionLabel(ObjFunction *function, int line);
+
+/**
+ * Index used by the profilers to give each (function, line, kind) a label and a
+ * dense index to keep its counts under. Keys are retired rather than removed once
+ * the GC frees their function, so a new function at the same address gets its own.
+ */
+typedef struct {
+    ObjFunction *function;
+    int line;
+    int kind;
+    bool retired;
+    char *label;
+} ProfileKey;
+
+typedef struct {
+    ProfileKey *keys;
+    int count;
+    int capacity;
+    // Open addressing on the key, holding key indexes plus one
+    int *slots;
+    int slotCapacity;
+} ProfileIndex;
+
+// Returns the index of the key, adding it if it's new, or -1 if it can't be allocated
+int findProfileKey(ProfileIndex *index, ObjFunction *function, int line, int kind);
+
+// Retires the keys of functions the GC is about to free, must run after marking
+void retireProfileKeys(ProfileIndex *index);
+
+void freeProfileIndex(ProfileIndex *index);
+
 #endif //dictu_util_h
@@ -168,6 +168,17 @@ bool dictSet(DictuVM *vm, ObjDict *dict, Value key, Value value) {
     return isNewKey;
 }
 
+void dictReserve(DictuVM *vm, ObjDict *dict, int count) {
+    int capacity = GROW_CAPACITY(0);
+    while (count > capacity * TABLE_MAX_LOAD) {
+        capacity *= 2;
+    }
+
+    if (capacity - 1 > dict->capacityMask) {
+        adjustDictCapacity(vm, dict, capacity - 1);
+    }
+}
+
 bool dictDelete(DictuVM *vm, ObjDict *dict, Value key) {
     if (dict->count == 0) return false;
 
@@ -128,6 +128,8 @@ bool dictGet(ObjDict *dict, Value key, Value *value);
 
 bool dictDelete(DictuVM *vm, ObjDict *dict, Value key);
 
+void dictReserve(DictuVM *vm, ObjDict *dict, int count);
+
 bool setGet(ObjSet *set, Value value);
 
 bool setInsert(DictuVM *vm, ObjSet *set, Value value);
@@ -22,6 +22,7 @@
 #include "datatypes/class.h"
 #include "datatypes/instance.h"
 #include "natives.h"
+#include "profiler.h"
 #include "../optionals/optionals.h"
 
 static void resetStack(DictuVM *vm) {
@@ -104,6 +105,15 @@ DictuVM *dictuInitVM(bool repl, int argc, char *argv[]) {
     vm->initString = copyString(vm, "init", 4);
     vm->replVar = copyString(vm, "_", 1);
 
+#ifdef DEBUG_OPCODE_STATS
+    vm->opcodeStats = newOpcodeStats();
+
+    if (vm->opcodeStats == NULL) {
+        printf("Unable to allocate memory\n");
+        exit(71);
+    }
+#endif
+
     // Native methods
     declareNumberMethods(vm);
     declareBoolMethods(vm);
@@ -129,7 +139,67 @@ DictuVM *dictuInitVM(bool repl, int argc, char *argv[]) {
     return vm;
 }
 
+size_t dictuGCCount(DictuVM *vm) {
+    return vm->gcCount;
+}
+
+bool dictuProfileStart(DictuVM *vm, int hz) {
+    return startProfiler(vm, hz > 0 ? hz : PROFILE_DEFAULT_HZ);
+}
+
+bool dictuProfileStop(DictuVM *vm, const char *path) {
+    size_t length;
+    char *stacks = stopProfiler(vm, &length);
+
+    if (stacks == NULL) {
+        return false;
+    }
+
+    FILE *file = fopen(path, "w");
+    bool written = file != NULL && fwrite(stacks, 1, length, file) == length;
+
+    if (file != NULL) {
+        written = fclose(file) == 0 && written;
+    }
+
+    free(stacks);
+    return written;
+}
+
+bool dictuCallProfileStart(DictuVM *vm) {
+    return startCallProfile(vm);
+}
+
+bool dictuCallProfileStop(DictuVM *vm, const char *path) {
+    // The script may have stopped the profile itself, which leaves nothing to write
+    if (vm->callProfile == NULL) {
+        return true;
+    }
+
+    bool written = saveCallProfile(vm, path);
+    stopCallProfile(vm);
+
+    return written;
+}
+
 void dictuFreeVM(DictuVM *vm) {
+    // A profile left running would otherwise sample a freed VM
+    free(stopProfiler(vm, &(size_t) {0}));
+    stopAllocationProfile(vm);
+    stopCallProfile(vm);
+
+#ifdef DEBUG_OPCODE_STATS
+    // Reported to the file named by DICTU_OPCODE_STATS, or stderr
+    const char *statsPath = getenv("DICTU_OPCODE_STATS");
+    FILE *statsFile = statsPath != NULL ? fopen(statsPath, "w") : NULL;
+
+    writeOpcodeStats(vm, statsFile != NULL ? statsFile : stderr);
+
+    if (statsFile != NULL) {
+        fclose(statsFile);
+    }
+#endif
+
     freeTable(vm, &vm->modules);
     freeTable(vm, &vm->globals);
     freeTable(vm, &vm->constants);
@@ -150,6 +220,10 @@ void dictuFreeVM(DictuVM *vm) {
     vm->replVar = NULL;
     freeObjects(vm);
 
+#ifdef DEBUG_OPCODE_STATS
+    freeOpcodeStats(vm->opcodeStats);
+#endif
+
 #if defined(DEBUG_TRACE_MEM) || defined(DEBUG_FINAL_MEM)
 #ifdef __MINGW32__
     printf("Total memory usage: %lu\n", (unsigned long)vm->bytesAllocated);
@@ -187,17 +261,34 @@ static bool call(DictuVM *vm, ObjClosure *closure, int argCount) {
     }
     if (vm->frameCount == vm->frameCapacity) {
         int oldCapacity = vm->frameCapacity;
-        vm->frameCapacity = GROW_CAPACITY(vm->frameCapacity);
-        vm->frames = GROW_ARRAY(vm, vm->frames, CallFrame,
-                                   oldCapacity, vm->frameCapacity);
+        int capacity = GROW_CAPACITY(vm->frameCapacity);
+
+        // Copy rather than realloc so the old frames stay readable until the new ones are published
+        CallFrame *frames = ALLOCATE(vm, CallFrame, capacity);
+        if (oldCapacity > 0) {
+            memcpy(frames, vm->frames, sizeof(CallFrame) * oldCapacity);
+        }
+
+        CallFrame *oldFrames = vm->frames;
+        vm->frames = frames;
+        vm->frameCapacity = capacity;
+        PROFILER_FENCE();
+        FREE_ARRAY(vm, CallFrame, oldFrames, oldCapacity);
     }
 
-    CallFrame *frame = &vm->frames[vm->frameCount++];
+    CallFrame *frame = &vm->frames[vm->frameCount];
     frame->closure = closure;
     frame->ip = closure->function->chunk.code;
 
     frame->slots = vm->stackTop - argCount - 1;
 
+    if (vm->callProfile != NULL) {
+        enterFunction(vm, closure->function, vm->frameCount);
+    }
+
+    PROFILER_FENCE();
+    vm->frameCount++;
+
     return true;
 }
 
@@ -573,7 +664,7 @@ static void setReplVar(DictuVM *vm, Value value) {
     tableSet(vm, &vm->globals, vm->replVar, value);
 }
 
-static DictuInterpretResult run(DictuVM *vm) {
+static DictuInterpretResult run(DictuVM *vm, int frameBase) {
 
     CallFrame *frame = &vm->frames[vm->frameCount - 1];
     register uint8_t* ip = frame->ip;
@@ -609,6 +700,12 @@ static DictuInterpretResult run(DictuVM *vm) {
             return INTERPRET_RUNTIME_ERROR;                                 \
         } while (0)
 
+    #ifdef DEBUG_OPCODE_STATS
+        #define COUNT_INSTRUCTION() countInstruction(vm->opcodeStats, frame->closure->function, instruction)
+    #else
+        #define COUNT_INSTRUCTION()
+    #endif
+
     #ifdef COMPUTED_GOTO
 
     static void* dispatchTable[] = {
@@ -633,14 +730,18 @@ static DictuInterpretResult run(DictuVM *vm) {
                 printf("\n");                                                                     \
                 disassembleInstruction(&frame->closure->function->chunk,                          \
                         (int) (ip - frame->closure->function->chunk.code));                \
-                goto *dispatchTable[instruction = READ_BYTE()];                                   \
+                instruction = READ_BYTE();                                                        \
+                COUNT_INSTRUCTION();                                                              \
+                goto *dispatchTable[instruction];                                                 \
             }                                                                                     \
             while (false)
     #else
         #define DISPATCH()                                            \
             do                                                        \
             {                                                         \
-                goto *dispatchTable[instruction = READ_BYTE()];       \
+                instruction = READ_BYTE();                            \
+                COUNT_INSTRUCTION();                                  \
+                goto *dispatchTable[instruction];                     \
             }                                                         \
             while (false)
     #endif
@@ -649,7 +750,9 @@ static DictuInterpretResult run(DictuVM *vm) {
 
     #define INTERPRET_LOOP                                        \
             loop:                                                 \
-                switch (instruction = READ_BYTE())
+                instruction = READ_BYTE();                            \
+                COUNT_INSTRUCTION();                                  \
+                switch (instruction)
 
     #define DISPATCH() goto loop
 
@@ -800,6 +903,7 @@ static DictuInterpretResult run(DictuVM *vm) {
                     DISPATCH();
                 }
 
+                STORE_FRAME;
                 if (bindMethod(vm, instance->klass, name)) {
                     DISPATCH();
                 }
@@ -859,6 +963,7 @@ static DictuInterpretResult run(DictuVM *vm) {
                 DISPATCH();
             }
 
+            STORE_FRAME;
             if (bindMethod(vm, instance->klass, name)) {
                 DISPATCH();
             }
@@ -913,6 +1018,7 @@ static DictuInterpretResult run(DictuVM *vm) {
             ObjString *name = READ_STRING();
             ObjClass *superclass = AS_CLASS(pop(vm));
 
+            STORE_FRAME;
             if (!bindMethod(vm, superclass, name)) {
                 RUNTIME_ERROR("Undefined property '%s'.", name->chars);
             }
@@ -936,6 +1042,7 @@ static DictuInterpretResult run(DictuVM *vm) {
 
         CASE_CODE(ADD): {
             if (IS_STRING(peek(vm, 0)) && IS_STRING(peek(vm, 1))) {
+                STORE_FRAME;
                 concatenate(vm);
             } else if (IS_NUMBER(peek(vm, 0)) && IS_NUMBER(peek(vm, 1))) {
                 double b = AS_NUMBER(pop(vm));
@@ -945,6 +1052,7 @@ static DictuInterpretResult run(DictuVM *vm) {
                 ObjList *listOne = AS_LIST(peek(vm, 1));
                 ObjList *listTwo = AS_LIST(peek(vm, 0));
 
+                STORE_FRAME;
                 ObjList *finalList = initList(vm);
                 push(vm, OBJ_VAL(finalList));
 
@@ -1093,6 +1201,7 @@ static DictuInterpretResult run(DictuVM *vm) {
                 RUNTIME_ERROR("Could not open file \"%s\".", fileName->chars);
             }
 
+            STORE_FRAME;
             ObjString *pathObj = copyString(vm, path, strlen(path));
             push(vm, OBJ_VAL(pathObj));
             ObjModule *module = newModule(vm, pathObj);
@@ -1194,6 +1303,7 @@ static DictuInterpretResult run(DictuVM *vm) {
 
         CASE_CODE(NEW_LIST): {
             int count = READ_BYTE();
+            STORE_FRAME;
             ObjList *list = initList(vm);
             push(vm, OBJ_VAL(list));
 
@@ -1232,6 +1342,7 @@ static DictuInterpretResult run(DictuVM *vm) {
 
         CASE_CODE(NEW_DICT): {
             int count = READ_BYTE();
+            STORE_FRAME;
             ObjDict *dict = initDict(vm);
             push(vm, OBJ_VAL(dict));
 
@@ -1291,6 +1402,7 @@ static DictuInterpretResult run(DictuVM *vm) {
                     if (index >= 0 && index < string->length) {
                         pop(vm);
                         pop(vm);
+                        STORE_FRAME;
                         push(vm, OBJ_VAL(copyString(vm, &string->chars[index], 1)));
                         DISPATCH();
                     }
@@ -1375,6 +1487,7 @@ static DictuInterpretResult run(DictuVM *vm) {
         }
 
         CASE_CODE(SLICE): {
+            STORE_FRAME;
             Value sliceEndIndex = peek(vm, 0);
             Value sliceStartIndex = peek(vm, 1);
             Value objectValue = peek(vm, 2);
@@ -1558,6 +1671,7 @@ static DictuInterpretResult run(DictuVM *vm) {
 
             // Create the closure and push it on the stack before creating
             // upvalues so that it doesn't get collected.
+            STORE_FRAME;
             ObjClosure *closure = newClosure(vm, function);
             push(vm, OBJ_VAL(closure));
 
@@ -1592,11 +1706,22 @@ static DictuInterpretResult run(DictuVM *vm) {
 
             vm->frameCount--;
 
+            if (vm->callProfile != NULL) {
+                exitFunction(vm, vm->frameCount);
+            }
+
             if (vm->frameCount == 0) {
                 pop(vm);
                 return INTERPRET_OK;
             }
 
+            // Returning to the native that made the call, see callFunction()
+            if (vm->frameCount == frameBase) {
+                vm->stackTop = frame->slots;
+                push(vm, result);
+                return INTERPRET_OK;
+            }
+
             vm->stackTop = frame->slots;
             push(vm, result);
 
@@ -1607,6 +1732,7 @@ static DictuInterpretResult run(DictuVM *vm) {
 
         CASE_CODE(CLASS): {
             ClassType type = READ_BYTE();
+            STORE_FRAME;
             createClass(vm, READ_STRING(), NULL, type);
             DISPATCH();
         }
@@ -1623,6 +1749,7 @@ static DictuInterpretResult run(DictuVM *vm) {
                 RUNTIME_ERROR("Superclass can not be a trait.");
             }
 
+            STORE_FRAME;
             createClass(vm, READ_STRING(), AS_CLASS(superclass), type);
             DISPATCH();
         }
@@ -1677,6 +1804,7 @@ static DictuInterpretResult run(DictuVM *vm) {
             ObjString *openTypeString = AS_STRING(openType);
             ObjString *fileNameString = AS_STRING(fileName);
 
+            STORE_FRAME;
             ObjFile *file = initFile(vm);
             file->file = fopen(fileNameString->chars, openTypeString->chars);
             file->path = fileNameString->chars;
@@ -1686,6 +1814,8 @@ static DictuInterpretResult run(DictuVM *vm) {
                 RUNTIME_ERROR("Unable to open file '%s'", file->path);
             }
 
+            file->isOpen = true;
+
             pop(vm);
             pop(vm);
             push(vm, OBJ_VAL(file));
@@ -1695,6 +1825,7 @@ static DictuInterpretResult run(DictuVM *vm) {
         CASE_CODE(CLOSE_FILE): {
             ObjFile *file = AS_FILE(peek(vm, 0));
             fclose(file->file);
+            file->isOpen = false;
             DISPATCH();
         }
     }
@@ -1706,6 +1837,7 @@ static DictuInterpretResult run(DictuVM *vm) {
 #undef BINARY_OP
 #undef STORE_FRAME
 #undef RUNTIME_ERROR
+#undef COUNT_INSTRUCTION
 
     return INTERPRET_RUNTIME_ERROR;
 }
@@ -1727,7 +1859,27 @@ DictuInterpretResult dictuInterpret(DictuVM *vm, char *moduleName, char *source)
     pop(vm);
     push(vm, OBJ_VAL(closure));
     callValue(vm, OBJ_VAL(closure), 0);
-    DictuInterpretResult result = run(vm);
+    DictuInterpretResult result = run(vm, 0);
 
     return result;
 }
+
+Value callFunction(DictuVM *vm, Value function, int argCount, Value *args) {
+    int frameBase = vm->frameCount;
+
+    push(vm, function);
+    for (int i = 0; i < argCount; ++i) {
+        push(vm, args[i]);
+    }
+
+    if (!callValue(vm, function, argCount)) {
+        return EMPTY_VAL;
+    }
+
+    // Natives, and classes without an initialiser, have already left their result on the stack
+    if (vm->frameCount > frameBase && run(vm, frameBase) != INTERPRET_OK) {
+        return EMPTY_VAL;
+    }
+
+    return pop(vm);
+}
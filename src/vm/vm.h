@@ -5,6 +5,9 @@
 #include "table.h"
 #include "value.h"
 #include "compiler.h"
+#include "opstats.h"
+#include "allocations.h"
+#include "calls.h"
 
 // TODO: Work out the maximum stack size at compilation time
 #define STACK_MAX (64 * UINT8_COUNT)
@@ -44,10 +47,16 @@ struct _vm {
     ObjUpvalue *openUpvalues;
     size_t bytesAllocated;
     size_t nextGC;
+    size_t gcCount;
     Obj *objects;
     int grayCount;
     int grayCapacity;
     Obj **grayStack;
+    AllocationProfile *allocationProfile;
+    CallProfile *callProfile;
+#ifdef DEBUG_OPCODE_STATS
+    OpcodeStats *opcodeStats;
+#endif
 };
 
 #define OK     0
@@ -63,4 +72,11 @@ Value pop(DictuVM *vm);
 
 bool isFalsey(Value value);
 
+/**
+ * Calls a Dictu function, closure, bound method, class or native from native code
+ * and returns its result. On a runtime error the error has already been reported
+ * and EMPTY_VAL is returned, which the native should return straight away.
+ */
+Value callFunction(DictuVM *vm, Value function, int argCount, Value *args);
+
 #endif